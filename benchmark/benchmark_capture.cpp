@@ -0,0 +1,192 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_capture.h>
+#include <sensor_msgs/image_encodings.h>
+#include <sensor_msgs/PointField.h>
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#ifdef HALCON_BRIDGE_HAVE_ROSBAG
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#endif
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    // Number of records in every replayed file, about one second of a 30 Hz sensor
+    const int kRecords = 30;
+
+    std::string createTemporaryFile() {
+        char path[] = "/tmp/halcon_bridge_benchmark_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd >= 0) close(fd);
+        return path;
+    }
+
+    sensor_msgs::Image createImage(int index) {
+        sensor_msgs::Image image;
+        image.header.stamp = ros::Time(1000, index * 33333333);
+        image.header.frame_id = "camera";
+        image.encoding = enc::RGB8;
+        image.width = 1920;
+        image.height = 1080;
+        image.is_bigendian = false;
+        image.step = image.width * 3;
+        image.data.resize((size_t)image.step * image.height);
+        for (size_t i = 0; i < image.data.size(); i++) {
+            image.data[i] = (uint8_t)(i * 7 + index);
+        }
+        return image;
+    }
+
+    // dense cloud of an organized depth sensor with normals
+    sensor_msgs::PointCloud2 createPointcloud(int index) {
+        const char* names[] = { "x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature" };
+        const uint32_t offsets[] = { 0, 4, 8, 16, 20, 24, 32 };
+        sensor_msgs::PointCloud2 cloud;
+        cloud.header.stamp = ros::Time(1000, index * 33333333);
+        cloud.header.frame_id = "depth";
+        cloud.width = 640;
+        cloud.height = 480;
+        cloud.is_bigendian = false;
+        cloud.is_dense = true;
+        cloud.point_step = 48;
+        cloud.row_step = cloud.width * cloud.point_step;
+        for (int i = 0; i < 7; i++) {
+            sensor_msgs::PointField field;
+            field.name = names[i];
+            field.offset = offsets[i];
+            field.datatype = sensor_msgs::PointField::FLOAT32;
+            field.count = 1;
+            cloud.fields.push_back(field);
+        }
+        cloud.data.resize((size_t)cloud.row_step * cloud.height);
+        for (size_t point = 0; point < (size_t)cloud.width * cloud.height; point++) {
+            for (int i = 0; i < 7; i++) {
+                float value = (float)(point % 640) * 0.001f + i + index;
+                memcpy(&cloud.data[point * cloud.point_step + offsets[i]], &value, sizeof(value));
+            }
+        }
+        return cloud;
+    }
+
+    void setCounters(benchmark::State& state, size_t bytes) {
+        state.SetBytesProcessed(state.iterations() * bytes);
+        state.counters["records/s"] = benchmark::Counter(kRecords, benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    void replayCaptureImages(benchmark::State& state) {
+        std::string path = createTemporaryFile();
+        size_t bytes = 0;
+        {
+            halcon_bridge::HalconCaptureWriter writer(path);
+            for (int i = 0; i < kRecords; i++) {
+                sensor_msgs::Image image = createImage(i);
+                bytes += image.data.size();
+                writer.write(*halcon_bridge::toHalconCopy(image));
+            }
+        }
+        {
+            halcon_bridge::HalconCaptureReader reader(path);
+            for (auto _ : state) {
+                for (size_t i = 0; i < reader.size(); i++) {
+                    halcon_bridge::HalconImageConstPtr image = reader.readImage(i);
+                    benchmark::DoNotOptimize(image->image);
+                }
+            }
+        }
+        unlink(path.c_str());
+        setCounters(state, bytes);
+    }
+
+    void replayCapturePointclouds(benchmark::State& state) {
+        std::string path = createTemporaryFile();
+        size_t bytes = 0;
+        {
+            halcon_bridge::HalconCaptureWriter writer(path);
+            for (int i = 0; i < kRecords; i++) {
+                sensor_msgs::PointCloud2 cloud = createPointcloud(i);
+                bytes += cloud.data.size();
+                writer.write(*halcon_bridge::toHalconCopy(cloud));
+            }
+        }
+        {
+            halcon_bridge::HalconCaptureReader reader(path);
+            for (auto _ : state) {
+                for (size_t i = 0; i < reader.size(); i++) {
+                    halcon_bridge::HalconPointcloudConstPtr pointcloud = reader.readPointcloud(i);
+                    benchmark::DoNotOptimize(pointcloud->model);
+                }
+            }
+        }
+        unlink(path.c_str());
+        setCounters(state, bytes);
+    }
+
+#ifdef HALCON_BRIDGE_HAVE_ROSBAG
+    // The replay the capture format replaces: read the messages from a bag and convert them with toHalconCopy.
+    template<typename Message, typename Result>
+    void replayRosbag(benchmark::State& state, Message (*create)(int)) {
+        std::string path = createTemporaryFile();
+        size_t bytes = 0;
+        {
+            rosbag::Bag bag(path, rosbag::bagmode::Write);
+            for (int i = 0; i < kRecords; i++) {
+                Message message = create(i);
+                bytes += message.data.size();
+                bag.write("data", message.header.stamp, message);
+            }
+        }
+        {
+            rosbag::Bag bag(path, rosbag::bagmode::Read);
+            rosbag::View view(bag);
+            for (auto _ : state) {
+                for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it) {
+                    boost::shared_ptr<Message> message = it->instantiate<Message>();
+                    Result converted = halcon_bridge::toHalconCopy(*message);
+                    benchmark::DoNotOptimize(converted.get());
+                }
+            }
+        }
+        unlink(path.c_str());
+        setCounters(state, bytes);
+    }
+
+    void replayRosbagImages(benchmark::State& state) {
+        replayRosbag<sensor_msgs::Image, halcon_bridge::HalconImagePtr>(state, createImage);
+    }
+
+    void replayRosbagPointclouds(benchmark::State& state) {
+        replayRosbag<sensor_msgs::PointCloud2, halcon_bridge::HalconPointcloudPtr>(state, createPointcloud);
+    }
+#endif
+
+}
+
+BENCHMARK(replayCaptureImages)->Unit(benchmark::kMillisecond);
+BENCHMARK(replayCapturePointclouds)->Unit(benchmark::kMillisecond);
+#ifdef HALCON_BRIDGE_HAVE_ROSBAG
+BENCHMARK(replayRosbagImages)->Unit(benchmark::kMillisecond);
+BENCHMARK(replayRosbagPointclouds)->Unit(benchmark::kMillisecond);
+#endif
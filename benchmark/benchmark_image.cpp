@@ -0,0 +1,156 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <sensor_msgs/image_encodings.h>
+#include <benchmark/benchmark.h>
+#include "allocation_counter.h"
+#include "kernel_dispatch.h"
+
+#include <string>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    sensor_msgs::Image createImage(const std::string& encoding, uint32_t width, uint32_t height) {
+        sensor_msgs::Image image;
+        image.encoding = encoding;
+        image.width = width;
+        image.height = height;
+        image.is_bigendian = false;
+        image.step = width * enc::numChannels(encoding) * (enc::bitDepth(encoding) / 8);
+        image.data.resize((size_t)image.step * height);
+        for (size_t i = 0; i < image.data.size(); i++) {
+            image.data[i] = (uint8_t)(i * 7 + i / 5);
+        }
+        return image;
+    }
+
+    void setCounters(benchmark::State& state, size_t bytes, unsigned long allocations) {
+        state.SetBytesProcessed(state.iterations() * bytes);
+        state.counters["allocs/call"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+    }
+
+    void imageToHalcon(benchmark::State& state, const std::string& encoding) {
+        sensor_msgs::Image source = createImage(encoding, state.range(0), state.range(1));
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(source);
+            benchmark::DoNotOptimize(image->image);
+        }
+        setCounters(state, source.data.size(), halcon_bridge::test::getAllocationCount() - allocations);
+    }
+
+    void imageToMsg(benchmark::State& state, const std::string& encoding) {
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createImage(encoding, state.range(0), state.range(1)));
+        size_t bytes = 0;
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            sensor_msgs::ImagePtr message = image->toImageMsg();
+            bytes = message->data.size();
+            benchmark::DoNotOptimize(message->data[0]);
+        }
+        setCounters(state, bytes, halcon_bridge::test::getAllocationCount() - allocations);
+    }
+
+    // Export of a color image with the interleave kernels restricted to one variant, state.range(2) indexes
+    // getKernelVariants() and 0 is the scalar reference.
+    void imageToMsgVariant(benchmark::State& state, const std::string& encoding) {
+        std::vector<halcon_bridge::KernelVariant> variants = halcon_bridge::getKernelVariants();
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createImage(encoding, state.range(0), state.range(1)));
+        halcon_bridge::KernelVariant selected = halcon_bridge::getKernelVariant();
+        halcon_bridge::setKernelVariant(variants[state.range(2)]);
+        sensor_msgs::Image message;
+        for (auto _ : state) {
+            image->toImageMsg(message);
+            benchmark::DoNotOptimize(message.data[0]);
+        }
+        halcon_bridge::setKernelVariant(selected);
+        state.SetBytesProcessed(state.iterations() * message.data.size());
+    }
+
+#ifndef HALCON_BRIDGE_STAND_IN
+    // The operator chain toImageMsg used before the interleave kernels, as the baseline of their speedup. Only
+    // built against HALCON, the stand-in does not implement these operators.
+    void imageToMsgOperatorChain(benchmark::State& state) {
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createImage(enc::RGB8, state.range(0), state.range(1)));
+        Hlong width = state.range(0), height = state.range(1);
+        sensor_msgs::Image message;
+        for (auto _ : state) {
+            HalconCpp::HImage interleaved("byte", width * 3, height);
+            HalconCpp::HHomMat2D scale;
+            scale = scale.HomMat2dScale(1, 3, 0, 0);
+            HalconCpp::HImage transformed = image->image->AffineTransImageSize(scale, "constant", width * 3, height);
+            HalconCpp::HImage red, green, blue;
+            red = transformed.Decompose3(&green, &blue);
+            HalconCpp::HRegion grid;
+            grid.GenGridRegion(2 * height, 3, "lines", width * 3, height + 1);
+            red = red.ReduceDomain(grid.MoveRegion(-1, 0).ClipRegion(0, 0, height - 1, 3 * width - 1));
+            green = green.ReduceDomain(grid.MoveRegion(-1, 1).ClipRegion(0, 0, height - 1, 3 * width - 1));
+            blue = blue.ReduceDomain(grid.MoveRegion(-1, 2).ClipRegion(0, 0, height - 1, 3 * width - 1));
+            interleaved.OverpaintGray(red);
+            interleaved.OverpaintGray(green);
+            interleaved.OverpaintGray(blue);
+            HalconCpp::HString type;
+            Hlong data_width, data_height;
+            const uint8_t* data = (const uint8_t*)interleaved.GetImagePointer1(&type, &data_width, &data_height);
+            message.data.assign(data, data + width * height * 3);
+            benchmark::DoNotOptimize(message.data[0]);
+        }
+        state.SetBytesProcessed(state.iterations() * message.data.size());
+    }
+#endif
+
+    void addResolutions(benchmark::internal::Benchmark* benchmark) {
+        benchmark->ArgNames({ "width", "height" });
+        benchmark->Args({ 640, 480 });
+        benchmark->Args({ 1920, 1080 });
+        benchmark->Args({ 2592, 1944 });
+        benchmark->Unit(benchmark::kMicrosecond);
+    }
+
+    void addResolutionsAndVariants(benchmark::internal::Benchmark* benchmark) {
+        benchmark->ArgNames({ "width", "height", "variant" });
+        for (size_t variant = 0; variant < halcon_bridge::getKernelVariants().size(); variant++) {
+            benchmark->Args({ 640, 480, (int64_t)variant });
+            benchmark->Args({ 2592, 1944, (int64_t)variant });
+        }
+        benchmark->Unit(benchmark::kMicrosecond);
+    }
+
+}
+
+BENCHMARK_CAPTURE(imageToHalcon, mono8, enc::MONO8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToHalcon, mono16, enc::MONO16)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToHalcon, rgb8, enc::RGB8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToHalcon, bgra8, enc::BGRA8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToHalcon, rgb16, enc::RGB16)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToHalcon, bayer_rggb8, enc::BAYER_RGGB8)->Apply(addResolutions);
+
+BENCHMARK_CAPTURE(imageToMsg, mono8, enc::MONO8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToMsg, mono16, enc::MONO16)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToMsg, rgb8, enc::RGB8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToMsg, bgra8, enc::BGRA8)->Apply(addResolutions);
+BENCHMARK_CAPTURE(imageToMsg, rgb16, enc::RGB16)->Apply(addResolutions);
+
+BENCHMARK_CAPTURE(imageToMsgVariant, rgb8, enc::RGB8)->Apply(addResolutionsAndVariants);
+BENCHMARK_CAPTURE(imageToMsgVariant, bgra8, enc::BGRA8)->Apply(addResolutionsAndVariants);
+BENCHMARK_CAPTURE(imageToMsgVariant, rgb16, enc::RGB16)->Apply(addResolutionsAndVariants);
+#ifndef HALCON_BRIDGE_STAND_IN
+BENCHMARK(imageToMsgOperatorChain)->Apply(addResolutions);
+#endif
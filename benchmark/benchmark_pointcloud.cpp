@@ -0,0 +1,255 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/buffer_pool.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <sensor_msgs/PointField.h>
+#include <benchmark/benchmark.h>
+#include "allocation_counter.h"
+#include "cloud_kernels.h"
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+    enum Layout {
+        XYZ,
+        XYZI,
+        XYZRGB,
+        NORMAL,
+        XYZRGB_NORMAL,
+        /// Fields of an Ouster lidar driver, read field by field
+        OUSTER
+    };
+
+    void addField(sensor_msgs::PointCloud2& cloud, const char* name, uint32_t offset,
+                  uint8_t datatype = sensor_msgs::PointField::FLOAT32) {
+        sensor_msgs::PointField field;
+        field.name = name;
+        field.offset = offset;
+        field.datatype = datatype;
+        field.count = 1;
+        cloud.fields.push_back(field);
+    }
+
+    sensor_msgs::PointCloud2 createCloud(Layout layout, uint32_t points) {
+        sensor_msgs::PointCloud2 cloud;
+        cloud.width = points;
+        cloud.height = 1;
+        cloud.is_bigendian = false;
+        cloud.is_dense = true;
+        addField(cloud, "x", 0);
+        addField(cloud, "y", 4);
+        addField(cloud, "z", 8);
+        switch (layout) {
+            case XYZ:
+                cloud.point_step = 16;
+                break;
+            case XYZI:
+                addField(cloud, "intensity", 16);
+                cloud.point_step = 32;
+                break;
+            case XYZRGB:
+                addField(cloud, "rgb", 16);
+                cloud.point_step = 32;
+                break;
+            case NORMAL:
+                addField(cloud, "normal_x", 16);
+                addField(cloud, "normal_y", 20);
+                addField(cloud, "normal_z", 24);
+                addField(cloud, "curvature", 32);
+                cloud.point_step = 48;
+                break;
+            case XYZRGB_NORMAL:
+                addField(cloud, "normal_x", 16);
+                addField(cloud, "normal_y", 20);
+                addField(cloud, "normal_z", 24);
+                addField(cloud, "rgb", 32);
+                addField(cloud, "curvature", 36);
+                cloud.point_step = 48;
+                break;
+            case OUSTER:
+                addField(cloud, "intensity", 16);
+                addField(cloud, "t", 20, sensor_msgs::PointField::UINT32);
+                addField(cloud, "reflectivity", 24, sensor_msgs::PointField::UINT16);
+                addField(cloud, "ring", 26, sensor_msgs::PointField::UINT8);
+                addField(cloud, "ambient", 28, sensor_msgs::PointField::UINT16);
+                addField(cloud, "range", 32, sensor_msgs::PointField::UINT32);
+                cloud.point_step = 48;
+                break;
+        }
+        cloud.row_step = points * cloud.point_step;
+        cloud.data.resize(cloud.row_step);
+        for (uint32_t i = 0; i < points; i++) {
+            uint8_t* point = &cloud.data[(size_t)i * cloud.point_step];
+            for (uint32_t offset = 0; offset < cloud.point_step; offset += sizeof(float)) {
+                float value = (float)(i % 1000) * 0.01f + offset;
+                memcpy(point + offset, &value, sizeof(value));
+            }
+        }
+        return cloud;
+    }
+
+    void setCounters(benchmark::State& state, size_t points, unsigned long allocations) {
+        state.counters["points/s"] = benchmark::Counter(points, benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["allocs/call"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+    }
+
+    void pointcloudToHalcon(benchmark::State& state, Layout layout) {
+        sensor_msgs::PointCloud2 source = createCloud(layout, state.range(0));
+        halcon_bridge::PointCloudLayoutCache layout_cache;
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source, layout_cache);
+            benchmark::DoNotOptimize(pointcloud->model);
+        }
+        state.SetBytesProcessed(state.iterations() * source.data.size());
+        setCounters(state, source.width, halcon_bridge::test::getAllocationCount() - allocations);
+    }
+
+    // Same as pointcloudToHalcon, but the fields are scanned again for every message.
+    void pointcloudToHalconUncached(benchmark::State& state, Layout layout) {
+        sensor_msgs::PointCloud2 source = createCloud(layout, state.range(0));
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source);
+            benchmark::DoNotOptimize(pointcloud->model);
+        }
+        state.SetBytesProcessed(state.iterations() * source.data.size());
+        setCounters(state, source.width, halcon_bridge::test::getAllocationCount() - allocations);
+    }
+
+    // Gathers all fields of a PCL layout, with the compile-time offsets of gatherFixedLayout or, if generic is set,
+    // field by field with runtime offsets as for unknown layouts.
+    void gatherPoints(benchmark::State& state, Layout layout, bool generic) {
+        const halcon_bridge::PointLayout point_layouts[] = { halcon_bridge::POINT_LAYOUT_XYZ, halcon_bridge::POINT_LAYOUT_XYZI,
+                                                             halcon_bridge::POINT_LAYOUT_XYZRGB, halcon_bridge::POINT_LAYOUT_NORMAL,
+                                                             halcon_bridge::POINT_LAYOUT_XYZRGB_NORMAL };
+        sensor_msgs::PointCloud2 source = createCloud(layout, state.range(0));
+        size_t count = source.width;
+        std::vector<float> arrays(11 * count);
+        float* x = &arrays[0];
+        float* a = x + 3 * count;
+        halcon_bridge::PointAttributes attributes = { a, a + count, a + 2 * count, a + 3 * count, a + 4 * count, a + 5 * count,
+                                                      a + 6 * count, a + 7 * count };
+        for (auto _ : state) {
+            if (!generic) {
+                halcon_bridge::gatherFixedLayout(point_layouts[layout], &source.data[0], count, x, x + count, x + 2 * count, attributes);
+            } else {
+                halcon_bridge::gatherXYZ(&source.data[0], source.point_step, count, 0, 4, 8, x, x + count, x + 2 * count);
+                for (size_t i = 3; i < source.fields.size(); i++) {
+                    const sensor_msgs::PointField& field = source.fields[i];
+                    if (field.name == "rgb") {
+                        halcon_bridge::unpackColors(&source.data[0], source.point_step, count, field.offset,
+                                                    attributes.red, attributes.green, attributes.blue);
+                    } else {
+                        halcon_bridge::gatherField(&source.data[0], source.point_step, count, field.offset, field.datatype,
+                                                   a + (i - 3) * count);
+                    }
+                }
+            }
+            benchmark::DoNotOptimize(arrays[0]);
+        }
+        state.SetBytesProcessed(state.iterations() * source.data.size());
+        state.counters["points/s"] = benchmark::Counter(count, benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    void gatherFixed(benchmark::State& state, Layout layout) {
+        gatherPoints(state, layout, false);
+    }
+
+    void gatherGeneric(benchmark::State& state, Layout layout) {
+        gatherPoints(state, layout, true);
+    }
+
+    void pointcloudToMsg(benchmark::State& state, Layout layout) {
+        halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(createCloud(layout, state.range(0)));
+        size_t bytes = 0;
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            sensor_msgs::PointCloud2Ptr message = pointcloud->toPointcloudMsg();
+            bytes = message->data.size();
+            benchmark::DoNotOptimize(message->data[0]);
+        }
+        state.SetBytesProcessed(state.iterations() * bytes);
+        setCounters(state, state.range(0), halcon_bridge::test::getAllocationCount() - allocations);
+    }
+
+    // Steady-state export with recycled messages, which should neither allocate nor miss the pool.
+    void pointcloudToMsgPooled(benchmark::State& state, Layout layout) {
+        halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(createCloud(layout, state.range(0)));
+        bool enabled = halcon_bridge::isBufferPoolEnabled();
+        halcon_bridge::setBufferPoolEnabled(true);
+        pointcloud->toPointcloudMsg();
+        size_t bytes = 0;
+        unsigned long misses = halcon_bridge::getPointcloudBufferPoolStats().misses;
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (auto _ : state) {
+            sensor_msgs::PointCloud2Ptr message = pointcloud->toPointcloudMsg();
+            bytes = message->data.size();
+            benchmark::DoNotOptimize(message->data[0]);
+        }
+        allocations = halcon_bridge::test::getAllocationCount() - allocations;
+        misses = halcon_bridge::getPointcloudBufferPoolStats().misses - misses;
+        halcon_bridge::setBufferPoolEnabled(enabled);
+        state.SetBytesProcessed(state.iterations() * bytes);
+        setCounters(state, state.range(0), allocations);
+        state.counters["misses/call"] = benchmark::Counter(misses, benchmark::Counter::kAvgIterations);
+    }
+
+    void addPointCounts(benchmark::internal::Benchmark* benchmark) {
+        benchmark->ArgName("points");
+        benchmark->Arg(10000);
+        benchmark->Arg(300000);
+        benchmark->Arg(1000000);
+        benchmark->Unit(benchmark::kMicrosecond);
+    }
+
+}
+
+BENCHMARK_CAPTURE(pointcloudToHalcon, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalcon, xyzi, XYZI)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalcon, xyzrgb, XYZRGB)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalcon, normal, NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalcon, xyzrgb_normal, XYZRGB_NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalcon, ouster, OUSTER)->Apply(addPointCounts);
+
+BENCHMARK_CAPTURE(pointcloudToHalconUncached, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToHalconUncached, xyzrgb_normal, XYZRGB_NORMAL)->Apply(addPointCounts);
+
+BENCHMARK_CAPTURE(gatherFixed, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherGeneric, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherFixed, xyzi, XYZI)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherGeneric, xyzi, XYZI)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherFixed, xyzrgb, XYZRGB)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherGeneric, xyzrgb, XYZRGB)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherFixed, normal, NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherGeneric, normal, NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherFixed, xyzrgb_normal, XYZRGB_NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(gatherGeneric, xyzrgb_normal, XYZRGB_NORMAL)->Apply(addPointCounts);
+
+BENCHMARK_CAPTURE(pointcloudToMsg, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsg, xyzrgb, XYZRGB)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsg, normal, NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsg, ouster, OUSTER)->Apply(addPointCounts);
+
+BENCHMARK_CAPTURE(pointcloudToMsgPooled, xyz, XYZ)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsgPooled, xyzrgb, XYZRGB)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsgPooled, normal, NORMAL)->Apply(addPointCounts);
+BENCHMARK_CAPTURE(pointcloudToMsgPooled, ouster, OUSTER)->Apply(addPointCounts);
@@ -0,0 +1,96 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include <asr_halcon_bridge/halcon_image.h>
+#include <sensor_msgs/image_encodings.h>
+#include <benchmark/benchmark.h>
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    // Runs a benchmark with state.range(0) conversion threads and every conversion split, restoring the
+    // settings afterwards. The work is done on other threads, so the benchmarks report wall-clock time.
+    class ConversionThreads {
+        public:
+            explicit ConversionThreads(benchmark::State& state) :
+                threads_(halcon_bridge::getConversionThreads()), threshold_(halcon_bridge::getParallelConversionThreshold()) {
+                halcon_bridge::setConversionThreads(state.range(0));
+                halcon_bridge::setParallelConversionThreshold(0);
+            }
+
+            ~ConversionThreads() {
+                halcon_bridge::setConversionThreads(threads_);
+                halcon_bridge::setParallelConversionThreshold(threshold_);
+            }
+
+        private:
+            unsigned int threads_;
+            size_t threshold_;
+    };
+
+    void parallelForScaling(benchmark::State& state) {
+        ConversionThreads threads(state);
+        std::vector<float> source(16 << 20), destination(source.size());
+        for (size_t i = 0; i < source.size(); i++) source[i] = (float)i;
+        size_t bytes = source.size() * sizeof(float) * 2;
+        for (auto _ : state) {
+            halcon_bridge::parallelFor(source.size(), bytes, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) destination[i] = source[i] * 0.5f + 1.0f;
+            });
+            benchmark::DoNotOptimize(destination[0]);
+        }
+        state.SetBytesProcessed(state.iterations() * bytes);
+    }
+
+    void imageToHalconScaling(benchmark::State& state, const std::string& encoding) {
+        ConversionThreads threads(state);
+        sensor_msgs::Image source;
+        source.encoding = encoding;
+        source.width = 2592;
+        source.height = 1944;
+        source.is_bigendian = false;
+        source.step = source.width * enc::numChannels(encoding) * (enc::bitDepth(encoding) / 8);
+        source.data.resize((size_t)source.step * source.height);
+        for (size_t i = 0; i < source.data.size(); i++) source.data[i] = (uint8_t)(i * 7 + i / 5);
+        for (auto _ : state) {
+            halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(source);
+            benchmark::DoNotOptimize(image->image);
+        }
+        state.SetBytesProcessed(state.iterations() * source.data.size());
+    }
+
+    // 1 to N threads, N being the number of hardware threads but at least 4
+    void addThreadCounts(benchmark::internal::Benchmark* benchmark) {
+        benchmark->ArgName("threads");
+        benchmark->DenseRange(1, std::max(4u, std::thread::hardware_concurrency()));
+        benchmark->UseRealTime();
+        benchmark->Unit(benchmark::kMicrosecond);
+    }
+
+}
+
+BENCHMARK(parallelForScaling)->Apply(addThreadCounts);
+BENCHMARK_CAPTURE(imageToHalconScaling, rgb8, enc::RGB8)->Apply(addThreadCounts);
+BENCHMARK_CAPTURE(imageToHalconScaling, bgra8, enc::BGRA8)->Apply(addThreadCounts);
@@ -0,0 +1,322 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_ASYNC_CONVERTER_H
+#define ASR_HALCON_BRIDGE_ASYNC_CONVERTER_H
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief What an AsyncConverter does with a message when its queue is full.
+     */
+    enum AsyncQueuePolicy {
+        /// Drop the oldest queued message, so the newest ones are converted and latency stays bounded
+        KEEP_LATEST,
+        /// Block the producer until there is room, no message is lost
+        KEEP_ALL
+    };
+
+    struct AsyncConverterOptions {
+        /// Number of messages waiting for a worker, at least 1
+        size_t queue_size;
+        AsyncQueuePolicy policy;
+        /// Number of worker threads of the converter. With more than one, results may be delivered out of order.
+        unsigned int threads;
+
+        AsyncConverterOptions() : queue_size(1), policy(KEEP_LATEST), threads(1) {}
+    };
+
+    /**
+     * \brief Latency of one stage of an asynchronous conversion in seconds.
+     *
+     * The percentiles are estimated from a histogram with power-of-two bins, like the conversion statistics.
+     */
+    struct AsyncStageLatency {
+        double p50;
+        double p99;
+        double max;
+    };
+
+    /**
+     * \brief Counters of an AsyncConverter since its creation or the last reset.
+     */
+    struct AsyncConverterStats {
+        /// Messages accepted into the queue
+        unsigned long accepted;
+        /// Messages converted and delivered
+        unsigned long delivered;
+        /// Messages whose conversion or delivery threw
+        unsigned long failed;
+        /// Messages dropped by the KEEP_LATEST policy or at shutdown
+        unsigned long dropped;
+        /// Messages waiting in the queue right now
+        size_t queued;
+        /// Time from push until a worker takes the message
+        AsyncStageLatency queue;
+        /// Time of the conversion itself
+        AsyncStageLatency conversion;
+        /// Time spent in the callback or fulfilling the future
+        AsyncStageLatency delivery;
+        /// Time from push until delivery finished
+        AsyncStageLatency total;
+    };
+
+
+    /**
+     * \brief Bounded queue with its own worker threads, the untyped core of AsyncConverter.
+     */
+    class AsyncConversionQueue : boost::noncopyable {
+        public:
+            typedef boost::function<void()> Delivery;
+            /// Converts a message and returns how to deliver the result, may throw
+            typedef boost::function<Delivery()> Conversion;
+            /// Called with the exception of a failed conversion, or with an empty pointer if the message was dropped
+            typedef boost::function<void(const std::exception_ptr&)> Failure;
+
+            explicit AsyncConversionQueue(const AsyncConverterOptions& options);
+
+            /**
+             * \brief Drop the queued messages and wait for the running conversions.
+             */
+            ~AsyncConversionQueue();
+
+            /**
+             * \brief Queue a conversion according to the policy.
+             *
+             * \return false if the queue was shut down, the conversion is not run then
+             */
+            bool push(const Conversion& conversion, const Failure& failure);
+
+            /**
+             * \brief Wait until the queue is empty and no conversion is running.
+             */
+            void flush();
+
+            /**
+             * \brief Drop the queued messages, wait for the running conversions and stop the workers.
+             *
+             * May be called from a conversion or callback, the conversion running on the calling worker is then not
+             * waited for.
+             */
+            void shutdown();
+
+            AsyncConverterStats getStats() const;
+            void resetStats();
+
+        private:
+            struct State;
+
+            std::shared_ptr<State> state_;
+    };
+
+
+    /**
+     * \brief Default conversion of an AsyncConverter, specialized for the message pairs of the bridge.
+     */
+    template<typename Input, typename Output>
+    struct AsyncConversionTraits;
+
+    template<>
+    struct AsyncConversionTraits<sensor_msgs::Image, HalconImage> {
+        static HalconImagePtr convert(const sensor_msgs::Image& message) {
+            return toHalconCopy(message);
+        }
+    };
+
+    template<>
+    struct AsyncConversionTraits<sensor_msgs::PointCloud2, HalconPointcloud> {
+        static HalconPointcloudPtr convert(const sensor_msgs::PointCloud2& message) {
+            return toHalconCopy(message);
+        }
+    };
+
+    template<>
+    struct AsyncConversionTraits<HalconImage, sensor_msgs::Image> {
+        static sensor_msgs::ImagePtr convert(const HalconImage& message) {
+            return message.toImageMsg();
+        }
+    };
+
+    template<>
+    struct AsyncConversionTraits<HalconPointcloud, sensor_msgs::PointCloud2> {
+        static sensor_msgs::PointCloud2Ptr convert(const HalconPointcloud& message) {
+            return message.toPointcloudMsg();
+        }
+    };
+
+
+    /**
+     * \brief Converts messages on worker threads, so a subscriber callback only has to queue them.
+     *
+     * push() hands the result to the callback, submit() returns a future instead. Both run on the worker threads
+     * of the converter. The queue is bounded, with KEEP_LATEST a burst of messages drops the oldest waiting ones
+     * instead of delaying all later messages. Conversions of different converters may run at the same time; only
+     * one of them is split across the shared conversion threads, the others run on their worker alone.
+     *
+     * Use a custom conversion to pass options or a PointCloudLayoutCache, e.g. with boost::bind.
+     */
+    template<typename Input, typename Output>
+    class AsyncConverter : boost::noncopyable {
+        public:
+            typedef boost::shared_ptr<Input const> InputConstPtr;
+            typedef boost::shared_ptr<Output> OutputPtr;
+            typedef boost::function<OutputPtr(const Input&)> Conversion;
+            typedef boost::function<void(const OutputPtr&)> Callback;
+            typedef boost::function<void(const InputConstPtr&, const std::string&)> ErrorCallback;
+
+            explicit AsyncConverter(const AsyncConverterOptions& options = AsyncConverterOptions()) :
+                conversion_(&AsyncConversionTraits<Input, Output>::convert), queue_(options) {
+            }
+
+            explicit AsyncConverter(const Conversion& conversion, const AsyncConverterOptions& options = AsyncConverterOptions()) :
+                conversion_(conversion), queue_(options) {
+            }
+
+            /**
+             * \brief Set the callback that receives the results of push().
+             */
+            void setCallback(const Callback& callback) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                callback_ = callback;
+            }
+
+            /**
+             * \brief Set the callback that receives the error message of every failed conversion started by push().
+             */
+            void setErrorCallback(const ErrorCallback& callback) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_callback_ = callback;
+            }
+
+            /**
+             * \brief Queue a message for conversion, the result is passed to the callback.
+             *
+             * \return false if the converter was shut down
+             */
+            bool push(const InputConstPtr& message) {
+                return queue_.push([this, message]() -> AsyncConversionQueue::Delivery {
+                                       OutputPtr result = conversion_(*message);
+                                       return [this, result]() { deliver(result); };
+                                   },
+                                   [this, message](const std::exception_ptr& error) { fail(message, error); });
+            }
+
+            /**
+             * \brief Queue a message for conversion and get a future of the result.
+             *
+             * The future throws the exception of a failed conversion, or an Exception if the message was dropped.
+             */
+            std::future<OutputPtr> submit(const InputConstPtr& message) {
+                std::shared_ptr<std::promise<OutputPtr> > promise = std::make_shared<std::promise<OutputPtr> >();
+                std::future<OutputPtr> future = promise->get_future();
+                bool queued = queue_.push([this, message, promise]() -> AsyncConversionQueue::Delivery {
+                                              OutputPtr result = conversion_(*message);
+                                              return [promise, result]() { promise->set_value(result); };
+                                          },
+                                          [promise](const std::exception_ptr& error) {
+                                              promise->set_exception(error ? error : getDroppedError());
+                                          });
+                if (!queued) {
+                    promise->set_exception(getDroppedError());
+                }
+                return future;
+            }
+
+            /**
+             * \brief Wait until every queued message was converted and delivered.
+             */
+            void flush() {
+                queue_.flush();
+            }
+
+            /**
+             * \brief Drop the queued messages and stop the workers, later messages are rejected.
+             */
+            void shutdown() {
+                queue_.shutdown();
+            }
+
+            AsyncConverterStats getStats() const {
+                return queue_.getStats();
+            }
+
+            void resetStats() {
+                queue_.resetStats();
+            }
+
+        private:
+            static std::exception_ptr getDroppedError() {
+                return std::make_exception_ptr(Exception("Message was dropped before it was converted"));
+            }
+
+            void deliver(const OutputPtr& result) {
+                Callback callback;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    callback = callback_;
+                }
+                if (callback) {
+                    callback(result);
+                }
+            }
+
+            void fail(const InputConstPtr& message, const std::exception_ptr& error) {
+                ErrorCallback callback;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    callback = error_callback_;
+                }
+                if (!error || !callback) {
+                    return;
+                }
+                try {
+                    std::rethrow_exception(error);
+                } catch (const HalconCpp::HException& e) {
+                    callback(message, (const char*)e.ErrorMessage());
+                } catch (const std::exception& e) {
+                    callback(message, e.what());
+                } catch (...) {
+                    callback(message, "Unknown error");
+                }
+            }
+
+            Conversion conversion_;
+            std::mutex mutex_;
+            Callback callback_;
+            ErrorCallback error_callback_;
+            // declared last, so the workers are stopped before the callbacks they use are destroyed
+            AsyncConversionQueue queue_;
+    };
+
+    typedef AsyncConverter<sensor_msgs::Image, HalconImage> AsyncImageConverter;
+    typedef AsyncConverter<sensor_msgs::PointCloud2, HalconPointcloud> AsyncPointcloudConverter;
+    typedef AsyncConverter<HalconImage, sensor_msgs::Image> AsyncImageMsgConverter;
+    typedef AsyncConverter<HalconPointcloud, sensor_msgs::PointCloud2> AsyncPointcloudMsgConverter;
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_BUFFER_POOL_H
+#define ASR_HALCON_BRIDGE_BUFFER_POOL_H
+
+#include <stddef.h>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Counters of a buffer pool.
+     */
+    struct BufferPoolStats {
+        /// Requests served from a recycled buffer
+        unsigned long hits;
+        /// Requests that needed a new allocation
+        unsigned long misses;
+        /// Buffers currently waiting for reuse
+        size_t cached_buffers;
+        /// Bytes currently held by the waiting buffers
+        size_t cached_bytes;
+    };
+
+    /**
+     * \brief Enable or disable recycling of conversion buffers.
+     *
+     * When enabled, the planes of images created by toHalconCopy are returned to a pool when the HImage is
+     * released, and reused for the next image of the same size. The same applies to the scratch buffers of point
+     * cloud conversions and to the messages returned by toImageMsg() and toPointcloudMsg(), which keep their data
+     * capacity. Disabled by default. Disabling frees all cached buffers.
+     */
+    void setBufferPoolEnabled(bool enabled);
+
+    /**
+     * \brief Check whether conversion buffers are recycled.
+     */
+    bool isBufferPoolEnabled();
+
+    /**
+     * \brief Set the number of bytes each pool may keep for reuse, default is 256 MB.
+     *
+     * Buffers that are released while a pool is full are freed.
+     */
+    void setBufferPoolCapacity(size_t bytes);
+
+    /**
+     * \brief Get the counters of the pool for image planes and image messages.
+     */
+    BufferPoolStats getImageBufferPoolStats();
+
+    /**
+     * \brief Get the counters of the pool for point cloud buffers and point cloud messages.
+     */
+    BufferPoolStats getPointcloudBufferPoolStats();
+
+    /**
+     * \brief Free all cached buffers and reset the counters.
+     */
+    void clearBufferPools();
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_CONVERSION_SCHEDULER_H
+#define ASR_HALCON_BRIDGE_CONVERSION_SCHEDULER_H
+
+#include <stddef.h>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Set the number of threads used to convert large images and point clouds.
+     *
+     * Images are split into bands of rows and point clouds into ranges of points. The calling thread takes part
+     * in every conversion, so 1 disables the worker pool. 0 selects the number of hardware threads, which is also
+     * the default.
+     *
+     * \param threads   Number of threads per conversion, including the calling thread
+     */
+    void setConversionThreads(unsigned int threads);
+
+    /**
+     * \brief Get the number of threads used to convert large images and point clouds.
+     */
+    unsigned int getConversionThreads();
+
+    /**
+     * \brief Set the amount of data below which a conversion runs on the calling thread only.
+     *
+     * \param bytes   Size of the converted data in bytes, default is 1 MB
+     */
+    void setParallelConversionThreshold(size_t bytes);
+
+    /**
+     * \brief Get the amount of data below which a conversion runs on the calling thread only.
+     */
+    size_t getParallelConversionThreshold();
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_CONVERSION_STATS_H
+#define ASR_HALCON_BRIDGE_CONVERSION_STATS_H
+
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Conversion functions with separate statistics.
+     */
+    enum ConversionFunction {
+        /// toHalconCopy for sensor_msgs::Image
+        IMAGE_TO_HALCON,
+        /// toHalconShare for sensor_msgs::Image
+        IMAGE_SHARE_TO_HALCON,
+        /// HalconImage::toImageMsg
+        HALCON_TO_IMAGE,
+        /// toHalconCopy for sensor_msgs::PointCloud2
+        POINTCLOUD_TO_HALCON,
+        /// HalconPointcloud::toPointcloudMsg
+        HALCON_TO_POINTCLOUD,
+        /// toHalconCopy for sensor_msgs::CompressedImage
+        COMPRESSED_IMAGE_TO_HALCON,
+        /// toCompressedImageMsg
+        HALCON_TO_COMPRESSED_IMAGE,
+        /// toHalconDepth
+        DEPTH_IMAGE_TO_HALCON,
+        /// toHalconPointcloud for depth images
+        DEPTH_IMAGE_TO_POINTCLOUD,
+        /// toHalconCopy for batches of sensor_msgs::Image, the single images are also counted as IMAGE_TO_HALCON
+        IMAGE_BATCH_TO_HALCON,
+        /// toHalconCopy for stereo_msgs::DisparityImage
+        DISPARITY_IMAGE_TO_HALCON,
+        /// HalconDisparityImage::toDisparityMsg
+        HALCON_TO_DISPARITY_IMAGE,
+        /// toHalconPointcloud for disparity images
+        DISPARITY_IMAGE_TO_POINTCLOUD,
+        CONVERSION_FUNCTION_COUNT
+    };
+
+    /**
+     * \brief Counters of a conversion function since the start of the process or the last reset.
+     */
+    struct ConversionStats {
+        /// Name of the conversion function
+        const char* function;
+        /// Number of completed calls
+        unsigned long calls;
+        /// Bytes of message data read or written
+        unsigned long long bytes;
+        /// Result objects, messages and pooled buffers allocated by the bridge, including those of worker threads, and
+        /// message buffers that had to grow. Scratch rows inside a conversion and allocations inside Halcon are not
+        /// included.
+        unsigned long allocations;
+        /// Latency percentiles in seconds, estimated from a histogram with power-of-two bins
+        double p50_latency;
+        double p99_latency;
+        /// Highest latency in seconds
+        double max_latency;
+    };
+
+    /**
+     * \brief Check whether the bridge was compiled with instrumentation (CMake option HALCON_BRIDGE_STATS).
+     *
+     * Without instrumentation all counters stay zero.
+     */
+    bool isConversionStatsEnabled();
+
+    /**
+     * \brief Get the counters of a single conversion function.
+     */
+    ConversionStats getConversionStats(ConversionFunction function);
+
+    /**
+     * \brief Get the counters of all conversion functions, indexed by ConversionFunction.
+     */
+    std::vector<ConversionStats> getConversionStats();
+
+    /**
+     * \brief Reset all counters to zero.
+     */
+    void resetConversionStats();
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_CONVERSION_STATS_PUBLISHER_H
+#define ASR_HALCON_BRIDGE_CONVERSION_STATS_PUBLISHER_H
+
+#include <ros/ros.h>
+#include <asr_halcon_bridge/conversion_stats.h>
+
+#include <string>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Publishes the conversion statistics of the bridge as diagnostic_msgs/DiagnosticArray on /diagnostics.
+     *
+     * Every conversion function is reported as a separate DiagnosticStatus. The counters are cumulative, use
+     * resetConversionStats() to start over.
+     */
+    class ConversionStatsPublisher {
+        public:
+            /**
+             * \param nh     The node handle used to advertise the topic and create the timer
+             * \param rate   Publishing rate in Hz, must be positive
+             * \param name   Prefix of the status names, usually the name of the node
+             */
+            ConversionStatsPublisher(ros::NodeHandle& nh, double rate = 1.0, const std::string& name = "halcon_bridge");
+
+            /**
+             * \brief Publish the current statistics immediately.
+             */
+            void publish();
+
+        private:
+            void timerCallback(const ros::TimerEvent& event);
+
+            ros::Publisher publisher_;
+            ros::Timer timer_;
+            std::string name_;
+    };
+
+}
+
+#endif
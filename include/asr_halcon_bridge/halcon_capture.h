@@ -0,0 +1,173 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_CAPTURE_H
+#define ASR_HALCON_BRIDGE_HALCON_CAPTURE_H
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Kind of a record in a capture file.
+     */
+    enum CaptureRecordType {
+        CAPTURE_IMAGE = 1,
+        CAPTURE_POINTCLOUD = 2
+    };
+
+    /**
+     * \brief Position of a record in a capture file, as stored in its index.
+     */
+    struct CaptureIndexEntry {
+        /// Header stamp of the record in nanoseconds
+        int64_t stamp;
+        /// Offset of the record from the start of the file
+        uint64_t offset;
+        uint32_t type;
+        uint32_t reserved;
+    };
+
+
+    /**
+     * \brief Records HalconImages and HalconPointclouds into a capture file that can be replayed without parsing.
+     *
+     * Images are stored as their planes in the Halcon pixel type, point clouds as one float array per
+     * coordinate and attribute. Every array starts at a 64 byte aligned file offset, so a reader can hand the
+     * mapped pages to Halcon directly. The records are streamed to disk as they are written; the index is
+     * appended when the writer is closed. Files that were not closed can still be read, their index is rebuilt by
+     * scanning the records.
+     */
+    class HalconCaptureWriter {
+        public:
+            /**
+             * \brief Create or truncate the capture file.
+             */
+            explicit HalconCaptureWriter(const std::string& path);
+
+            /**
+             * \brief Close the file, writing its index.
+             */
+            ~HalconCaptureWriter();
+
+            /**
+             * \brief Append an image with 1, 3 or 4 channels, including its domain but not its pyramid.
+             */
+            void write(const HalconImage& image);
+
+            /**
+             * \brief Append a point cloud with its normals and extended attributes. Organized point clouds keep their
+             * X/Y/Z images and their domain.
+             */
+            void write(const HalconPointcloud& pointcloud);
+
+            /**
+             * \brief Write the index and close the file, further writes throw.
+             */
+            void close();
+
+            /**
+             * \brief Number of records written so far.
+             */
+            size_t size() const;
+
+        private:
+            HalconCaptureWriter(const HalconCaptureWriter&);
+            HalconCaptureWriter& operator=(const HalconCaptureWriter&);
+
+            void writeData(const void* data, size_t size);
+            void pad();
+
+            std::string path_;
+            FILE* file_;
+            uint64_t offset_;
+            std::vector<CaptureIndexEntry> index_;
+    };
+
+
+    /**
+     * \brief Replays a capture file through a read-only memory mapping.
+     *
+     * Images and X/Y/Z images of point clouds wrap the mapped pages, the mapping stays alive as long as any
+     * object returned by the reader exists. The HImages must not be used after their HalconImage or
+     * HalconPointcloud has been released, use CopyImage if the pixel data has to outlive it. Point cloud models
+     * are created from the mapped arrays, which Halcon copies. A reader may be used by several threads.
+     */
+    class HalconCaptureReader {
+        public:
+            /**
+             * \brief Map the capture file and load its index.
+             */
+            explicit HalconCaptureReader(const std::string& path);
+            ~HalconCaptureReader();
+
+            /**
+             * \brief Number of records in the file.
+             */
+            size_t size() const;
+
+            /**
+             * \brief Kind of record index.
+             */
+            CaptureRecordType getType(size_t index) const;
+
+            /**
+             * \brief Header stamp of record index.
+             */
+            ros::Time getStamp(size_t index) const;
+
+            /**
+             * \brief Find the first record whose stamp is not earlier than stamp, or size() if there is none.
+             *
+             * The index contains a table of evenly spaced time buckets, so a lookup only scans the few records of
+             * one bucket when the stamps are about evenly spaced, as they are for a sensor stream.
+             */
+            size_t seek(const ros::Time& stamp) const;
+
+            /**
+             * \brief Get record index, which must be an image.
+             */
+            HalconImageConstPtr readImage(size_t index) const;
+
+            /**
+             * \brief Get record index, which must be a point cloud.
+             */
+            HalconPointcloudConstPtr readPointcloud(size_t index) const;
+
+        private:
+            HalconCaptureReader(const HalconCaptureReader&);
+            HalconCaptureReader& operator=(const HalconCaptureReader&);
+
+            struct Mapping;
+
+            const uint8_t* getRecord(size_t index, CaptureRecordType type, std_msgs::Header& header) const;
+
+            boost::shared_ptr<Mapping> mapping_;
+            std::vector<CaptureIndexEntry> index_;
+            std::vector<uint32_t> buckets_;
+            int64_t first_stamp_;
+            int64_t bucket_duration_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_COMPRESSED_IMAGE_H
+#define ASR_HALCON_BRIDGE_HALCON_COMPRESSED_IMAGE_H
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <string>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Convert a JPEG or PNG compressed sensor_msgs::CompressedImage message to a Halcon-compatible HImage.
+     *
+     * The format is detected from the data, not from the format field of the message. The pixels are decoded a
+     * few rows at a time and split into the planes of the HImage, the full image is never held in interleaved
+     * form. Gray images become mono8/mono16 images, color images rgb8/rgb16 images, alpha channels are dropped.
+     *
+     * \param source              A sensor_msgs::CompressedImage message
+     * \param scale_denominator   Decode at 1/scale_denominator of the original size, 1, 2, 4 or 8. JPEG images are
+     *                            scaled by the decoder, PNG images by keeping every scale_denominator-th pixel.
+     */
+    HalconImagePtr toHalconCopy(const sensor_msgs::CompressedImage& source, unsigned int scale_denominator = 1);
+
+    /**
+     * \brief Convert a JPEG or PNG compressed sensor_msgs::CompressedImage message to a Halcon-compatible HImage.
+     *
+     * \param source              A shared_ptr to a sensor_msgs::CompressedImage message
+     * \param scale_denominator   Decode at 1/scale_denominator of the original size, 1, 2, 4 or 8
+     */
+    HalconImagePtr toHalconCopy(const sensor_msgs::CompressedImageConstPtr& source, unsigned int scale_denominator = 1);
+
+    /**
+     * \brief Compress a HalconImage into a ROS sensor_msgs::CompressedImage message.
+     *
+     * The rows are interleaved one at a time right before they are handed to the encoder. The format field is
+     * set the way compressed_image_transport does, e.g. "rgb8; jpeg compressed rgb8".
+     *
+     * \param image     Image with one or three channels, JPEG supports 8 bit images only
+     * \param format    "jpeg" or "png"
+     * \param quality   JPEG quality from 1 to 100, or PNG compression level from 0 to 9, out of range values are clamped
+     */
+    sensor_msgs::CompressedImagePtr toCompressedImageMsg(const HalconImage& image, const std::string& format = "jpeg",
+                                                         int quality = 90);
+
+    /**
+     * \brief Compress a HalconImage into an existing ROS sensor_msgs::CompressedImage message.
+     */
+    void toCompressedImageMsg(const HalconImage& image, sensor_msgs::CompressedImage& message,
+                              const std::string& format = "jpeg", int quality = 90);
+
+}
+
+#endif
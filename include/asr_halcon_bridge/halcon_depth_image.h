@@ -0,0 +1,118 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_DEPTH_IMAGE_H
+#define ASR_HALCON_BRIDGE_HALCON_DEPTH_IMAGE_H
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <mutex>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Options of the back-projection of depth images.
+     */
+    struct DepthConversionOptions {
+        /// The depth image is rectified and back-projected with the projection matrix P, like depth_image_proc does.
+        /// Otherwise the camera matrix K is used and the distortion D is removed from the rays.
+        bool rectified;
+        /// Create the HObjectModel3D of the points, otherwise only the X/Y/Z images are filled and model stays NULL.
+        /// Such a point cloud cannot be converted to a PointCloud2 or serialized, which throws halcon_bridge::Exception.
+        bool model;
+
+        DepthConversionOptions() : rectified(true), model(true) {}
+    };
+
+
+    /**
+     * \brief Remembers the ray of every pixel of a camera, so they are only computed again when the calibration changes.
+     *
+     * Use one cache per camera, it may be shared by several threads.
+     */
+    class CameraRayCache {
+        public:
+            struct Rays;
+
+            CameraRayCache();
+            ~CameraRayCache();
+
+            /**
+             * \brief Get the rays of the pixels of an image with the given size, computing them only if the
+             * calibration, the image size or the rectified option differ from the last call.
+             */
+            boost::shared_ptr<const Rays> getRays(const sensor_msgs::CameraInfo& info, size_t width, size_t height, bool rectified);
+
+        private:
+            CameraRayCache(const CameraRayCache&);
+            CameraRayCache& operator=(const CameraRayCache&);
+
+            std::mutex mutex_;
+            sensor_msgs::CameraInfo info_;
+            bool rectified_;
+            boost::shared_ptr<const Rays> rays_;
+    };
+
+
+    /**
+     * \brief Convert a 16UC1 (millimeters) or 32FC1 (meters) depth image to a Halcon real image in meters.
+     *
+     * The domain of the image contains all pixels with a valid depth, pixels with depth 0 or a non-finite depth are
+     * left out. The encoding of the result is 32FC1.
+     *
+     * \param source   A sensor_msgs::Image message with encoding 16UC1, MONO16 or 32FC1
+     */
+    HalconImagePtr toHalconDepth(const sensor_msgs::Image& source);
+
+    /**
+     * \brief Convert a 16UC1 (millimeters) or 32FC1 (meters) depth image to a Halcon real image in meters.
+     *
+     * \param source   A shared_ptr to a sensor_msgs::Image message with encoding 16UC1, MONO16 or 32FC1
+     */
+    HalconImagePtr toHalconDepth(const sensor_msgs::ImageConstPtr& source);
+
+    /**
+     * \brief Back-project a depth image into X/Y/Z images and a HObjectModel3D, without a PointCloud2 in between.
+     *
+     * Every pixel is scaled along its ray from the cache in a single pass. The X/Y/Z images have the size of the
+     * depth image and their domain contains the pixels with a valid depth. The model has an xyz mapping, like the
+     * model of an organized PointCloud2. Coordinates are in meters in the optical frame of the camera.
+     *
+     * \param depth       Depth image with encoding 16UC1, MONO16 or 32FC1
+     * \param info        Calibration of the camera that took the depth image
+     * \param ray_cache   Rays of the camera, reused as long as the calibration does not change
+     * \param options     Calibration to use and whether to create the model
+     */
+    HalconPointcloudPtr toHalconPointcloud(const sensor_msgs::Image& depth, const sensor_msgs::CameraInfo& info,
+                                           CameraRayCache& ray_cache, const DepthConversionOptions& options = DepthConversionOptions());
+
+    /**
+     * \brief Back-project a depth image into X/Y/Z images and a HObjectModel3D, without a PointCloud2 in between.
+     *
+     * \param depth       A shared_ptr to a depth image with encoding 16UC1, MONO16 or 32FC1
+     * \param info        A shared_ptr to the calibration of the camera that took the depth image
+     * \param ray_cache   Rays of the camera, reused as long as the calibration does not change
+     * \param options     Calibration to use and whether to create the model
+     */
+    HalconPointcloudPtr toHalconPointcloud(const sensor_msgs::ImageConstPtr& depth, const sensor_msgs::CameraInfoConstPtr& info,
+                                           CameraRayCache& ray_cache, const DepthConversionOptions& options = DepthConversionOptions());
+
+}
+
+#endif
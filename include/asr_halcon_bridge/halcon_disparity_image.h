@@ -0,0 +1,128 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_DISPARITY_IMAGE_H
+#define ASR_HALCON_BRIDGE_HALCON_DISPARITY_IMAGE_H
+
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <stereo_msgs/DisparityImage.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <halconcpp/HalconCpp.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+
+namespace halcon_bridge {
+
+    class HalconDisparityImage;
+
+    typedef boost::shared_ptr<HalconDisparityImage> HalconDisparityImagePtr;
+    typedef boost::shared_ptr<HalconDisparityImage const> HalconDisparityImageConstPtr;
+
+    /**
+     * \brief Disparity image message class that is interoperable with stereo_msgs/DisparityImage but uses a HImage
+     * representation for the disparities.
+     */
+    class HalconDisparityImage {
+        public:
+            std_msgs::Header header;
+            /// Real image of the disparities in pixels, its domain is the valid window
+            HalconCpp::HImage *image;
+            /// Focal length in pixels and baseline in meters, depth = f * T / disparity
+            float f;
+            float T;
+            sensor_msgs::RegionOfInterest valid_window;
+            /// Searched disparity range, disparities below min_disparity are invalid
+            float min_disparity;
+            float max_disparity;
+            /// Smallest allowed disparity increment
+            float delta_d;
+
+            HalconDisparityImage();
+            ~HalconDisparityImage();
+
+            /**
+             * \brief Convert this message to a stereo_msgs::DisparityImage message with a 32FC1 image.
+             *
+             * The whole image is written, pixels outside the domain keep their values.
+             */
+            stereo_msgs::DisparityImagePtr toDisparityMsg() const;
+
+            /**
+             * \brief Copy the message data to a stereo_msgs::DisparityImage message.
+             */
+            void toDisparityMsg(stereo_msgs::DisparityImage& ros_disparity) const;
+    };
+
+
+    /**
+     * \brief Convert a stereo_msgs::DisparityImage message to a Halcon real image, copying the disparities.
+     *
+     * The valid window becomes the domain of the image, a window of size 0 selects the whole image. f, T and the
+     * disparity range are kept.
+     *
+     * \param source   A stereo_msgs::DisparityImage message with a 32FC1 image
+     */
+    HalconDisparityImagePtr toHalconCopy(const stereo_msgs::DisparityImage& source);
+
+    /**
+     * \brief Convert a stereo_msgs::DisparityImage message to a Halcon real image, copying the disparities.
+     *
+     * \param source   A shared_ptr to a stereo_msgs::DisparityImage message with a 32FC1 image
+     */
+    HalconDisparityImagePtr toHalconCopy(const stereo_msgs::DisparityImageConstPtr& source);
+
+
+    /**
+     * \brief Options of the reprojection of disparity images.
+     */
+    struct DisparityConversionOptions {
+        /// Create the HObjectModel3D of the points, otherwise only the X/Y/Z images are filled and model stays NULL.
+        /// Such a point cloud cannot be converted to a PointCloud2 or serialized, which throws halcon_bridge::Exception.
+        bool model;
+
+        DisparityConversionOptions() : model(true) {}
+    };
+
+    /**
+     * \brief Reproject a disparity image into X/Y/Z images and a HObjectModel3D, without a PointCloud2 in between.
+     *
+     * Every pixel is reprojected in a single pass with depth f * T / disparity, like stereo_image_proc does. The
+     * rectified principal points of the two cameras are assumed to coincide. The X/Y/Z images have the size of
+     * the disparity image and their domain contains the pixels of the valid window with a valid disparity. The
+     * model has an xyz mapping, like the model of an organized PointCloud2. Coordinates are in meters in the
+     * optical frame of the left camera.
+     *
+     * \param disparity   Disparity image with a 32FC1 image
+     * \param info        Calibration of the left camera, its projection matrix P gives the principal point
+     * \param options     Whether to create the model
+     */
+    HalconPointcloudPtr toHalconPointcloud(const stereo_msgs::DisparityImage& disparity, const sensor_msgs::CameraInfo& info,
+                                           const DisparityConversionOptions& options = DisparityConversionOptions());
+
+    /**
+     * \brief Reproject a disparity image into X/Y/Z images and a HObjectModel3D, without a PointCloud2 in between.
+     *
+     * \param disparity   A shared_ptr to a disparity image with a 32FC1 image
+     * \param info        A shared_ptr to the calibration of the left camera
+     * \param options     Whether to create the model
+     */
+    HalconPointcloudPtr toHalconPointcloud(const stereo_msgs::DisparityImageConstPtr& disparity,
+                                           const sensor_msgs::CameraInfoConstPtr& info,
+                                           const DisparityConversionOptions& options = DisparityConversionOptions());
+
+}
+
+#endif
@@ -15,23 +15,51 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 */
 
+#ifndef ASR_HALCON_BRIDGE_HALCON_IMAGE_H
+#define ASR_HALCON_BRIDGE_HALCON_IMAGE_H
+
 #include <sensor_msgs/Image.h>
 #include <halconcpp/HalconCpp.h>
-#include <stdexcept>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace halcon_bridge {
 
-    class Exception: public std::runtime_error {
-        public:
-            Exception(const std::string& description) :
-                std::runtime_error(description) {
-            }
-    };
-
-
     class HalconImage;
 
     typedef boost::shared_ptr<HalconImage> HalconImagePtr;
+    typedef boost::shared_ptr<HalconImage const> HalconImageConstPtr;
+
+    /**
+     * \brief Options that reduce the pixels touched by an image conversion.
+     *
+     * The region of interest is applied first, then the strides, then the pyramid levels.
+     */
+    struct ImageConversionOptions {
+        /// Column and row of the upper left corner of the region to convert
+        unsigned int roi_x;
+        unsigned int roi_y;
+        /// Size of the region, 0 extends the region to the image border
+        unsigned int roi_width;
+        unsigned int roi_height;
+        /// Keep only every column_stride-th column and every row_stride-th row of the region
+        unsigned int column_stride;
+        unsigned int row_stride;
+        /// Number of pyramid levels, each built by averaging 2x2 blocks of the previous one. toHalconCopy stores
+        /// them in HalconImage::pyramid, toImageMsg writes the smallest level instead of the full image.
+        unsigned int pyramid_levels;
+        /// Pad every row of a message to a multiple of this many bytes, only used by toImageMsg
+        unsigned int row_alignment;
+        /// Demosaic bayer_* images into rgb8/rgb16 images, only used by toHalconCopy. Otherwise they are kept as
+        /// single-channel color filter array images, which toHalconShare can wrap without copying.
+        bool demosaic;
+
+        ImageConversionOptions() : roi_x(0), roi_y(0), roi_width(0), roi_height(0), column_stride(1), row_stride(1),
+                                   pyramid_levels(0), row_alignment(1), demosaic(false) {}
+    };
+
 
     /**
      * \brief Image message class that is interoperable with sensor_msgs/Image but uses a HImage representation for the image data.
@@ -44,22 +72,70 @@ namespace halcon_bridge {
             std::string encoding;
             HalconCpp::HImage *image;
 
+            /**
+             * \brief Pyramid levels requested with ImageConversionOptions::pyramid_levels, pyramid[0] has half the
+             * width and height of image.
+             */
+            std::vector<HalconCpp::HImage> pyramid;
+
+            HalconImage();
             ~HalconImage();
 
             /**
              * \brief Convert this message to a ROS sensor_msgs::Image message.
              *
              * The returned sensor_msgs::Image message contains a copy of the image data.
+             *
+             * \param row_alignment   Pad every row of the message to a multiple of this many bytes
              */
-            sensor_msgs::ImagePtr toImageMsg() const;
+            sensor_msgs::ImagePtr toImageMsg(unsigned int row_alignment = 1) const;
 
             /**
              * \brief Copy the message data to a ROS sensor_msgs::Image message.
              *
-             * This overload is intended mainly for aggregate messages such as stereo_msgs::DisparityImage,
-             * which contains a sensor_msgs::Image as a data member.
+             * This overload is intended mainly for aggregate messages that contain a sensor_msgs::Image as a data
+             * member. Disparity images are converted by HalconDisparityImage::toDisparityMsg, which writes 32FC1.
+             *
+             * \param row_alignment   Pad every row of the message to a multiple of this many bytes
+             */
+            void toImageMsg(sensor_msgs::Image& ros_image, unsigned int row_alignment = 1) const;
+
+            /**
+             * \brief Fill all fields of a ROS sensor_msgs::Image message except the image data.
+             *
+             * \param row_alignment   Pad every row of the message to a multiple of this many bytes
+             */
+            void toImageMsgLayout(sensor_msgs::Image& ros_image, unsigned int row_alignment = 1) const;
+
+            /**
+             * \brief Convert a region, a decimated version or a pyramid level of this message to a ROS
+             * sensor_msgs::Image message.
+             *
+             * \param options   Region, strides, pyramid level and row alignment of the message
              */
-            void toImageMsg(sensor_msgs::Image& ros_image) const;
+            sensor_msgs::ImagePtr toImageMsg(const ImageConversionOptions& options) const;
+
+            /**
+             * \brief Copy a region, a decimated version or a pyramid level of this message to a ROS
+             * sensor_msgs::Image message.
+             *
+             * \param options   Region, strides, pyramid level and row alignment of the message
+             */
+            void toImageMsg(sensor_msgs::Image& ros_image, const ImageConversionOptions& options) const;
+
+            /**
+             * \brief Fill all fields of a ROS sensor_msgs::Image message except the image data, for a conversion with
+             * the given options.
+             */
+            void toImageMsgLayout(sensor_msgs::Image& ros_image, const ImageConversionOptions& options) const;
+
+        protected:
+            boost::shared_ptr<void const> tracked_object_;
+
+            friend HalconImageConstPtr toHalconShare(const sensor_msgs::Image& source,
+                                                     const boost::shared_ptr<void const>& tracked_object);
+            friend class HalconCaptureReader;
+            friend struct ros::serialization::Serializer<HalconImage>;
     };
 
 
@@ -67,18 +143,175 @@ namespace halcon_bridge {
      * \brief Convert a sensor_msgs::Image message to a Halcon-compatible HImage, copying the
      * image data.
      *
-     * \param source   A shared_ptr to a sensor_msgs::Image message
+     * \param source    A shared_ptr to a sensor_msgs::Image message
+     * \param options   Region, strides, pyramid levels and demosaicing of the conversion
      */
-    HalconImagePtr toHalconCopy(const sensor_msgs::ImageConstPtr& source);
+    HalconImagePtr toHalconCopy(const sensor_msgs::ImageConstPtr& source, const ImageConversionOptions& options = ImageConversionOptions());
 
     /**
      * \brief Convert a sensor_msgs::Image message to a Halcon-compatible HImage, copying the
      * image data.
      *
-     * \param source   A sensor_msgs::Image message
+     * Rows padded to a step larger than the pixel data are copied one by one. Only the pixels selected by the
+     * options are read and allocated.
+     *
+     * \param source    A sensor_msgs::Image message
+     * \param options   Region, strides, pyramid levels and demosaicing of the conversion
+     */
+    HalconImagePtr toHalconCopy(const sensor_msgs::Image& source, const ImageConversionOptions& options = ImageConversionOptions());
+
+    /**
+     * \brief Convert an immutable sensor_msgs::Image message to a Halcon-compatible HImage, sharing
+     * the image data if possible.
+     *
+     * MONO8, MONO16 and Bayer images without row padding and in host byte order are wrapped as external Halcon
+     * images, otherwise the data is copied. The message is kept alive as long as the returned HalconImage
+     * exists. The HImage must not be used after the HalconImage has been released, use CopyImage if the
+     * pixel data has to outlive it.
+     *
+     * \param source   A shared_ptr to a sensor_msgs::Image message
+     */
+    HalconImageConstPtr toHalconShare(const sensor_msgs::ImageConstPtr& source);
+
+    /**
+     * \brief Convert an immutable sensor_msgs::Image message to a Halcon-compatible HImage, sharing
+     * the image data if possible.
+     *
+     * This overload is intended for aggregate messages that contain a sensor_msgs::Image as a member.
+     *
+     * \param source           The sensor_msgs::Image message
+     * \param tracked_object   A shared_ptr to an object owning the sensor_msgs::Image
+     */
+    HalconImageConstPtr toHalconShare(const sensor_msgs::Image& source, const boost::shared_ptr<void const>& tracked_object);
+
+
+
+    class LazyHalconImage;
+
+    typedef boost::shared_ptr<LazyHalconImage> LazyHalconImagePtr;
+    typedef boost::shared_ptr<LazyHalconImage const> LazyHalconImageConstPtr;
+
+    /**
+     * \brief Image message that keeps the sensor_msgs::Image and converts it to a HImage on first access.
+     *
+     * Header and encoding are available without conversion, so messages that are skipped cost no conversion at all.
+     * The conversion is done once, even if several threads access the image at the same time. It shares the message
+     * data if possible, see toHalconShare. Destruction is not synchronized with the accessors: the image must not be
+     * destroyed while another thread may still call getHalconImage() or getImage(), which holding it through a
+     * LazyHalconImageConstPtr guarantees.
      */
-    HalconImagePtr toHalconCopy(const sensor_msgs::Image& source);
+    class LazyHalconImage {
+        public:
+            std_msgs::Header header;
+            std::string encoding;
+
+            explicit LazyHalconImage(const sensor_msgs::ImageConstPtr& source);
+
+            /**
+             * \brief Get the converted image, converting the message if this is the first access.
+             *
+             * Throws halcon_bridge::Exception if the message cannot be converted, later accesses retry the conversion.
+             */
+            HalconImageConstPtr getHalconImage() const;
+
+            /**
+             * \brief Get the HImage of the converted image, converting the message if this is the first access.
+             */
+            const HalconCpp::HImage& getImage() const;
+
+            /**
+             * \brief Check whether the message has already been converted.
+             */
+            bool isConverted() const;
+
+            const sensor_msgs::ImageConstPtr& getSource() const {
+                return source_;
+            }
+
+        private:
+            sensor_msgs::ImageConstPtr source_;
+            mutable std::once_flag converted_flag_;
+            mutable HalconImageConstPtr converted_;
+            mutable std::mutex mutex_;
+    };
+
+    /**
+     * \brief Wrap an immutable sensor_msgs::Image message, the HImage is created on first access.
+     *
+     * \param source   A shared_ptr to a sensor_msgs::Image message
+     */
+    LazyHalconImageConstPtr toHalconLazy(const sensor_msgs::ImageConstPtr& source);
 
 
 
 }
+
+
+
+/**
+ * Message traits and serialization for HalconImage. They allow to subscribe to and publish HalconImage messages
+ * directly: subscribers in the same process receive the published pointer, the sensor_msgs::Image message is
+ * only created when a message has to be serialized for a remote subscriber.
+ */
+namespace ros {
+
+    namespace message_traits {
+
+        template<> struct MD5Sum<halcon_bridge::HalconImage> {
+            static const char* value() { return MD5Sum<sensor_msgs::Image>::value(); }
+            static const char* value(const halcon_bridge::HalconImage&) { return value(); }
+
+            static const uint64_t static_value1 = MD5Sum<sensor_msgs::Image>::static_value1;
+            static const uint64_t static_value2 = MD5Sum<sensor_msgs::Image>::static_value2;
+        };
+
+        template<> struct DataType<halcon_bridge::HalconImage> {
+            static const char* value() { return DataType<sensor_msgs::Image>::value(); }
+            static const char* value(const halcon_bridge::HalconImage&) { return value(); }
+        };
+
+        template<> struct Definition<halcon_bridge::HalconImage> {
+            static const char* value() { return Definition<sensor_msgs::Image>::value(); }
+            static const char* value(const halcon_bridge::HalconImage&) { return value(); }
+        };
+
+        template<> struct HasHeader<halcon_bridge::HalconImage> : TrueType {};
+
+    }
+
+    namespace serialization {
+
+        template<> struct Serializer<halcon_bridge::HalconImage> {
+
+            template<typename Stream>
+            inline static void write(Stream& stream, const halcon_bridge::HalconImage& m) {
+                sensor_msgs::Image ros_image;
+                m.toImageMsg(ros_image);
+                stream.next(ros_image);
+            }
+
+            template<typename Stream>
+            inline static void read(Stream& stream, halcon_bridge::HalconImage& m) {
+                sensor_msgs::Image ros_image;
+                stream.next(ros_image);
+                halcon_bridge::HalconImagePtr converted = halcon_bridge::toHalconCopy(ros_image);
+                m.header = converted->header;
+                m.encoding = converted->encoding;
+                m.pyramid.clear();
+                std::swap(m.image, converted->image);
+                // the copy does not reference a message or mapping the old image may have shared
+                m.tracked_object_.reset();
+            }
+
+            inline static uint32_t serializedLength(const halcon_bridge::HalconImage& m) {
+                sensor_msgs::Image ros_image;
+                m.toImageMsgLayout(ros_image);
+                return serializationLength(ros_image) + ros_image.step * ros_image.height;
+            }
+        };
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_IMAGE_BATCH_H
+#define ASR_HALCON_BRIDGE_HALCON_IMAGE_BATCH_H
+
+#include <asr_halcon_bridge/halcon_image.h>
+#include <vector>
+
+namespace halcon_bridge {
+
+    class HalconImageBatch;
+
+    typedef boost::shared_ptr<HalconImageBatch> HalconImageBatchPtr;
+    typedef boost::shared_ptr<HalconImageBatch const> HalconImageBatchConstPtr;
+
+    /**
+     * \brief Synchronized images of several cameras, converted together into one multi-object HImage.
+     */
+    class HalconImageBatch {
+        public:
+            /// Headers and encodings of the images, in the order of the source messages
+            std::vector<std_msgs::Header> headers;
+            std::vector<std::string> encodings;
+
+            /// One object per image, in the order of the source messages. Use SelectObj(i + 1) to get image i.
+            HalconCpp::HImage images;
+
+            /// Wall time of the whole batch conversion in seconds
+            double conversion_time;
+            /// Time spent converting every single image in seconds, the sum exceeds conversion_time when the
+            /// images were converted in parallel
+            std::vector<double> image_conversion_times;
+
+            HalconImageBatch();
+
+            /**
+             * \brief Number of images in the batch.
+             */
+            size_t size() const;
+
+            /**
+             * \brief Get image index of the batch, counting from 0.
+             */
+            HalconCpp::HImage getImage(size_t index) const;
+    };
+
+
+    /**
+     * \brief Convert synchronized sensor_msgs::Image messages, e.g. from a message_filters synchronizer, into one
+     * multi-object HImage, copying the image data.
+     *
+     * If there are at least as many images as conversion threads, the images are converted side by side on the
+     * worker pool, one image per thread. Otherwise they are converted one after the other, each split into bands
+     * of rows over all threads, so every thread is busy either way.
+     *
+     * \param sources   The images to convert, at least one
+     * \param options   Region, strides, pyramid levels and demosaicing, applied to every image. The pyramid
+     *                  levels are built but not part of the batch.
+     */
+    HalconImageBatchPtr toHalconCopy(const std::vector<sensor_msgs::ImageConstPtr>& sources,
+                                     const ImageConversionOptions& options = ImageConversionOptions());
+
+    /**
+     * \brief Convert the left and right image of a stereo pair in one call.
+     *
+     * Both images must have the same size and encoding, as the rectified images of a stereo camera have. The left
+     * image is object 1 of the batch, the right image object 2, ready for BinocularDisparity and similar operators.
+     *
+     * \param left      The left image
+     * \param right     The right image
+     * \param options   Region, strides, pyramid levels and demosaicing, applied to both images
+     */
+    HalconImageBatchPtr toHalconStereoCopy(const sensor_msgs::ImageConstPtr& left, const sensor_msgs::ImageConstPtr& right,
+                                           const ImageConversionOptions& options = ImageConversionOptions());
+
+}
+
+#endif
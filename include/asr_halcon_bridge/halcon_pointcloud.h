@@ -15,9 +15,15 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 */
 
+#ifndef ASR_HALCON_BRIDGE_HALCON_POINTCLOUD_H
+#define ASR_HALCON_BRIDGE_HALCON_POINTCLOUD_H
+
 #include <sensor_msgs/PointCloud2.h>
 #include <halconcpp/HalconCpp.h>
-#include <stdexcept>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace halcon_bridge {
 
@@ -27,6 +33,7 @@ namespace halcon_bridge {
     class HalconPointcloud;
 
     typedef boost::shared_ptr<HalconPointcloud> HalconPointcloudPtr;
+    typedef boost::shared_ptr<HalconPointcloud const> HalconPointcloudConstPtr;
 
     /**
      * \brief PointCloud message class that is interoperable with sensor_msgs/PointCloud2 but uses a HObjectModel3D representation for the point cloud data.
@@ -36,15 +43,27 @@ namespace halcon_bridge {
     class HalconPointcloud {
         public:
             std_msgs::Header header;
-            HalconCpp::HTuple curvature;
             HalconCpp::HObjectModel3D *model;
 
+            /**
+             * \brief X, Y and Z images of organized point clouds (height > 1).
+             *
+             * Their domain contains all points with finite coordinates. The images are not initialized for
+             * unorganized point clouds, which includes point clouds downsampled to a voxel grid.
+             */
+            HalconCpp::HImage x_image, y_image, z_image;
+
+            HalconPointcloud();
             ~HalconPointcloud();
 
             /**
              * \brief Convert this message to a ROS sensor_msgs::PointCloud2 message.
              *
              * The returned sensor_msgs::PointCloud2 message contains a copy of the Halcon-ObjectModel data.
+             * Models with an xyz mapping are written as organized point clouds, cells without a point are NaN.
+             * The extended point attributes &red, &green and &blue are written as packed rgb field, every other
+             * extended point attribute as FLOAT32 field named after the attribute without the leading '&'.
+             * Throws halcon_bridge::Exception if model is NULL.
              */
             sensor_msgs::PointCloud2Ptr toPointcloudMsg() const;
 
@@ -52,8 +71,78 @@ namespace halcon_bridge {
             /**
              * \brief Copy the message data to a ROS sensor_msgs::PointCloud2 message.
              *
+             * Throws halcon_bridge::Exception if model is NULL.
              */
             void toPointcloudMsg(sensor_msgs::PointCloud2& ros_pointcloud) const;
+
+            /**
+             * \brief Fill all fields of a ROS sensor_msgs::PointCloud2 message except the point data.
+             *
+             * Throws halcon_bridge::Exception if model is NULL.
+             */
+            void toPointcloudMsgLayout(sensor_msgs::PointCloud2& ros_pointcloud) const;
+
+        protected:
+            boost::shared_ptr<void const> tracked_object_;
+
+            friend class HalconCaptureReader;
+            friend struct ros::serialization::Serializer<HalconPointcloud>;
+    };
+
+
+    /**
+     * \brief Optional parts of the conversion of a sensor_msgs::PointCloud2 message.
+     */
+    struct PointcloudConversionOptions {
+        /// Read a packed rgb or rgba field into the extended point attributes &red, &green and &blue (0-255)
+        bool color;
+        /// Read an intensity field into the extended point attribute &intensity
+        bool intensity;
+        /// Drop points with a non-finite coordinate from unorganized point clouds. Organized point clouds always
+        /// leave them out of the domain. Point clouds that are marked is_dense are not checked.
+        bool remove_invalid;
+        /// Keep only the points inside the axis-aligned box from crop_min to crop_max, including its faces.
+        /// Organized point clouds leave the other points out of the domain.
+        bool crop;
+        float crop_min_x, crop_min_y, crop_min_z;
+        float crop_max_x, crop_max_y, crop_max_z;
+        /// Edge length of a voxel grid, every occupied voxel is replaced by the centroid of its points and the mean
+        /// of their attributes. Drops non-finite points and makes the point cloud unorganized. 0 disables it.
+        float voxel_size;
+
+        PointcloudConversionOptions() : color(true), intensity(true), remove_invalid(false), crop(false),
+                                        crop_min_x(0.0f), crop_min_y(0.0f), crop_min_z(0.0f),
+                                        crop_max_x(0.0f), crop_max_y(0.0f), crop_max_z(0.0f), voxel_size(0.0f) {}
+    };
+
+
+    /**
+     * \brief Remembers the field layout of the point clouds of one topic, so it is only analyzed again when it changes.
+     *
+     * Point clouds with the layout of a common PCL point type (PointXYZ, PointXYZI, PointXYZRGB, PointNormal and
+     * PointXYZRGBNormal) are read by a converter specialized for that layout, all others by the generic one.
+     * Use one cache per topic, it may be shared by several threads.
+     */
+    class PointCloudLayoutCache {
+        public:
+            struct Layout;
+
+            PointCloudLayoutCache();
+            ~PointCloudLayoutCache();
+
+            /**
+             * \brief Get the layout of a point cloud, analyzing its fields only if they differ from the last one.
+             */
+            boost::shared_ptr<const Layout> getLayout(const sensor_msgs::PointCloud2& source);
+
+        private:
+            PointCloudLayoutCache(const PointCloudLayoutCache&);
+            PointCloudLayoutCache& operator=(const PointCloudLayoutCache&);
+
+            std::mutex mutex_;
+            uint32_t point_step_;
+            std::vector<sensor_msgs::PointField> fields_;
+            boost::shared_ptr<const Layout> layout_;
     };
 
 
@@ -61,22 +150,190 @@ namespace halcon_bridge {
      * \brief Convert a sensor_msgs::PointCloud2 message to a Halcon-compatible HObjectModel3D, copying the
      * point cloud data.
      *
-     * \param source   A shared_ptr to a sensor_msgs::PointCloud2 message
+     * \param source    A shared_ptr to a sensor_msgs::PointCloud2 message
+     * \param options   Attributes to convert besides the coordinates and normals, and the points to keep
      *
      */
-    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source);
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source,
+                                     const PointcloudConversionOptions& options = PointcloudConversionOptions());
 
 
     /**
      * \brief Convert a sensor_msgs::PointCloud2 message to a Halcon-compatible HObjectModel3D, copying the
      * point cloud data.
      *
-     * \param source   A sensor_msgs::PointCloud2 message
+     * Organized point clouds (height > 1) are additionally stored as X/Y/Z images and the model is created
+     * from them, so it carries an xyz mapping. Points with non-finite coordinates are dropped in that case.
+     *
+     * Curvature and all other scalar fields without a standard meaning are stored as extended point attributes
+     * named after the field with a leading '&' (e.g. &curvature), so they stay aligned with the points when the model
+     * is processed by Halcon operators. Fields named red, green or blue are skipped, these names hold the channels of
+     * the rgb field.
+     *
+     * Invalid points, points outside a crop box and voxel downsampling are handled while the fields are gathered,
+     * so the model is created at its final size.
+     *
+     * \param source    A sensor_msgs::PointCloud2 message
+     * \param options   Attributes to convert besides the coordinates and normals, and the points to keep
+     *
+     */
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source,
+                                     const PointcloudConversionOptions& options = PointcloudConversionOptions());
+
+
+    /**
+     * \brief Convert a sensor_msgs::PointCloud2 message to a Halcon-compatible HObjectModel3D, copying the
+     * point cloud data and taking the field layout from a cache.
+     *
+     * \param source         A shared_ptr to a sensor_msgs::PointCloud2 message
+     * \param layout_cache   The layout cache of the topic the message was received on
+     * \param options        Attributes to convert besides the coordinates and normals, and the points to keep
+     *
+     */
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source, PointCloudLayoutCache& layout_cache,
+                                     const PointcloudConversionOptions& options = PointcloudConversionOptions());
+
+
+    /**
+     * \brief Convert a sensor_msgs::PointCloud2 message to a Halcon-compatible HObjectModel3D, copying the
+     * point cloud data and taking the field layout from a cache.
+     *
+     * \param source         A sensor_msgs::PointCloud2 message
+     * \param layout_cache   The layout cache of the topic the message was received on
+     * \param options        Attributes to convert besides the coordinates and normals, and the points to keep
      *
      */
-    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source);
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source, PointCloudLayoutCache& layout_cache,
+                                     const PointcloudConversionOptions& options = PointcloudConversionOptions());
+
+
+
+    class LazyHalconPointcloud;
+
+    typedef boost::shared_ptr<LazyHalconPointcloud> LazyHalconPointcloudPtr;
+    typedef boost::shared_ptr<LazyHalconPointcloud const> LazyHalconPointcloudConstPtr;
+
+    /**
+     * \brief Point cloud message that keeps the sensor_msgs::PointCloud2 and converts it to a HObjectModel3D on
+     * first access.
+     *
+     * Header and size are available without conversion. The conversion is done once, even if several threads access
+     * the model at the same time. Like LazyHalconImage, it must not be destroyed while another thread may still access
+     * it.
+     */
+    class LazyHalconPointcloud {
+        public:
+            std_msgs::Header header;
+            uint32_t width;
+            uint32_t height;
+
+            explicit LazyHalconPointcloud(const sensor_msgs::PointCloud2ConstPtr& source);
+
+            /**
+             * \brief Get the converted point cloud, converting the message if this is the first access.
+             *
+             * Throws halcon_bridge::Exception if the message cannot be converted, later accesses retry the conversion.
+             */
+            HalconPointcloudConstPtr getHalconPointcloud() const;
+
+            /**
+             * \brief Get the HObjectModel3D of the converted point cloud, converting the message if this is the first access.
+             */
+            const HalconCpp::HObjectModel3D& getModel() const;
+
+            /**
+             * \brief Check whether the message has already been converted.
+             */
+            bool isConverted() const;
+
+            const sensor_msgs::PointCloud2ConstPtr& getSource() const {
+                return source_;
+            }
+
+        private:
+            sensor_msgs::PointCloud2ConstPtr source_;
+            mutable std::once_flag converted_flag_;
+            mutable HalconPointcloudConstPtr converted_;
+            mutable std::mutex mutex_;
+    };
+
+    /**
+     * \brief Wrap an immutable sensor_msgs::PointCloud2 message, the HObjectModel3D is created on first access.
+     *
+     * \param source   A shared_ptr to a sensor_msgs::PointCloud2 message
+     *
+     */
+    LazyHalconPointcloudConstPtr toHalconLazy(const sensor_msgs::PointCloud2ConstPtr& source);
+
+
+
+}
+
+
+
+/**
+ * Message traits and serialization for HalconPointcloud, see halcon_image.h.
+ */
+namespace ros {
+
+    namespace message_traits {
+
+        template<> struct MD5Sum<halcon_bridge::HalconPointcloud> {
+            static const char* value() { return MD5Sum<sensor_msgs::PointCloud2>::value(); }
+            static const char* value(const halcon_bridge::HalconPointcloud&) { return value(); }
+
+            static const uint64_t static_value1 = MD5Sum<sensor_msgs::PointCloud2>::static_value1;
+            static const uint64_t static_value2 = MD5Sum<sensor_msgs::PointCloud2>::static_value2;
+        };
+
+        template<> struct DataType<halcon_bridge::HalconPointcloud> {
+            static const char* value() { return DataType<sensor_msgs::PointCloud2>::value(); }
+            static const char* value(const halcon_bridge::HalconPointcloud&) { return value(); }
+        };
+
+        template<> struct Definition<halcon_bridge::HalconPointcloud> {
+            static const char* value() { return Definition<sensor_msgs::PointCloud2>::value(); }
+            static const char* value(const halcon_bridge::HalconPointcloud&) { return value(); }
+        };
+
+        template<> struct HasHeader<halcon_bridge::HalconPointcloud> : TrueType {};
+
+    }
+
+    namespace serialization {
+
+        template<> struct Serializer<halcon_bridge::HalconPointcloud> {
+
+            template<typename Stream>
+            inline static void write(Stream& stream, const halcon_bridge::HalconPointcloud& m) {
+                sensor_msgs::PointCloud2 ros_pointcloud;
+                m.toPointcloudMsg(ros_pointcloud);
+                stream.next(ros_pointcloud);
+            }
+
+            template<typename Stream>
+            inline static void read(Stream& stream, halcon_bridge::HalconPointcloud& m) {
+                sensor_msgs::PointCloud2 ros_pointcloud;
+                stream.next(ros_pointcloud);
+                halcon_bridge::HalconPointcloudPtr converted = halcon_bridge::toHalconCopy(ros_pointcloud);
+                m.header = converted->header;
+                m.x_image = converted->x_image;
+                m.y_image = converted->y_image;
+                m.z_image = converted->z_image;
+                std::swap(m.model, converted->model);
+                // the copy does not reference a mapping the old X/Y/Z images may have shared
+                m.tracked_object_.reset();
+            }
 
+            inline static uint32_t serializedLength(const halcon_bridge::HalconPointcloud& m) {
+                sensor_msgs::PointCloud2 ros_pointcloud;
+                m.toPointcloudMsgLayout(ros_pointcloud);
+                return serializationLength(ros_pointcloud) + ros_pointcloud.row_step * ros_pointcloud.height;
+            }
+        };
 
+    }
 
 }
 
+#endif
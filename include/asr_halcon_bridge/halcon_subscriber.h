@@ -0,0 +1,114 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_SUBSCRIBER_H
+#define ASR_HALCON_BRIDGE_HALCON_SUBSCRIBER_H
+
+#include <ros/ros.h>
+#include <asr_halcon_bridge/halcon_image.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <mutex>
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Subscribes to a topic once and hands every message, converted a single time, to all registered callbacks.
+     *
+     * The subscription uses the HalconImage/HalconPointcloud message traits, so incoming ROS messages are deserialized
+     * straight into the Halcon representation. Producers in the same process can publish HalconImagePtr or
+     * HalconPointcloudPtr messages on a publisher advertised with the Halcon type; their subscribers receive the
+     * pointer without any conversion and the ROS message is only serialized for remote subscribers.
+     *
+     * The subscriber must not be copied or moved, it is bound to the ROS subscription by address.
+     */
+    template<typename HalconMessage>
+    class HalconSubscriber : boost::noncopyable {
+        public:
+            typedef boost::shared_ptr<HalconMessage const> MessageConstPtr;
+            typedef boost::function<void(const MessageConstPtr&)> Callback;
+
+            /**
+             * \brief Subscribe to a topic.
+             *
+             * \param nh                The node handle used for the subscription
+             * \param topic             The topic to subscribe to
+             * \param queue_size        Number of incoming messages to queue
+             * \param transport_hints   Transport hints passed to the subscription
+             */
+            HalconSubscriber(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size,
+                             const ros::TransportHints& transport_hints = ros::TransportHints()) :
+                    callbacks_(boost::make_shared<const std::vector<Callback> >()) {
+                subscriber_ = nh.subscribe<HalconMessage>(topic, queue_size, &HalconSubscriber::messageCallback, this, transport_hints);
+            }
+
+            ~HalconSubscriber() {
+                subscriber_.shutdown();
+            }
+
+            /**
+             * \brief Register a callback that receives every converted message.
+             *
+             * The message is shared between all callbacks and must not be modified.
+             */
+            void addCallback(const Callback& callback) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                // messages being delivered keep the list they started with
+                boost::shared_ptr<std::vector<Callback> > callbacks = boost::make_shared<std::vector<Callback> >(*callbacks_);
+                callbacks->push_back(callback);
+                callbacks_ = callbacks;
+            }
+
+            std::string getTopic() const {
+                return subscriber_.getTopic();
+            }
+
+            uint32_t getNumPublishers() const {
+                return subscriber_.getNumPublishers();
+            }
+
+            void shutdown() {
+                subscriber_.shutdown();
+            }
+
+        private:
+            void messageCallback(const MessageConstPtr& message) {
+                boost::shared_ptr<const std::vector<Callback> > callbacks;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    callbacks = callbacks_;
+                }
+                for (size_t i = 0; i < callbacks->size(); i++) {
+                    (*callbacks)[i](message);
+                }
+            }
+
+            ros::Subscriber subscriber_;
+            std::mutex mutex_;
+            /// Replaced as a whole when a callback is added, so delivering a message only copies the pointer
+            boost::shared_ptr<const std::vector<Callback> > callbacks_;
+    };
+
+    typedef HalconSubscriber<HalconImage> HalconImageSubscriber;
+    typedef HalconSubscriber<HalconPointcloud> HalconPointcloudSubscriber;
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/async_converter.h>
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * \brief Latency histogram of one stage.
+         */
+        struct StageHistogram : LatencyHistogram {
+            void add(const Clock::time_point& begin, const Clock::time_point& end) {
+                LatencyHistogram::add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            }
+
+            AsyncStageLatency getLatency() const {
+                AsyncStageLatency latency;
+                latency.p50 = getPercentile(0.5);
+                latency.p99 = getPercentile(0.99);
+                latency.max = max_nanoseconds * 1e-9;
+                return latency;
+            }
+        };
+
+        enum Stage {
+            STAGE_QUEUE,
+            STAGE_CONVERSION,
+            STAGE_DELIVERY,
+            STAGE_TOTAL,
+            STAGE_COUNT
+        };
+
+        void reportFailure(const AsyncConversionQueue::Failure& failure, const std::exception_ptr& error) {
+            try {
+                failure(error);
+            } catch (...) {
+                // a failing error handler must not take the worker down
+            }
+        }
+
+    }
+
+
+
+    struct AsyncConversionQueue::State {
+        struct Item {
+            Conversion conversion;
+            Failure failure;
+            Clock::time_point pushed;
+        };
+
+        AsyncConverterOptions options;
+        mutable std::mutex mutex;
+        std::condition_variable work;
+        std::condition_variable space;
+        std::condition_variable idle;
+        std::deque<Item> queue;
+        std::vector<std::thread> workers;
+        size_t running;
+        bool stop;
+
+        unsigned long accepted;
+        unsigned long delivered;
+        unsigned long failed;
+        unsigned long dropped;
+        StageHistogram stages[STAGE_COUNT];
+
+        State() : running(0), stop(false) {
+            reset();
+        }
+
+        void reset() {
+            accepted = delivered = failed = dropped = 0;
+            memset(stages, 0, sizeof(stages));
+        }
+
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                work.wait(lock, [this] { return stop || !queue.empty(); });
+                if (queue.empty()) return;
+                Item item = queue.front();
+                queue.pop_front();
+                running++;
+                lock.unlock();
+                space.notify_one();
+
+                Clock::time_point started = Clock::now();
+                Clock::time_point converted = started;
+                bool success = false;
+                try {
+                    Delivery delivery = item.conversion();
+                    converted = Clock::now();
+                    delivery();
+                    success = true;
+                } catch (...) {
+                    reportFailure(item.failure, std::current_exception());
+                }
+                Clock::time_point finished = Clock::now();
+
+                lock.lock();
+                running--;
+                stages[STAGE_QUEUE].add(item.pushed, started);
+                if (success) {
+                    delivered++;
+                    stages[STAGE_CONVERSION].add(started, converted);
+                    stages[STAGE_DELIVERY].add(converted, finished);
+                    stages[STAGE_TOTAL].add(item.pushed, finished);
+                } else {
+                    failed++;
+                }
+                if (queue.empty() && (running == 0)) {
+                    idle.notify_all();
+                }
+            }
+        }
+    };
+
+
+
+    AsyncConversionQueue::AsyncConversionQueue(const AsyncConverterOptions& options) : state_(new State()) {
+        if (options.queue_size == 0) {
+            throw Exception("The queue of an asynchronous converter needs room for at least one message");
+        }
+        state_->options = options;
+        unsigned int threads = std::max(1u, options.threads);
+        for (unsigned int i = 0; i < threads; i++) {
+            // every worker holds the state, so one that is detached by shutdown() can still finish its loop
+            state_->workers.push_back(std::thread(&State::workerLoop, state_));
+        }
+    }
+
+    AsyncConversionQueue::~AsyncConversionQueue() {
+        shutdown();
+    }
+
+    bool AsyncConversionQueue::push(const Conversion& conversion, const Failure& failure) {
+        State::Item item = {conversion, failure, Clock::now()};
+        Failure dropped;
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            if (state_->options.policy == KEEP_ALL) {
+                state_->space.wait(lock, [this] { return state_->stop || (state_->queue.size() < state_->options.queue_size); });
+            } else if (!state_->stop && (state_->queue.size() >= state_->options.queue_size)) {
+                dropped = state_->queue.front().failure;
+                state_->queue.pop_front();
+                state_->dropped++;
+            }
+            if (state_->stop) {
+                return false;
+            }
+            state_->queue.push_back(item);
+            state_->accepted++;
+        }
+        state_->work.notify_one();
+        if (dropped) {
+            reportFailure(dropped, std::exception_ptr());
+        }
+        return true;
+    }
+
+    void AsyncConversionQueue::flush() {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->idle.wait(lock, [this] { return state_->queue.empty() && (state_->running == 0); });
+    }
+
+    void AsyncConversionQueue::shutdown() {
+        std::deque<State::Item> dropped;
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->stop = true;
+            dropped.swap(state_->queue);
+            state_->dropped += dropped.size();
+            workers.swap(state_->workers);
+        }
+        state_->work.notify_all();
+        state_->space.notify_all();
+        state_->idle.notify_all();
+        for (size_t i = 0; i < dropped.size(); i++) {
+            reportFailure(dropped[i].failure, std::exception_ptr());
+        }
+        // called from a callback, the calling worker cannot join itself and returns once the callback is done
+        std::thread::id self = std::this_thread::get_id();
+        for (size_t i = 0; i < workers.size(); i++) {
+            if (workers[i].get_id() == self) {
+                workers[i].detach();
+            } else {
+                workers[i].join();
+            }
+        }
+    }
+
+    AsyncConverterStats AsyncConversionQueue::getStats() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        AsyncConverterStats stats;
+        stats.accepted = state_->accepted;
+        stats.delivered = state_->delivered;
+        stats.failed = state_->failed;
+        stats.dropped = state_->dropped;
+        stats.queued = state_->queue.size();
+        stats.queue = state_->stages[STAGE_QUEUE].getLatency();
+        stats.conversion = state_->stages[STAGE_CONVERSION].getLatency();
+        stats.delivery = state_->stages[STAGE_DELIVERY].getLatency();
+        stats.total = state_->stages[STAGE_TOTAL].getLatency();
+        return stats;
+    }
+
+    void AsyncConversionQueue::resetStats() {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->reset();
+    }
+
+}
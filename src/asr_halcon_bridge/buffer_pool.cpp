@@ -0,0 +1,188 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "pooled_buffers.h"
+#include "instrumentation.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        std::atomic<bool> pool_enabled(false);
+
+        // The pools are never destroyed, HImages and messages may still be released during static destruction.
+        BufferPool& imagePlanes() {
+            static BufferPool* pool = new BufferPool();
+            return *pool;
+        }
+
+        BufferPool& pointcloudBuffers() {
+            static BufferPool* pool = new BufferPool();
+            return *pool;
+        }
+
+        BufferPoolStats combine(const BufferPoolStats& a, const BufferPoolStats& b) {
+            BufferPoolStats stats;
+            stats.hits = a.hits + b.hits;
+            stats.misses = a.misses + b.misses;
+            stats.cached_buffers = a.cached_buffers + b.cached_buffers;
+            stats.cached_bytes = a.cached_bytes + b.cached_bytes;
+            return stats;
+        }
+
+    }
+
+    MessagePool<sensor_msgs::Image>& imageMessagePool() {
+        static MessagePool<sensor_msgs::Image>* pool = new MessagePool<sensor_msgs::Image>();
+        return *pool;
+    }
+
+    MessagePool<sensor_msgs::PointCloud2>& pointcloudMessagePool() {
+        static MessagePool<sensor_msgs::PointCloud2>* pool = new MessagePool<sensor_msgs::PointCloud2>();
+        return *pool;
+    }
+
+
+
+    BufferPool::BufferPool() : capacity_(256 << 20) {
+        stats_.hits = stats_.misses = 0;
+        stats_.cached_buffers = stats_.cached_bytes = 0;
+    }
+
+    void* BufferPool::acquire(size_t size) {
+        if (pool_enabled) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<size_t, std::vector<void*> >::iterator it = cached_.find(size);
+            if ((it != cached_.end()) && !it->second.empty()) {
+                void* buffer = it->second.back();
+                it->second.pop_back();
+                stats_.cached_buffers--;
+                stats_.cached_bytes -= size;
+                stats_.hits++;
+                return buffer;
+            }
+            stats_.misses++;
+        }
+
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        void* buffer = NULL;
+        if (posix_memalign(&buffer, 64, size > 0 ? size : 1) != 0) {
+            throw std::bad_alloc();
+        }
+        if (pool_enabled) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sizes_[buffer] = size;
+        }
+        return buffer;
+    }
+
+    void BufferPool::release(void* buffer) {
+        if (!buffer) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<void*, size_t>::iterator it = sizes_.find(buffer);
+            if (it != sizes_.end()) {
+                size_t size = it->second;
+                if (pool_enabled && (stats_.cached_bytes + size <= capacity_)) {
+                    cached_[size].push_back(buffer);
+                    stats_.cached_buffers++;
+                    stats_.cached_bytes += size;
+                    return;
+                }
+                sizes_.erase(it);
+            }
+        }
+        free(buffer);
+    }
+
+    void BufferPool::setCapacity(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = bytes;
+    }
+
+    void BufferPool::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::map<size_t, std::vector<void*> >::iterator it = cached_.begin(); it != cached_.end(); ++it) {
+            for (size_t i = 0; i < it->second.size(); i++) {
+                sizes_.erase(it->second[i]);
+                free(it->second[i]);
+            }
+        }
+        cached_.clear();
+        stats_.hits = stats_.misses = 0;
+        stats_.cached_buffers = stats_.cached_bytes = 0;
+    }
+
+    BufferPoolStats BufferPool::getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+
+
+    BufferPool& imageBufferPool() {
+        return imagePlanes();
+    }
+
+    void releaseImagePlane(void* plane) {
+        imagePlanes().release(plane);
+    }
+
+    BufferPool& pointcloudBufferPool() {
+        return pointcloudBuffers();
+    }
+
+
+
+    void setBufferPoolEnabled(bool enabled) {
+        pool_enabled = enabled;
+        if (!enabled) {
+            clearBufferPools();
+        }
+    }
+
+    bool isBufferPoolEnabled() {
+        return pool_enabled;
+    }
+
+    void setBufferPoolCapacity(size_t bytes) {
+        imagePlanes().setCapacity(bytes);
+        pointcloudBuffers().setCapacity(bytes);
+        imageMessagePool().setCapacity(bytes);
+        pointcloudMessagePool().setCapacity(bytes);
+    }
+
+    BufferPoolStats getImageBufferPoolStats() {
+        return combine(imagePlanes().getStats(), imageMessagePool().getStats());
+    }
+
+    BufferPoolStats getPointcloudBufferPoolStats() {
+        return combine(pointcloudBuffers().getStats(), pointcloudMessagePool().getStats());
+    }
+
+    void clearBufferPools() {
+        imagePlanes().clear();
+        pointcloudBuffers().clear();
+        imageMessagePool().clear();
+        pointcloudMessagePool().clear();
+    }
+
+}
@@ -0,0 +1,563 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "cloud_kernels.h"
+#include "kernel_dispatch.h"
+#include <sensor_msgs/PointField.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALCON_BRIDGE_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace halcon_bridge {
+
+    namespace {
+
+        template<typename T>
+        void gatherScalar(const uint8_t* src, size_t point_step, size_t count, size_t offset, float* dst) {
+            src += offset;
+            for (size_t i = 0; i < count; i++) {
+                T value;
+                memcpy(&value, src + i * point_step, sizeof(T));
+                dst[i] = (float)value;
+            }
+        }
+
+        inline void unpackColor(uint32_t packed, float* red, float* green, float* blue) {
+            *red = (float)((packed >> 16) & 0xff);
+            *green = (float)((packed >> 8) & 0xff);
+            *blue = (float)(packed & 0xff);
+        }
+
+        inline uint32_t packColor(double red, double green, double blue) {
+            uint32_t r = (uint32_t)std::lrint(std::min(std::max(red, 0.0), 255.0));
+            uint32_t g = (uint32_t)std::lrint(std::min(std::max(green, 0.0), 255.0));
+            uint32_t b = (uint32_t)std::lrint(std::min(std::max(blue, 0.0), 255.0));
+            return (r << 16) | (g << 8) | b;
+        }
+
+        template<bool FloatDepth, bool Swap>
+        inline float loadDepth(const uint8_t* depth, size_t i, float scale) {
+            if (FloatDepth) {
+                uint32_t bits;
+                memcpy(&bits, depth + i * 4, sizeof(bits));
+                if (Swap) bits = __builtin_bswap32(bits);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                return value * scale;
+            }
+            uint16_t value;
+            memcpy(&value, depth + i * 2, sizeof(value));
+            if (Swap) value = (uint16_t)((value << 8) | (value >> 8));
+            return value * scale;
+        }
+
+        template<bool FloatDepth, bool Swap>
+        void backprojectScalar(const uint8_t* depth, size_t begin, size_t count, float scale, const float* ray_x,
+                               const float* ray_y, float* x, float* y, float* z) {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            for (size_t i = begin; i < count; i++) {
+                float d = loadDepth<FloatDepth, Swap>(depth, i, scale);
+                if ((d == 0.0f) || !std::isfinite(d)) d = nan;
+                z[i] = d;
+                if (ray_x) {
+                    x[i] = ray_x[i] * d;
+                    y[i] = ray_y[i] * d;
+                }
+            }
+        }
+
+        template<bool Swap>
+        void reprojectScalar(const uint8_t* disparity, size_t begin, size_t count, float min_disparity, float focal_baseline,
+                             float ray_x0, float ray_x_step, float ray_y, float* x, float* y, float* z) {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            for (size_t i = begin; i < count; i++) {
+                float d = loadDepth<true, Swap>(disparity, i, 1.0f);
+                float depth = ((d >= min_disparity) && (d > 0.0f) && std::isfinite(d)) ? focal_baseline / d : nan;
+                z[i] = depth;
+                x[i] = (ray_x0 + (float)i * ray_x_step) * depth;
+                y[i] = ray_y * depth;
+            }
+        }
+
+        // Offsets of 0 mark attributes the layout does not have, x is always at 0.
+        template<size_t Step, size_t NormalOffset, size_t CurvatureOffset, size_t ColorOffset, size_t IntensityOffset>
+        void gatherFixedScalar(const uint8_t* src, size_t begin, size_t count, float* x, float* y, float* z,
+                               const PointAttributes& attributes) {
+            for (size_t i = begin; i < count; i++) {
+                const uint8_t* point = src + i * Step;
+                memcpy(x + i, point, sizeof(float));
+                memcpy(y + i, point + 4, sizeof(float));
+                memcpy(z + i, point + 8, sizeof(float));
+                if (NormalOffset && attributes.normal_x) {
+                    memcpy(attributes.normal_x + i, point + NormalOffset, sizeof(float));
+                    memcpy(attributes.normal_y + i, point + NormalOffset + 4, sizeof(float));
+                    memcpy(attributes.normal_z + i, point + NormalOffset + 8, sizeof(float));
+                }
+                if (CurvatureOffset && attributes.curvature) {
+                    memcpy(attributes.curvature + i, point + CurvatureOffset, sizeof(float));
+                }
+                if (ColorOffset && attributes.red) {
+                    uint32_t packed;
+                    memcpy(&packed, point + ColorOffset, sizeof(packed));
+                    unpackColor(packed, attributes.red + i, attributes.green + i, attributes.blue + i);
+                }
+                if (IntensityOffset && attributes.intensity) {
+                    memcpy(attributes.intensity + i, point + IntensityOffset, sizeof(float));
+                }
+            }
+        }
+
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+
+        __attribute__((target("sse2")))
+        inline void unpackColorsSse2(const uint32_t* packed, float* red, float* green, float* blue) {
+            const __m128i mask = _mm_set1_epi32(0xff);
+            __m128i values = _mm_loadu_si128((const __m128i*)packed);
+            _mm_storeu_ps(red, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(values, 16), mask)));
+            _mm_storeu_ps(green, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(values, 8), mask)));
+            _mm_storeu_ps(blue, _mm_cvtepi32_ps(_mm_and_si128(values, mask)));
+        }
+
+        __attribute__((target("sse2")))
+        size_t unpackColorFieldSse2(const uint8_t* src, size_t point_step, size_t count, float* red, float* green, float* blue) {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                uint32_t packed[4];
+                for (size_t j = 0; j < 4; j++) {
+                    memcpy(packed + j, src + (i + j) * point_step, sizeof(uint32_t));
+                }
+                unpackColorsSse2(packed, red + i, green + i, blue + i);
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        inline __m128i roundColorsSse2(const double* values) {
+            const __m128d low = _mm_set1_pd(0.0);
+            const __m128d high = _mm_set1_pd(255.0);
+            __m128i first = _mm_cvtpd_epi32(_mm_min_pd(_mm_max_pd(_mm_loadu_pd(values), low), high));
+            __m128i second = _mm_cvtpd_epi32(_mm_min_pd(_mm_max_pd(_mm_loadu_pd(values + 2), low), high));
+            return _mm_unpacklo_epi64(first, second);
+        }
+
+        __attribute__((target("sse2")))
+        size_t packColorsSse2(const double* red, const double* green, const double* blue, size_t count, uint32_t* packed) {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128i r = _mm_slli_epi32(roundColorsSse2(red + i), 16);
+                __m128i g = _mm_slli_epi32(roundColorsSse2(green + i), 8);
+                __m128i b = roundColorsSse2(blue + i);
+                _mm_storeu_si128((__m128i*)(packed + i), _mm_or_si128(_mm_or_si128(r, g), b));
+            }
+            return i;
+        }
+
+        // Same transpose as gatherXYZSse2, with the normals transposed the same way. Every layout has at least
+        // 16 bytes from the start of x and of the normals to the end of the point.
+        template<size_t Step, size_t NormalOffset, size_t CurvatureOffset, size_t ColorOffset, size_t IntensityOffset>
+        __attribute__((target("sse2")))
+        size_t gatherFixedSse2(const uint8_t* src, size_t count, float* x, float* y, float* z, const PointAttributes& attributes) {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const uint8_t* point = src + i * Step;
+                __m128 p0 = _mm_loadu_ps((const float*)point);
+                __m128 p1 = _mm_loadu_ps((const float*)(point + Step));
+                __m128 p2 = _mm_loadu_ps((const float*)(point + 2 * Step));
+                __m128 p3 = _mm_loadu_ps((const float*)(point + 3 * Step));
+                _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+                _mm_storeu_ps(x + i, p0);
+                _mm_storeu_ps(y + i, p1);
+                _mm_storeu_ps(z + i, p2);
+                if (NormalOffset && attributes.normal_x) {
+                    __m128 n0 = _mm_loadu_ps((const float*)(point + NormalOffset));
+                    __m128 n1 = _mm_loadu_ps((const float*)(point + Step + NormalOffset));
+                    __m128 n2 = _mm_loadu_ps((const float*)(point + 2 * Step + NormalOffset));
+                    __m128 n3 = _mm_loadu_ps((const float*)(point + 3 * Step + NormalOffset));
+                    _MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+                    _mm_storeu_ps(attributes.normal_x + i, n0);
+                    _mm_storeu_ps(attributes.normal_y + i, n1);
+                    _mm_storeu_ps(attributes.normal_z + i, n2);
+                }
+                if (CurvatureOffset && attributes.curvature) {
+                    for (size_t j = 0; j < 4; j++) {
+                        memcpy(attributes.curvature + i + j, point + j * Step + CurvatureOffset, sizeof(float));
+                    }
+                }
+                if (ColorOffset && attributes.red) {
+                    uint32_t packed[4];
+                    for (size_t j = 0; j < 4; j++) {
+                        memcpy(packed + j, point + j * Step + ColorOffset, sizeof(uint32_t));
+                    }
+                    unpackColorsSse2(packed, attributes.red + i, attributes.green + i, attributes.blue + i);
+                }
+                if (IntensityOffset && attributes.intensity) {
+                    for (size_t j = 0; j < 4; j++) {
+                        memcpy(attributes.intensity + i + j, point + j * Step + IntensityOffset, sizeof(float));
+                    }
+                }
+            }
+            return i;
+        }
+
+#endif
+
+        template<size_t Step, size_t NormalOffset, size_t CurvatureOffset, size_t ColorOffset, size_t IntensityOffset>
+        void gatherFixed(const uint8_t* src, size_t count, float* x, float* y, float* z, const PointAttributes& attributes) {
+            size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+            if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) {
+                done = gatherFixedSse2<Step, NormalOffset, CurvatureOffset, ColorOffset, IntensityOffset>(src, count, x, y, z, attributes);
+            }
+#endif
+            gatherFixedScalar<Step, NormalOffset, CurvatureOffset, ColorOffset, IntensityOffset>(src, done, count, x, y, z, attributes);
+        }
+
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+
+        // Invalid depths are replaced by NaN with a mask, the NaN then carries over into x and y.
+        __attribute__((target("sse2")))
+        size_t backprojectSse2(const uint8_t* depth, size_t count, bool float_depth, float scale, const float* ray_x,
+                               const float* ray_y, float* x, float* y, float* z) {
+            const __m128 scales = _mm_set1_ps(scale);
+            const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+            const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128 d[2];
+                if (float_depth) {
+                    d[0] = _mm_loadu_ps((const float*)(depth + i * 4));
+                    d[1] = _mm_loadu_ps((const float*)(depth + i * 4 + 16));
+                } else {
+                    __m128i values = _mm_loadu_si128((const __m128i*)(depth + i * 2));
+                    d[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero));
+                    d[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero));
+                }
+                for (size_t j = 0; j < 2; j++) {
+                    __m128 value = _mm_mul_ps(d[j], scales);
+                    // zero, NaN and infinite depths are invalid
+                    __m128 invalid = _mm_or_ps(_mm_cmpeq_ps(value, _mm_setzero_ps()),
+                                               _mm_cmpnlt_ps(_mm_and_ps(value, abs_mask), infinity));
+                    value = _mm_or_ps(_mm_andnot_ps(invalid, value), _mm_and_ps(invalid, nan));
+                    size_t k = i + 4 * j;
+                    _mm_storeu_ps(z + k, value);
+                    if (ray_x) {
+                        _mm_storeu_ps(x + k, _mm_mul_ps(_mm_loadu_ps(ray_x + k), value));
+                        _mm_storeu_ps(y + k, _mm_mul_ps(_mm_loadu_ps(ray_y + k), value));
+                    }
+                }
+            }
+            return i;
+        }
+
+        // Invalid disparities are replaced by NaN with a mask, the NaN then carries over into x and y.
+        __attribute__((target("sse2")))
+        size_t reprojectSse2(const uint8_t* disparity, size_t count, float min_disparity, float focal_baseline,
+                             float ray_x0, float ray_x_step, float ray_y, float* x, float* y, float* z) {
+            const __m128 minimum = _mm_set1_ps(min_disparity);
+            const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+            const __m128 numerator = _mm_set1_ps(focal_baseline);
+            const __m128 origin = _mm_set1_ps(ray_x0);
+            const __m128 step = _mm_set1_ps(ray_x_step);
+            const __m128 rays_y = _mm_set1_ps(ray_y);
+            const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+            size_t i = 0;
+            // the column index has to fit the 32 bit lanes
+            size_t vector_count = std::min<size_t>(count, 1u << 30);
+            for (; i + 4 <= vector_count; i += 4) {
+                __m128 d = _mm_loadu_ps((const float*)(disparity + i * 4));
+                __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(d, minimum), _mm_cmpgt_ps(d, _mm_setzero_ps())),
+                                          _mm_cmplt_ps(d, infinity));
+                __m128 depth = _mm_div_ps(numerator, d);
+                depth = _mm_or_ps(_mm_and_ps(valid, depth), _mm_andnot_ps(valid, nan));
+                __m128 columns = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32((int)i), lanes));
+                __m128 ray_x = _mm_add_ps(origin, _mm_mul_ps(columns, step));
+                _mm_storeu_ps(z + i, depth);
+                _mm_storeu_ps(x + i, _mm_mul_ps(ray_x, depth));
+                _mm_storeu_ps(y + i, _mm_mul_ps(rays_y, depth));
+            }
+            return i;
+        }
+
+        // Loads x, y, z and the following four bytes of four points and transposes them, so x, y and z of the
+        // four points end up in one register each.
+        __attribute__((target("sse2")))
+        size_t gatherXYZSse2(const uint8_t* src, size_t point_step, size_t offset_x, size_t count, float* x, float* y, float* z) {
+            // the last point may only be loaded as a whole if four more bytes follow its z field
+            size_t vector_count = (point_step >= offset_x + 16) ? count : (count > 0 ? count - 1 : 0);
+            src += offset_x;
+
+            size_t i = 0;
+            for (; i + 4 <= vector_count; i += 4) {
+                const uint8_t* point = src + i * point_step;
+                __m128 p0 = _mm_loadu_ps((const float*)point);
+                __m128 p1 = _mm_loadu_ps((const float*)(point + point_step));
+                __m128 p2 = _mm_loadu_ps((const float*)(point + 2 * point_step));
+                __m128 p3 = _mm_loadu_ps((const float*)(point + 3 * point_step));
+                _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+                _mm_storeu_ps(x + i, p0);
+                _mm_storeu_ps(y + i, p1);
+                _mm_storeu_ps(z + i, p2);
+            }
+            return i;
+        }
+
+#endif
+
+        inline bool passesFilter(float x, float y, float z, const PointFilter& filter) {
+            if (filter.crop) {
+                // written so that NaN fails every comparison
+                return (x >= filter.min[0]) && (x <= filter.max[0]) && (y >= filter.min[1]) && (y <= filter.max[1]) &&
+                        (z >= filter.min[2]) && (z <= filter.max[2]);
+            }
+            return !filter.finite || (std::isfinite(x) && std::isfinite(y) && std::isfinite(z));
+        }
+
+    }
+
+
+
+    void gatherField(const uint8_t* src, size_t point_step, size_t count, size_t offset, int datatype, float* dst) {
+        switch (datatype) {
+            case sensor_msgs::PointField::INT8:    gatherScalar<int8_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::UINT8:   gatherScalar<uint8_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::INT16:   gatherScalar<int16_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::UINT16:  gatherScalar<uint16_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::INT32:   gatherScalar<int32_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::UINT32:  gatherScalar<uint32_t>(src, point_step, count, offset, dst); break;
+            case sensor_msgs::PointField::FLOAT64: gatherScalar<double>(src, point_step, count, offset, dst); break;
+            default:                               gatherScalar<float>(src, point_step, count, offset, dst); break;
+        }
+    }
+
+    void gatherXYZ(const uint8_t* src, size_t point_step, size_t count, size_t offset_x, size_t offset_y, size_t offset_z,
+                   float* x, float* y, float* z) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2) &&
+            (offset_y == offset_x + 4) && (offset_z == offset_x + 8) && (point_step >= offset_x + 12)) {
+            done = gatherXYZSse2(src, point_step, offset_x, count, x, y, z);
+        }
+#endif
+        size_t remaining = count - done;
+        const uint8_t* rest = src + done * point_step;
+        gatherScalar<float>(rest, point_step, remaining, offset_x, x + done);
+        gatherScalar<float>(rest, point_step, remaining, offset_y, y + done);
+        gatherScalar<float>(rest, point_step, remaining, offset_z, z + done);
+    }
+
+    void gatherFixedLayout(PointLayout layout, const uint8_t* src, size_t count, float* x, float* y, float* z,
+                           const PointAttributes& attributes) {
+        switch (layout) {
+            case POINT_LAYOUT_XYZ:
+                gatherFixed<16, 0, 0, 0, 0>(src, count, x, y, z, attributes);
+                break;
+            case POINT_LAYOUT_XYZI:
+                gatherFixed<32, 0, 0, 0, 16>(src, count, x, y, z, attributes);
+                break;
+            case POINT_LAYOUT_XYZRGB:
+                gatherFixed<32, 0, 0, 16, 0>(src, count, x, y, z, attributes);
+                break;
+            case POINT_LAYOUT_NORMAL:
+                gatherFixed<48, 16, 32, 0, 0>(src, count, x, y, z, attributes);
+                break;
+            case POINT_LAYOUT_XYZRGB_NORMAL:
+                gatherFixed<48, 16, 36, 32, 0>(src, count, x, y, z, attributes);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void unpackColors(const uint8_t* src, size_t point_step, size_t count, size_t offset, float* red, float* green, float* blue) {
+        src += offset;
+        size_t i = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) i = unpackColorFieldSse2(src, point_step, count, red, green, blue);
+#endif
+        for (; i < count; i++) {
+            uint32_t packed;
+            memcpy(&packed, src + i * point_step, sizeof(packed));
+            unpackColor(packed, red + i, green + i, blue + i);
+        }
+    }
+
+    void packColors(const double* red, const double* green, const double* blue, size_t count, uint32_t* packed) {
+        size_t i = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) i = packColorsSse2(red, green, blue, count, packed);
+#endif
+        for (; i < count; i++) {
+            packed[i] = packColor(red[i], green[i], blue[i]);
+        }
+    }
+
+    void backprojectDepth(const uint8_t* depth, size_t count, bool float_depth, float scale, bool swap_bytes,
+                          const float* ray_x, const float* ray_y, float* x, float* y, float* z) {
+        if (swap_bytes) {
+            if (float_depth) {
+                backprojectScalar<true, true>(depth, 0, count, scale, ray_x, ray_y, x, y, z);
+            } else {
+                backprojectScalar<false, true>(depth, 0, count, scale, ray_x, ray_y, x, y, z);
+            }
+            return;
+        }
+
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) done = backprojectSse2(depth, count, float_depth, scale, ray_x, ray_y, x, y, z);
+#endif
+        if (float_depth) {
+            backprojectScalar<true, false>(depth, done, count, scale, ray_x, ray_y, x, y, z);
+        } else {
+            backprojectScalar<false, false>(depth, done, count, scale, ray_x, ray_y, x, y, z);
+        }
+    }
+
+    size_t compactPoints(float* x, float* y, float* z, float* const* attributes, size_t attribute_count, size_t count,
+                         const PointFilter& filter) {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!passesFilter(x[i], y[i], z[i], filter)) continue;
+            if (kept != i) {
+                x[kept] = x[i];
+                y[kept] = y[i];
+                z[kept] = z[i];
+                for (size_t j = 0; j < attribute_count; j++) {
+                    attributes[j][kept] = attributes[j][i];
+                }
+            }
+            kept++;
+        }
+        return kept;
+    }
+
+    void invalidatePoints(float* x, float* y, float* z, size_t count, const PointFilter& filter) {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        for (size_t i = 0; i < count; i++) {
+            if (!passesFilter(x[i], y[i], z[i], filter)) {
+                x[i] = y[i] = z[i] = nan;
+            }
+        }
+    }
+
+    size_t sortVoxels(const float* x, const float* y, const float* z, size_t count, float voxel_size,
+                      std::vector<std::pair<uint64_t, uint32_t> >& order) {
+        order.clear();
+        if (count == 0) {
+            return 0;
+        }
+        const float* coordinates[3] = {x, y, z};
+        double scale = 1.0 / voxel_size;
+        int64_t lowest[3], cells[3];
+        for (int axis = 0; axis < 3; axis++) {
+            const float* values = coordinates[axis];
+            float low = values[0], high = values[0];
+            for (size_t i = 1; i < count; i++) {
+                low = std::min(low, values[i]);
+                high = std::max(high, values[i]);
+            }
+            double first = std::floor(low * scale);
+            double span = std::floor(high * scale) - first + 1.0;
+            if (!(span < 9.0e18)) {
+                return 0;
+            }
+            lowest[axis] = (int64_t)first;
+            cells[axis] = (int64_t)span;
+        }
+        if ((double)cells[0] * (double)cells[1] * (double)cells[2] >= 1.8e19) {
+            return 0;
+        }
+
+        order.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t ix = (uint64_t)((int64_t)std::floor(x[i] * scale) - lowest[0]);
+            uint64_t iy = (uint64_t)((int64_t)std::floor(y[i] * scale) - lowest[1]);
+            uint64_t iz = (uint64_t)((int64_t)std::floor(z[i] * scale) - lowest[2]);
+            order[i] = std::make_pair((iz * cells[1] + iy) * cells[0] + ix, (uint32_t)i);
+        }
+        std::sort(order.begin(), order.end());
+
+        size_t voxels = 1;
+        for (size_t i = 1; i < count; i++) {
+            if (order[i].first != order[i - 1].first) voxels++;
+        }
+        return voxels;
+    }
+
+    void averageVoxels(const std::vector<std::pair<uint64_t, uint32_t> >& order, const float* const* sources, size_t array_count,
+                       float* const* destinations) {
+        std::vector<double> sums(array_count);
+        size_t voxel = 0;
+        size_t begin = 0;
+        while (begin < order.size()) {
+            size_t end = begin + 1;
+            while ((end < order.size()) && (order[end].first == order[begin].first)) end++;
+            std::fill(sums.begin(), sums.end(), 0.0);
+            for (size_t i = begin; i < end; i++) {
+                for (size_t j = 0; j < array_count; j++) {
+                    sums[j] += sources[j][order[i].second];
+                }
+            }
+            for (size_t j = 0; j < array_count; j++) {
+                destinations[j][voxel] = (float)(sums[j] / (end - begin));
+            }
+            voxel++;
+            begin = end;
+        }
+    }
+
+    void reprojectDisparity(const uint8_t* disparity, size_t count, bool swap_bytes, float min_disparity, float focal_baseline,
+                            float ray_x0, float ray_x_step, float ray_y, float* x, float* y, float* z) {
+        if (swap_bytes) {
+            reprojectScalar<true>(disparity, 0, count, min_disparity, focal_baseline, ray_x0, ray_x_step, ray_y, x, y, z);
+            return;
+        }
+
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) done = reprojectSse2(disparity, count, min_disparity, focal_baseline, ray_x0, ray_x_step, ray_y, x, y, z);
+#endif
+        reprojectScalar<false>(disparity, done, count, min_disparity, focal_baseline, ray_x0, ray_x_step, ray_y, x, y, z);
+    }
+
+    void interleaveFields(const double* const* fields, size_t field_count, size_t begin, size_t end, float* dst) {
+        for (size_t j = 0; j < field_count; j++) {
+            const double* field = fields[j];
+            float* out = dst + j;
+            if (field) {
+                for (size_t i = begin; i < end; i++) {
+                    out[i * field_count] = (float)field[i];
+                }
+            } else {
+                for (size_t i = begin; i < end; i++) {
+                    out[i * field_count] = 0.0f;
+                }
+            }
+        }
+    }
+
+}
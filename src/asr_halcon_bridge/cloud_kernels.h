@@ -0,0 +1,211 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_CLOUD_KERNELS_H
+#define ASR_HALCON_BRIDGE_CLOUD_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Gather one scalar field of every point into a contiguous float array.
+     *
+     * \param src         Start of the point data
+     * \param point_step  Distance between two points in bytes
+     * \param count       Number of points
+     * \param offset      Offset of the field inside a point
+     * \param datatype    sensor_msgs::PointField datatype of the field
+     * \param dst         Destination array with room for count values
+     */
+    void gatherField(const uint8_t* src, size_t point_step, size_t count, size_t offset, int datatype, float* dst);
+
+    /**
+     * \brief Gather the x, y and z float fields of every point into three contiguous arrays in a single pass.
+     *
+     * If the three fields directly follow each other, four points at a time are transposed with SSE.
+     */
+    void gatherXYZ(const uint8_t* src, size_t point_step, size_t count, size_t offset_x, size_t offset_y, size_t offset_z,
+                   float* x, float* y, float* z);
+
+    /**
+     * \brief Field layouts of common PCL point types, with the offsets written by pcl::toROSMsg.
+     *
+     * All of them have float x, y and z at offsets 0, 4 and 8.
+     */
+    enum PointLayout {
+        /// Any other layout, read field by field
+        POINT_LAYOUT_GENERIC,
+        /// pcl::PointXYZ, point_step 16
+        POINT_LAYOUT_XYZ,
+        /// pcl::PointXYZI, point_step 32, intensity at 16
+        POINT_LAYOUT_XYZI,
+        /// pcl::PointXYZRGB, point_step 32, rgb at 16
+        POINT_LAYOUT_XYZRGB,
+        /// pcl::PointNormal, point_step 48, normals at 16, curvature at 32
+        POINT_LAYOUT_NORMAL,
+        /// pcl::PointXYZRGBNormal, point_step 48, normals at 16, rgb at 32, curvature at 36
+        POINT_LAYOUT_XYZRGB_NORMAL
+    };
+
+    /**
+     * \brief Destination arrays of the optional attributes read by gatherFixedLayout, NULL if not wanted.
+     */
+    struct PointAttributes {
+        float* normal_x;
+        float* normal_y;
+        float* normal_z;
+        float* curvature;
+        float* red;
+        float* green;
+        float* blue;
+        float* intensity;
+    };
+
+    /**
+     * \brief Gather x, y, z and the wanted attributes the layout has of every point in a single pass.
+     *
+     * Offsets and point step are compile-time constants of the layout.
+     *
+     * \param layout       Layout of the points, not POINT_LAYOUT_GENERIC
+     * \param attributes   Destinations of the attributes, each with room for count values
+     */
+    void gatherFixedLayout(PointLayout layout, const uint8_t* src, size_t count, float* x, float* y, float* z,
+                           const PointAttributes& attributes);
+
+    /**
+     * \brief Split a packed rgb/rgba field (0xAARRGGBB, alpha ignored) into red, green and blue arrays with values 0-255.
+     */
+    void unpackColors(const uint8_t* src, size_t point_step, size_t count, size_t offset, float* red, float* green, float* blue);
+
+    /**
+     * \brief Pack red, green and blue values into the rgb format of PCL (0x00RRGGBB), clamping them to 0-255.
+     */
+    void packColors(const double* red, const double* green, const double* blue, size_t count, uint32_t* packed);
+
+    /**
+     * \brief Points to keep while gathering a point cloud.
+     */
+    struct PointFilter {
+        /// Drop points with a non-finite coordinate
+        bool finite;
+        /// Drop points outside the box from min to max (inclusive), which also drops non-finite points
+        bool crop;
+        float min[3];
+        float max[3];
+    };
+
+    /**
+     * \brief Move the points that pass the filter to the front of their arrays, keeping their order.
+     *
+     * \param attributes        Arrays with count values each, moved along with the coordinates
+     * \param attribute_count   Number of attribute arrays
+     * \return Number of points kept
+     */
+    size_t compactPoints(float* x, float* y, float* z, float* const* attributes, size_t attribute_count, size_t count,
+                         const PointFilter& filter);
+
+    /**
+     * \brief Set the coordinates of all points outside the crop box of the filter to NaN.
+     */
+    void invalidatePoints(float* x, float* y, float* z, size_t count, const PointFilter& filter);
+
+    /**
+     * \brief Sort finite points by the voxel of a regular grid that contains them.
+     *
+     * \param voxel_size  Edge length of the voxels
+     * \param order       Receives (voxel key, point index) of every point, sorted by key
+     * \return Number of occupied voxels, 0 if the points span more voxels than a 64 bit key can number
+     */
+    size_t sortVoxels(const float* x, const float* y, const float* z, size_t count, float voxel_size,
+                      std::vector<std::pair<uint64_t, uint32_t> >& order);
+
+    /**
+     * \brief Write the mean of every array over the points of each voxel found by sortVoxels.
+     *
+     * \param sources        Arrays of the points, e.g. x, y, z and the attributes
+     * \param array_count    Number of arrays
+     * \param destinations   Arrays with room for one value per occupied voxel
+     */
+    void averageVoxels(const std::vector<std::pair<uint64_t, uint32_t> >& order, const float* const* sources, size_t array_count,
+                       float* const* destinations);
+
+    /**
+     * \brief Back-project depth values along the rays of their pixels.
+     *
+     * Point i is (ray_x[i] * d, ray_y[i] * d, d), where d is depth value i times scale. Depths that are 0 or not
+     * finite give NaN coordinates.
+     *
+     * \param depth         Depth values, do not need to be aligned
+     * \param count         Number of depth values
+     * \param float_depth   The values are 32 bit floats, otherwise 16 bit unsigned integers
+     * \param scale         Factor converting the values to meters
+     * \param swap_bytes    Swap the byte order of every value while reading
+     * \param ray_x         X of the ray of every pixel at depth 1, if NULL only z is written
+     * \param ray_y         Y of the ray of every pixel at depth 1
+     */
+    void backprojectDepth(const uint8_t* depth, size_t count, bool float_depth, float scale, bool swap_bytes,
+                          const float* ray_x, const float* ray_y, float* x, float* y, float* z);
+
+    /**
+     * \brief Reproject one row of a rectified 32 bit float disparity image.
+     *
+     * Point i is (ray_x * z, ray_y * z, z) with z = focal_baseline / d and ray_x = ray_x0 + i * ray_x_step, where d
+     * is disparity value i. Disparities below min_disparity, not positive or not finite give NaN coordinates.
+     *
+     * \param disparity        Disparity values, do not need to be aligned
+     * \param count            Number of disparity values
+     * \param swap_bytes       Swap the byte order of every value while reading
+     * \param focal_baseline   Focal length in pixels times the baseline
+     */
+    void reprojectDisparity(const uint8_t* disparity, size_t count, bool swap_bytes, float min_disparity, float focal_baseline,
+                            float ray_x0, float ray_x_step, float ray_y, float* x, float* y, float* z);
+
+    /**
+     * \brief Interleave the points [begin, end) of per-point attribute arrays into packed float records.
+     *
+     * Record i consists of fields[0][i], ..., fields[field_count - 1][i]. A NULL field is written as 0.
+     *
+     * \param fields       Attribute arrays with a value for every point
+     * \param field_count  Number of attribute arrays, also the number of floats per record
+     * \param dst          Destination of all records, record i starts at dst + i * field_count
+     */
+    void interleaveFields(const double* const* fields, size_t field_count, size_t begin, size_t end, float* dst);
+
+    /**
+     * \brief Write per-point attribute arrays as packed float records into the cells of an organized grid.
+     *
+     * Point i of [begin, end) is written to the record at rows[i] * width + cols[i], records that no point maps to are
+     * left untouched. A NULL field is written as 0.
+     */
+    template<typename Index>
+    void scatterFields(const double* const* fields, size_t field_count, size_t begin, size_t end, const Index* rows,
+                       const Index* cols, size_t width, float* dst) {
+        for (size_t i = begin; i < end; i++) {
+            float* record = dst + ((size_t)rows[i] * width + (size_t)cols[i]) * field_count;
+            for (size_t j = 0; j < field_count; j++) {
+                record[j] = fields[j] ? (float)fields[j][i] : 0.0f;
+            }
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include "instrumentation.h"
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        // Every conversion is split into about this many ranges per thread, so threads that finish early can
+        // pick up the remaining work.
+        const size_t CHUNKS_PER_THREAD = 4;
+
+        // Set on the workers and on a thread while it runs a job, conversions nested into a body run inline.
+        thread_local bool inside_parallel_for = false;
+
+        class InsideParallelFor {
+            public:
+                InsideParallelFor() {
+                    inside_parallel_for = true;
+                }
+
+                ~InsideParallelFor() {
+                    inside_parallel_for = false;
+                }
+        };
+
+        struct Job {
+            const std::function<void(size_t, size_t)>* body;
+            size_t count;
+            size_t chunk_size;
+            size_t chunks;
+            /// Timer of the calling thread, allocations on the workers are counted for it
+            ScopedConversionTimer* timer;
+            std::atomic<size_t> next;
+            std::atomic<size_t> finished;
+            /// Set once a chunk has thrown, the remaining chunks are skipped
+            std::atomic<bool> failed;
+            /// First exception thrown by a chunk, guarded by the scheduler mutex
+            std::exception_ptr error;
+        };
+
+        class ConversionScheduler {
+            public:
+                static ConversionScheduler& instance() {
+                    static ConversionScheduler scheduler;
+                    return scheduler;
+                }
+
+                ~ConversionScheduler() {
+                    stopWorkers();
+                }
+
+                void setThreads(unsigned int threads) {
+                    std::lock_guard<std::mutex> job_lock(job_mutex_);
+                    stopWorkers();
+                    threads_ = (threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+                }
+
+                unsigned int getThreads() const {
+                    return threads_;
+                }
+
+                void setThreshold(size_t bytes) {
+                    threshold_ = bytes;
+                }
+
+                size_t getThreshold() const {
+                    return threshold_;
+                }
+
+                void parallelFor(size_t count, size_t bytes, const std::function<void(size_t, size_t)>& body) {
+                    unsigned int threads = threads_;
+                    if ((threads <= 1) || (count <= 1) || (bytes < threshold_) || inside_parallel_for) {
+                        body(0, count);
+                        return;
+                    }
+
+                    // conversions started from other threads while the pool is busy do not wait for it
+                    std::unique_lock<std::mutex> job_lock(job_mutex_, std::try_to_lock);
+                    if (!job_lock.owns_lock()) {
+                        body(0, count);
+                        return;
+                    }
+                    if (workers_.size() + 1 != threads_) {
+                        startWorkers(threads_ - 1);
+                    }
+
+                    std::shared_ptr<Job> job = std::make_shared<Job>();
+                    job->body = &body;
+                    job->count = count;
+                    job->chunk_size = std::max<size_t>(1, (count + threads * CHUNKS_PER_THREAD - 1) / (threads * CHUNKS_PER_THREAD));
+                    job->chunks = (count + job->chunk_size - 1) / job->chunk_size;
+                    job->timer = ScopedConversionTimer::getCurrent();
+                    job->next = 0;
+                    job->finished = 0;
+                    job->failed = false;
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        job_ = job;
+                        generation_++;
+                    }
+                    wake_.notify_all();
+
+                    {
+                        InsideParallelFor inside;
+                        runChunks(*job);
+                    }
+
+                    // body must stay alive until every chunk is done, even if one of them has thrown
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    done_.wait(lock, [&job] { return job->finished == job->chunks; });
+                    job_.reset();
+                    if (job->error) {
+                        std::rethrow_exception(job->error);
+                    }
+                }
+
+            private:
+                ConversionScheduler() :
+                    threads_(std::max(1u, std::thread::hardware_concurrency())), threshold_(1 << 20), generation_(0), stop_(false) {
+                }
+
+                void startWorkers(unsigned int count) {
+                    stopWorkers();
+                    // the workers wait for the next job, even if it is published before they get to run
+                    for (unsigned int i = 0; i < count; i++) {
+                        workers_.push_back(std::thread(&ConversionScheduler::workerLoop, this, generation_));
+                    }
+                }
+
+                void stopWorkers() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        stop_ = true;
+                    }
+                    wake_.notify_all();
+                    for (size_t i = 0; i < workers_.size(); i++) {
+                        workers_[i].join();
+                    }
+                    workers_.clear();
+                    stop_ = false;
+                }
+
+                void workerLoop(unsigned long seen) {
+                    inside_parallel_for = true;
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    while (true) {
+                        wake_.wait(lock, [this, seen] { return stop_ || (generation_ != seen); });
+                        if (stop_) return;
+                        seen = generation_;
+                        std::shared_ptr<Job> job = job_;
+                        lock.unlock();
+                        if (job) {
+                            ScopedConversionTimer::Forward forward(job->timer);
+                            runChunks(*job);
+                        }
+                        lock.lock();
+                    }
+                }
+
+                void runChunks(Job& job) {
+                    size_t done = 0;
+                    while (true) {
+                        size_t chunk = job.next++;
+                        if (chunk >= job.chunks) break;
+                        done++;
+                        if (job.failed) continue;
+                        size_t begin = chunk * job.chunk_size;
+                        try {
+                            (*job.body)(begin, std::min(begin + job.chunk_size, job.count));
+                        } catch (...) {
+                            std::lock_guard<std::mutex> lock(mutex_);
+                            if (!job.error) job.error = std::current_exception();
+                            job.failed = true;
+                        }
+                    }
+                    if ((done > 0) && (job.finished.fetch_add(done) + done == job.chunks)) {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        done_.notify_all();
+                    }
+                }
+
+                std::atomic<unsigned int> threads_;
+                std::atomic<size_t> threshold_;
+
+                std::mutex job_mutex_;
+                std::mutex mutex_;
+                std::condition_variable wake_;
+                std::condition_variable done_;
+                std::vector<std::thread> workers_;
+                std::shared_ptr<Job> job_;
+                unsigned long generation_;
+                bool stop_;
+        };
+
+    }
+
+
+
+    void setConversionThreads(unsigned int threads) {
+        ConversionScheduler::instance().setThreads(threads);
+    }
+
+    unsigned int getConversionThreads() {
+        return ConversionScheduler::instance().getThreads();
+    }
+
+    void setParallelConversionThreshold(size_t bytes) {
+        ConversionScheduler::instance().setThreshold(bytes);
+    }
+
+    size_t getParallelConversionThreshold() {
+        return ConversionScheduler::instance().getThreshold();
+    }
+
+    void parallelFor(size_t count, size_t bytes, const std::function<void(size_t, size_t)>& body) {
+        ConversionScheduler::instance().parallelFor(count, bytes, body);
+    }
+
+}
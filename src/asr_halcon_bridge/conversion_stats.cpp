@@ -0,0 +1,153 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "instrumentation.h"
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        const char* FUNCTION_NAMES[CONVERSION_FUNCTION_COUNT] = {
+            "toHalconCopy(Image)",
+            "toHalconShare(Image)",
+            "toImageMsg",
+            "toHalconCopy(PointCloud2)",
+            "toPointcloudMsg",
+            "toHalconCopy(CompressedImage)",
+            "toCompressedImageMsg",
+            "toHalconDepth",
+            "toHalconPointcloud(depth Image)",
+            "toHalconCopy(Image batch)",
+            "toHalconCopy(DisparityImage)",
+            "toDisparityMsg",
+            "toHalconPointcloud(DisparityImage)"
+        };
+
+        // every function on its own cache line, concurrent conversions of different kinds do not contend
+        struct alignas(64) FunctionCounters {
+            std::atomic<unsigned long> calls;
+            std::atomic<unsigned long long> bytes;
+            std::atomic<unsigned long> allocations;
+            std::atomic<uint64_t> max_nanoseconds;
+            std::atomic<unsigned long> latency_bins[LATENCY_BINS];
+        };
+
+        FunctionCounters counters[CONVERSION_FUNCTION_COUNT];
+
+        thread_local ScopedConversionTimer* current_timer = NULL;
+
+    }
+
+
+
+    ScopedConversionTimer::ScopedConversionTimer(ConversionFunction function) :
+            function_(function), bytes_(0), allocations_(0), outer_(current_timer) {
+        active_ = !(outer_ && (outer_->function_ == function));
+        if (active_) {
+            current_timer = this;
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedConversionTimer::~ScopedConversionTimer() {
+        if (!active_) {
+            if (outer_) outer_->addBytes(bytes_);
+            return;
+        }
+        uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        current_timer = outer_;
+
+        FunctionCounters& function = counters[function_];
+        function.calls.fetch_add(1, std::memory_order_relaxed);
+        function.bytes.fetch_add(bytes_, std::memory_order_relaxed);
+        function.allocations.fetch_add(allocations_, std::memory_order_relaxed);
+        function.latency_bins[getLatencyBin(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max_nanoseconds = function.max_nanoseconds.load(std::memory_order_relaxed);
+        while ((nanoseconds > max_nanoseconds) &&
+               !function.max_nanoseconds.compare_exchange_weak(max_nanoseconds, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    void ScopedConversionTimer::addAllocation() {
+        if (current_timer) {
+            current_timer->allocations_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ScopedConversionTimer* ScopedConversionTimer::getCurrent() {
+        return current_timer;
+    }
+
+    ScopedConversionTimer::Forward::Forward(ScopedConversionTimer* timer) : previous_(current_timer) {
+        current_timer = timer;
+    }
+
+    ScopedConversionTimer::Forward::~Forward() {
+        current_timer = previous_;
+    }
+
+
+
+    bool isConversionStatsEnabled() {
+#ifdef HALCON_BRIDGE_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    ConversionStats getConversionStats(ConversionFunction function) {
+        const FunctionCounters& counter = counters[function];
+        ConversionStats stats;
+        stats.function = FUNCTION_NAMES[function];
+        stats.calls = counter.calls.load(std::memory_order_relaxed);
+        stats.bytes = counter.bytes.load(std::memory_order_relaxed);
+        stats.allocations = counter.allocations.load(std::memory_order_relaxed);
+        uint64_t max_nanoseconds = counter.max_nanoseconds.load(std::memory_order_relaxed);
+        stats.p50_latency = getLatencyPercentile(counter.latency_bins, stats.calls, 0.5, max_nanoseconds);
+        stats.p99_latency = getLatencyPercentile(counter.latency_bins, stats.calls, 0.99, max_nanoseconds);
+        stats.max_latency = max_nanoseconds * 1e-9;
+        return stats;
+    }
+
+    std::vector<ConversionStats> getConversionStats() {
+        std::vector<ConversionStats> stats;
+        for (int i = 0; i < CONVERSION_FUNCTION_COUNT; i++) {
+            stats.push_back(getConversionStats((ConversionFunction)i));
+        }
+        return stats;
+    }
+
+    void resetConversionStats() {
+        for (int i = 0; i < CONVERSION_FUNCTION_COUNT; i++) {
+            FunctionCounters& counter = counters[i];
+            counter.calls.store(0, std::memory_order_relaxed);
+            counter.bytes.store(0, std::memory_order_relaxed);
+            counter.allocations.store(0, std::memory_order_relaxed);
+            counter.max_nanoseconds.store(0, std::memory_order_relaxed);
+            for (int bin = 0; bin < LATENCY_BINS; bin++) {
+                counter.latency_bins[bin].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,74 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/conversion_stats_publisher.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include <sstream>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        template<typename T>
+        diagnostic_msgs::KeyValue makeKeyValue(const std::string& key, const T& value) {
+            std::ostringstream stream;
+            stream << value;
+            diagnostic_msgs::KeyValue key_value;
+            key_value.key = key;
+            key_value.value = stream.str();
+            return key_value;
+        }
+
+    }
+
+    ConversionStatsPublisher::ConversionStatsPublisher(ros::NodeHandle& nh, double rate, const std::string& name) : name_(name) {
+        if (!(rate > 0.0)) {
+            throw Exception("Conversion statistics need a positive publishing rate");
+        }
+        publisher_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+        timer_ = nh.createTimer(ros::Duration(1.0 / rate), &ConversionStatsPublisher::timerCallback, this);
+    }
+
+    void ConversionStatsPublisher::publish() {
+        diagnostic_msgs::DiagnosticArray array;
+        array.header.stamp = ros::Time::now();
+
+        std::vector<ConversionStats> stats = getConversionStats();
+        for (size_t i = 0; i < stats.size(); i++) {
+            diagnostic_msgs::DiagnosticStatus status;
+            status.level = diagnostic_msgs::DiagnosticStatus::OK;
+            status.name = name_ + ": " + stats[i].function;
+            status.message = isConversionStatsEnabled() ? "OK" : "Instrumentation not compiled in";
+            status.values.push_back(makeKeyValue("calls", stats[i].calls));
+            status.values.push_back(makeKeyValue("bytes", stats[i].bytes));
+            status.values.push_back(makeKeyValue("allocations", stats[i].allocations));
+            status.values.push_back(makeKeyValue("p50 latency [ms]", stats[i].p50_latency * 1e3));
+            status.values.push_back(makeKeyValue("p99 latency [ms]", stats[i].p99_latency * 1e3));
+            status.values.push_back(makeKeyValue("max latency [ms]", stats[i].max_latency * 1e3));
+            array.status.push_back(status);
+        }
+
+        publisher_.publish(array);
+    }
+
+    void ConversionStatsPublisher::timerCallback(const ros::TimerEvent&) {
+        publish();
+    }
+
+}
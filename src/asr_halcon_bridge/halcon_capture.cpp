@@ -0,0 +1,675 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_capture.h>
+#include <boost/make_shared.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace halcon_bridge {
+
+    // defined in halcon_image.cpp
+    int getHalconTypeSize(const std::string& type);
+
+    namespace {
+
+        const char FILE_MAGIC[8] = {'H', 'B', 'C', 'A', 'P', 'T', 'R', '\0'};
+        const uint32_t FILE_VERSION = 1;
+        const uint32_t BYTE_ORDER_MARK = 0x01020304;
+        const uint32_t RECORD_MAGIC = 0x43524248;
+        const uint32_t INDEX_MAGIC = 0x58494248;
+        /// Alignment of every record and array in the file
+        const uint64_t ALIGNMENT = 64;
+
+        /// The record contains a HObjectModel3D
+        const uint32_t FLAG_MODEL = 1;
+        /// The point cloud is organized, its coordinates are stored as X/Y/Z images
+        const uint32_t FLAG_ORGANIZED = 2;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order;
+            uint8_t reserved[48];
+        };
+
+        /**
+         * \brief Start of every record.
+         *
+         * It is followed by the frame id, a block of zero terminated names and the domain as run-length encoded
+         * (row, first column, last column) int32 triples, the arrays start at the next aligned offset.
+         */
+        struct RecordHeader {
+            uint32_t magic;
+            uint32_t type;
+            /// Size of the whole record including padding
+            uint64_t size;
+            int64_t stamp;
+            uint32_t seq;
+            /// Image size, or grid size of organized point clouds
+            uint32_t width;
+            uint32_t height;
+            /// Image channels, or point cloud attributes besides x, y and z
+            uint32_t array_count;
+            uint32_t type_size;
+            /// Runs of the domain, 0 for a full domain
+            uint32_t run_count;
+            uint64_t point_count;
+            uint16_t frame_id_length;
+            uint16_t names_length;
+            uint32_t flags;
+        };
+
+        struct Footer {
+            uint64_t index_offset;
+            uint64_t record_count;
+            uint32_t magic;
+            uint32_t version;
+        };
+
+        inline uint64_t align(uint64_t size) {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        int64_t toNanoseconds(const ros::Time& stamp) {
+            return (int64_t)stamp.sec * 1000000000LL + stamp.nsec;
+        }
+
+        ros::Time fromNanoseconds(int64_t stamp) {
+            ros::Time time;
+            time.sec = (uint32_t)(stamp / 1000000000LL);
+            time.nsec = (uint32_t)(stamp % 1000000000LL);
+            return time;
+        }
+
+        /**
+         * \brief Offsets of the parts of a record relative to its start.
+         */
+        struct RecordLayout {
+            uint64_t runs;
+            uint64_t arrays;
+            /// Size of one image plane or coordinate array
+            uint64_t plane_size;
+            uint64_t size;
+        };
+
+        RecordLayout getRecordLayout(const RecordHeader& header) {
+            RecordLayout layout;
+            layout.runs = align(sizeof(RecordHeader) + header.frame_id_length + header.names_length);
+            layout.arrays = layout.runs + align((uint64_t)header.run_count * 3 * sizeof(int32_t));
+            uint64_t cells = (uint64_t)header.width * header.height;
+            if (header.type == CAPTURE_IMAGE) {
+                layout.plane_size = cells * header.type_size;
+                layout.size = layout.arrays + header.array_count * align(layout.plane_size);
+            } else {
+                layout.plane_size = ((header.flags & FLAG_ORGANIZED) ? cells : header.point_count) * sizeof(float);
+                layout.size = layout.arrays + 3 * align(layout.plane_size) +
+                        align((uint64_t)header.array_count * header.point_count * sizeof(float));
+            }
+            return layout;
+        }
+
+        /**
+         * \brief Get the runs of a domain, none if it covers the whole image.
+         */
+        std::vector<int32_t> getDomainRuns(const HalconCpp::HImage& image, Hlong width, Hlong height) {
+            std::vector<int32_t> runs;
+            HalconCpp::HRegion domain = image.GetDomain();
+            if (domain.Area() == width * height) {
+                return runs;
+            }
+            HalconCpp::HTuple rows, column_begins, column_ends;
+            domain.GetRegionRuns(&rows, &column_begins, &column_ends);
+            runs.resize(rows.Length() * 3);
+            for (Hlong i = 0; i < rows.Length(); i++) {
+                runs[3 * i] = (Hlong)rows[i];
+                runs[3 * i + 1] = (Hlong)column_begins[i];
+                runs[3 * i + 2] = (Hlong)column_ends[i];
+            }
+            return runs;
+        }
+
+        HalconCpp::HRegion getDomainRegion(const int32_t* runs, size_t run_count) {
+            std::vector<Hlong> rows(run_count), column_begins(run_count), column_ends(run_count);
+            for (size_t i = 0; i < run_count; i++) {
+                rows[i] = runs[3 * i];
+                column_begins[i] = runs[3 * i + 1];
+                column_ends[i] = runs[3 * i + 2];
+            }
+            HalconCpp::HRegion domain;
+            if (run_count == 0) {
+                domain.GenRegionRuns(HalconCpp::HTuple(), HalconCpp::HTuple(), HalconCpp::HTuple());
+            } else {
+                domain.GenRegionRuns(HalconCpp::HTuple(&rows[0], (Hlong)run_count),
+                                     HalconCpp::HTuple(&column_begins[0], (Hlong)run_count),
+                                     HalconCpp::HTuple(&column_ends[0], (Hlong)run_count));
+            }
+            return domain;
+        }
+
+        /**
+         * \brief Get a model attribute as float array, or false if it does not have one value per point.
+         */
+        bool getAttribute(const HalconCpp::HObjectModel3D& model, const char* name, size_t point_count, std::vector<float>& values) {
+            HalconCpp::HTuple tuple = model.GetObjectModel3dParams(name);
+            if ((size_t)tuple.Length() != point_count) {
+                return false;
+            }
+            if (tuple.Type() != HalconCpp::eTupleTypeDouble) {
+                tuple = tuple.TupleReal();
+            }
+            const double* data = tuple.DArr();
+            values.resize(point_count);
+            for (size_t i = 0; i < point_count; i++) {
+                values[i] = (float)data[i];
+            }
+            return true;
+        }
+
+        const float* getImagePlane(const HalconCpp::HImage& image, Hlong width, Hlong height) {
+            HalconCpp::HString type;
+            Hlong plane_width, plane_height;
+            const float* plane = (const float*)image.GetImagePointer1(&type, &plane_width, &plane_height);
+            if (((std::string)type != "real") || (plane_width != width) || (plane_height != height)) {
+                throw Exception("X/Y/Z images of the point cloud have to be real images of the same size");
+            }
+            return plane;
+        }
+
+    }
+
+
+
+    HalconCaptureWriter::HalconCaptureWriter(const std::string& path) : path_(path), file_(NULL), offset_(0) {
+        file_ = fopen(path.c_str(), "wb");
+        if (!file_) {
+            throw Exception("Could not create capture file " + path + ": " + strerror(errno));
+        }
+        // the records are large, fewer but bigger writes keep the disk streaming
+        setvbuf(file_, NULL, _IOFBF, 1 << 20);
+
+        FileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        writeData(&header, sizeof(header));
+    }
+
+    HalconCaptureWriter::~HalconCaptureWriter() {
+        try {
+            close();
+        } catch (const Exception&) {
+            // nothing left to report to, the index is rebuilt when the file is read
+        }
+    }
+
+    size_t HalconCaptureWriter::size() const {
+        return index_.size();
+    }
+
+    void HalconCaptureWriter::writeData(const void* data, size_t size) {
+        if (!file_) {
+            throw Exception("Capture file " + path_ + " is closed");
+        }
+        if ((size > 0) && (fwrite(data, 1, size, file_) != size)) {
+            throw Exception("Could not write capture file " + path_ + ": " + strerror(errno));
+        }
+        offset_ += size;
+    }
+
+    void HalconCaptureWriter::pad() {
+        static const uint8_t zeros[ALIGNMENT] = {0};
+        writeData(zeros, align(offset_) - offset_);
+    }
+
+    void HalconCaptureWriter::write(const HalconImage& image) {
+        if (!image.image) {
+            throw Exception("Image is empty");
+        }
+        Hlong channels = image.image->CountChannels();
+        if ((channels != 1) && (channels != 3) && (channels != 4)) {
+            throw Exception("Only images with 1, 3 or 4 channels can be captured");
+        }
+        std::vector<const void*> planes(channels);
+        HalconCpp::HString type;
+        Hlong width, height;
+        if (channels == 1) {
+            planes[0] = image.image->GetImagePointer1(&type, &width, &height);
+        } else {
+            for (Hlong i = 0; i < channels; i++) {
+                planes[i] = image.image->AccessChannel(i + 1).GetImagePointer1(&type, &width, &height);
+            }
+        }
+        std::string names = image.encoding + '\0' + (std::string)type + '\0';
+        std::vector<int32_t> runs = getDomainRuns(*image.image, width, height);
+
+        RecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = RECORD_MAGIC;
+        header.type = CAPTURE_IMAGE;
+        header.stamp = toNanoseconds(image.header.stamp);
+        header.seq = image.header.seq;
+        header.width = width;
+        header.height = height;
+        header.array_count = channels;
+        header.type_size = getHalconTypeSize((std::string)type);
+        if (header.type_size == (uint32_t)-1) {
+            throw Exception("Image type " + (std::string)type + " cannot be captured");
+        }
+        header.run_count = runs.size() / 3;
+        header.frame_id_length = image.header.frame_id.size();
+        header.names_length = names.size();
+        RecordLayout layout = getRecordLayout(header);
+        header.size = layout.size;
+
+        CaptureIndexEntry entry = {header.stamp, offset_, CAPTURE_IMAGE, 0};
+        writeData(&header, sizeof(header));
+        writeData(image.header.frame_id.data(), header.frame_id_length);
+        writeData(names.data(), names.size());
+        pad();
+        writeData(runs.empty() ? NULL : &runs[0], runs.size() * sizeof(int32_t));
+        pad();
+        for (Hlong i = 0; i < channels; i++) {
+            writeData(planes[i], layout.plane_size);
+            pad();
+        }
+        index_.push_back(entry);
+    }
+
+    void HalconCaptureWriter::write(const HalconPointcloud& pointcloud) {
+        RecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = RECORD_MAGIC;
+        header.type = CAPTURE_POINTCLOUD;
+        header.stamp = toNanoseconds(pointcloud.header.stamp);
+        header.seq = pointcloud.header.seq;
+        header.type_size = sizeof(float);
+        header.frame_id_length = pointcloud.header.frame_id.size();
+
+        bool organized = pointcloud.x_image.IsInitialized();
+        size_t point_count = pointcloud.model ? (Hlong)pointcloud.model->GetObjectModel3dParams("num_points")[0] : 0;
+        header.point_count = point_count;
+        header.flags = (pointcloud.model ? FLAG_MODEL : 0) | (organized ? FLAG_ORGANIZED : 0);
+
+        const float* coordinates[3];
+        std::vector<float> coordinate_values[3];
+        std::vector<int32_t> runs;
+        if (organized) {
+            Hlong width = pointcloud.x_image.Width();
+            Hlong height = pointcloud.x_image.Height();
+            coordinates[0] = getImagePlane(pointcloud.x_image, width, height);
+            coordinates[1] = getImagePlane(pointcloud.y_image, width, height);
+            coordinates[2] = getImagePlane(pointcloud.z_image, width, height);
+            runs = getDomainRuns(pointcloud.x_image, width, height);
+            header.width = width;
+            header.height = height;
+        } else {
+            if (!pointcloud.model) {
+                throw Exception("Point cloud is empty");
+            }
+            const char* coordinate_names[3] = {"point_coord_x", "point_coord_y", "point_coord_z"};
+            for (int i = 0; i < 3; i++) {
+                if (!getAttribute(*pointcloud.model, coordinate_names[i], point_count, coordinate_values[i])) {
+                    throw Exception("Point cloud model has no coordinates");
+                }
+                coordinates[i] = (point_count > 0) ? &coordinate_values[i][0] : NULL;
+            }
+            header.width = point_count;
+            header.height = 1;
+        }
+        header.run_count = runs.size() / 3;
+
+        // normals first, then the extended attributes, so each group can be restored from one contiguous array
+        std::string names;
+        std::vector<float> attributes, values;
+        if (pointcloud.model && (point_count > 0)) {
+            if (((HalconCpp::HString)pointcloud.model->GetObjectModel3dParams("has_point_normals")) == HalconCpp::HString("true")) {
+                const char* normal_names[3] = {"point_normal_x", "point_normal_y", "point_normal_z"};
+                for (int i = 0; i < 3; i++) {
+                    if (!getAttribute(*pointcloud.model, normal_names[i], point_count, values)) {
+                        throw Exception("Point cloud model has no normal for every point");
+                    }
+                    attributes.insert(attributes.end(), values.begin(), values.end());
+                    names += normal_names[i];
+                    names += '\0';
+                    header.array_count++;
+                }
+            }
+            HalconCpp::HTuple attribute_names = pointcloud.model->GetObjectModel3dParams("extended_attribute_names");
+            for (Hlong i = 0; i < attribute_names.Length(); i++) {
+                HalconCpp::HString name = attribute_names[i];
+                if (getAttribute(*pointcloud.model, name, point_count, values)) {
+                    attributes.insert(attributes.end(), values.begin(), values.end());
+                    names += (const char*)name;
+                    names += '\0';
+                    header.array_count++;
+                }
+            }
+        }
+        if (names.size() > 0xFFFF) {
+            throw Exception("Too many point cloud attributes to capture");
+        }
+        header.names_length = names.size();
+        RecordLayout layout = getRecordLayout(header);
+        header.size = layout.size;
+
+        CaptureIndexEntry entry = {header.stamp, offset_, CAPTURE_POINTCLOUD, 0};
+        writeData(&header, sizeof(header));
+        writeData(pointcloud.header.frame_id.data(), header.frame_id_length);
+        writeData(names.data(), names.size());
+        pad();
+        writeData(runs.empty() ? NULL : &runs[0], runs.size() * sizeof(int32_t));
+        pad();
+        for (int i = 0; i < 3; i++) {
+            writeData(coordinates[i], layout.plane_size);
+            pad();
+        }
+        writeData(attributes.empty() ? NULL : &attributes[0], attributes.size() * sizeof(float));
+        pad();
+        index_.push_back(entry);
+    }
+
+    void HalconCaptureWriter::close() {
+        if (!file_) {
+            return;
+        }
+        Footer footer;
+        memset(&footer, 0, sizeof(footer));
+        footer.index_offset = offset_;
+        footer.record_count = index_.size();
+        footer.magic = INDEX_MAGIC;
+        footer.version = FILE_VERSION;
+        writeData(index_.empty() ? NULL : &index_[0], index_.size() * sizeof(CaptureIndexEntry));
+        writeData(&footer, sizeof(footer));
+
+        int result = fclose(file_);
+        file_ = NULL;
+        if (result != 0) {
+            throw Exception("Could not write capture file " + path_ + ": " + strerror(errno));
+        }
+    }
+
+
+
+    struct HalconCaptureReader::Mapping {
+        uint8_t* data;
+        size_t size;
+
+        Mapping() : data(NULL), size(0) {}
+
+        ~Mapping() {
+            if (data) {
+                munmap(data, size);
+            }
+        }
+    };
+
+    HalconCaptureReader::HalconCaptureReader(const std::string& path) : first_stamp_(0), bucket_duration_(1) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw Exception("Could not open capture file " + path + ": " + strerror(errno));
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw Exception("Could not open capture file " + path + ": " + strerror(errno));
+        }
+        mapping_ = boost::make_shared<Mapping>();
+        mapping_->size = status.st_size;
+        if (mapping_->size >= sizeof(FileHeader)) {
+            // a private writable mapping, so Halcon operators that write into an image only touch their own copy of the page
+            void* data = mmap(NULL, mapping_->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                mapping_->data = (uint8_t*)data;
+            }
+        }
+        ::close(fd);
+        if (!mapping_->data) {
+            throw Exception("Could not map capture file " + path);
+        }
+
+        const FileHeader* file_header = (const FileHeader*)mapping_->data;
+        if (memcmp(file_header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+            throw Exception(path + " is not a capture file");
+        }
+        if (file_header->byte_order != BYTE_ORDER_MARK) {
+            throw Exception("Capture file " + path + " was written on a machine with a different byte order");
+        }
+        if (file_header->version != FILE_VERSION) {
+            throw Exception("Capture file " + path + " has an unsupported version");
+        }
+
+        // the end of a file that was not closed is not aligned, so the footer is copied out
+        Footer footer;
+        bool has_index = false;
+        if (mapping_->size >= sizeof(FileHeader) + sizeof(Footer)) {
+            uint64_t index_end = mapping_->size - sizeof(Footer);
+            memcpy(&footer, mapping_->data + index_end, sizeof(Footer));
+            has_index = (footer.magic == INDEX_MAGIC) && (footer.index_offset <= index_end) &&
+                    (footer.record_count * sizeof(CaptureIndexEntry) == index_end - footer.index_offset);
+        }
+        if (has_index) {
+            index_.resize(footer.record_count);
+            if (!index_.empty()) {
+                memcpy(&index_[0], mapping_->data + footer.index_offset, index_.size() * sizeof(CaptureIndexEntry));
+            }
+        } else {
+            // the writer was not closed, collect the records that were written completely
+            uint64_t offset = sizeof(FileHeader);
+            while (offset + sizeof(RecordHeader) <= mapping_->size) {
+                const RecordHeader* header = (const RecordHeader*)(mapping_->data + offset);
+                if ((header->magic != RECORD_MAGIC) || (header->size < sizeof(RecordHeader)) ||
+                        (header->size > mapping_->size - offset)) {
+                    break;
+                }
+                CaptureIndexEntry entry = {header->stamp, offset, header->type, 0};
+                index_.push_back(entry);
+                offset += header->size;
+            }
+        }
+
+        // records are numbered in stamp order, so a stream recorded from several topics replays in order
+        std::stable_sort(index_.begin(), index_.end(), [](const CaptureIndexEntry& a, const CaptureIndexEntry& b) {
+            return a.stamp < b.stamp;
+        });
+
+        if (!index_.empty()) {
+            first_stamp_ = index_.front().stamp;
+            size_t bucket_count = index_.size();
+            bucket_duration_ = (index_.back().stamp - first_stamp_) / (int64_t)bucket_count + 1;
+            buckets_.resize(bucket_count);
+            size_t record = 0;
+            for (size_t bucket = 0; bucket < bucket_count; bucket++) {
+                int64_t bucket_start = first_stamp_ + (int64_t)bucket * bucket_duration_;
+                while ((record < index_.size()) && (index_[record].stamp < bucket_start)) record++;
+                buckets_[bucket] = record;
+            }
+        }
+    }
+
+    HalconCaptureReader::~HalconCaptureReader() {
+    }
+
+    size_t HalconCaptureReader::size() const {
+        return index_.size();
+    }
+
+    CaptureRecordType HalconCaptureReader::getType(size_t index) const {
+        if (index >= index_.size()) {
+            throw Exception("Capture record index out of range");
+        }
+        return (CaptureRecordType)index_[index].type;
+    }
+
+    ros::Time HalconCaptureReader::getStamp(size_t index) const {
+        if (index >= index_.size()) {
+            throw Exception("Capture record index out of range");
+        }
+        return fromNanoseconds(index_[index].stamp);
+    }
+
+    size_t HalconCaptureReader::seek(const ros::Time& stamp) const {
+        if (index_.empty()) {
+            return 0;
+        }
+        int64_t nanoseconds = toNanoseconds(stamp);
+        if (nanoseconds <= first_stamp_) {
+            return 0;
+        }
+        size_t bucket = std::min<int64_t>((nanoseconds - first_stamp_) / bucket_duration_, buckets_.size() - 1);
+        size_t record = buckets_[bucket];
+        while ((record < index_.size()) && (index_[record].stamp < nanoseconds)) record++;
+        return record;
+    }
+
+    const uint8_t* HalconCaptureReader::getRecord(size_t index, CaptureRecordType type, std_msgs::Header& header) const {
+        if (index >= index_.size()) {
+            throw Exception("Capture record index out of range");
+        }
+        uint64_t offset = index_[index].offset;
+        if ((index_[index].type != (uint32_t)type) || (offset + sizeof(RecordHeader) > mapping_->size)) {
+            throw Exception("Capture record has the wrong type");
+        }
+        const uint8_t* record = mapping_->data + offset;
+        const RecordHeader* record_header = (const RecordHeader*)record;
+        if ((record_header->magic != RECORD_MAGIC) || (record_header->type != (uint32_t)type) ||
+                (record_header->size > mapping_->size - offset) || (getRecordLayout(*record_header).size > record_header->size)) {
+            throw Exception("Capture record is corrupt");
+        }
+        header.stamp = fromNanoseconds(record_header->stamp);
+        header.seq = record_header->seq;
+        header.frame_id.assign((const char*)record + sizeof(RecordHeader), record_header->frame_id_length);
+        return record;
+    }
+
+    HalconImageConstPtr HalconCaptureReader::readImage(size_t index) const {
+        HalconImagePtr ptr = boost::make_shared<HalconImage>();
+        const uint8_t* record = getRecord(index, CAPTURE_IMAGE, ptr->header);
+        const RecordHeader& header = *(const RecordHeader*)record;
+        RecordLayout layout = getRecordLayout(header);
+
+        const char* names = (const char*)record + sizeof(RecordHeader) + header.frame_id_length;
+        if ((header.names_length == 0) || (names[header.names_length - 1] != '\0')) {
+            throw Exception("Capture record is corrupt");
+        }
+        ptr->encoding = names;
+        const char* type = names + ptr->encoding.size() + 1;
+
+        // the planes are wrapped where they are mapped, the reader's mapping is kept alive by the image instead
+        void* planes[4];
+        for (uint32_t i = 0; (i < header.array_count) && (i < 4); i++) {
+            planes[i] = (void*)(record + layout.arrays + i * align(layout.plane_size));
+        }
+        ptr->image = new HalconCpp::HImage();
+        if (header.array_count == 1) {
+            ptr->image->GenImage1Extern(type, header.width, header.height, planes[0], NULL);
+        } else if (header.array_count == 3) {
+            ptr->image->GenImage3Extern(type, header.width, header.height, planes[0], planes[1], planes[2], NULL);
+        } else if (header.array_count == 4) {
+            HalconCpp::HImage channels[4];
+            for (int i = 0; i < 4; i++) {
+                channels[i].GenImage1Extern(type, header.width, header.height, planes[i], NULL);
+            }
+            *ptr->image = channels[0].Compose4(channels[1], channels[2], channels[3]);
+        } else {
+            throw Exception("Capture record is corrupt");
+        }
+        if (header.run_count > 0) {
+            *ptr->image = ptr->image->ReduceDomain(getDomainRegion((const int32_t*)(record + layout.runs), header.run_count));
+        }
+        ptr->tracked_object_ = mapping_;
+        return ptr;
+    }
+
+    HalconPointcloudConstPtr HalconCaptureReader::readPointcloud(size_t index) const {
+        HalconPointcloudPtr ptr = boost::make_shared<HalconPointcloud>();
+        const uint8_t* record = getRecord(index, CAPTURE_POINTCLOUD, ptr->header);
+        const RecordHeader& header = *(const RecordHeader*)record;
+        RecordLayout layout = getRecordLayout(header);
+
+        float* coordinates[3];
+        for (int i = 0; i < 3; i++) {
+            coordinates[i] = (float*)(record + layout.arrays + i * align(layout.plane_size));
+        }
+        const float* attributes = (const float*)(record + layout.arrays + 3 * align(layout.plane_size));
+        size_t point_count = header.point_count;
+
+        if (header.flags & FLAG_ORGANIZED) {
+            ptr->x_image.GenImage1Extern("real", header.width, header.height, coordinates[0], NULL);
+            ptr->y_image.GenImage1Extern("real", header.width, header.height, coordinates[1], NULL);
+            ptr->z_image.GenImage1Extern("real", header.width, header.height, coordinates[2], NULL);
+            if (header.run_count > 0) {
+                // the model points and attributes follow the domain, so it is restored exactly as it was written
+                HalconCpp::HRegion domain = getDomainRegion((const int32_t*)(record + layout.runs), header.run_count);
+                ptr->x_image = ptr->x_image.ReduceDomain(domain);
+                ptr->y_image = ptr->y_image.ReduceDomain(domain);
+                ptr->z_image = ptr->z_image.ReduceDomain(domain);
+            }
+            if (header.flags & FLAG_MODEL) {
+                ptr->model = new HalconCpp::HObjectModel3D(ptr->x_image, ptr->y_image, ptr->z_image);
+                // the attributes are stored for point_count points, which the rebuilt model must have
+                if ((size_t)(Hlong)ptr->model->GetObjectModel3dParams("num_points")[0] != point_count) {
+                    throw Exception("Capture record is corrupt, its point count does not match the domain of its X/Y/Z images");
+                }
+            }
+        } else if (header.flags & FLAG_MODEL) {
+            ptr->model = new HalconCpp::HObjectModel3D(HalconCpp::HTuple(coordinates[0], (Hlong)point_count),
+                                                       HalconCpp::HTuple(coordinates[1], (Hlong)point_count),
+                                                       HalconCpp::HTuple(coordinates[2], (Hlong)point_count));
+        }
+
+        if (ptr->model && (header.array_count > 0)) {
+            const char* names = (const char*)record + sizeof(RecordHeader) + header.frame_id_length;
+            if ((header.names_length == 0) || (names[header.names_length - 1] != '\0')) {
+                throw Exception("Capture record is corrupt");
+            }
+            // the normals and the extended attributes are each stored contiguously and restored with one call
+            HalconCpp::HTuple standard_names, extended_names;
+            const char* name = names;
+            for (uint32_t i = 0; (i < header.array_count) && (name < names + header.names_length); i++) {
+                if (name[0] == '&') {
+                    extended_names.Append(name);
+                } else {
+                    standard_names.Append(name);
+                }
+                name += strlen(name) + 1;
+            }
+            Hlong standard_count = standard_names.Length();
+            Hlong extended_count = extended_names.Length();
+            if (standard_count > 0) {
+                ptr->model->SetObjectModel3dAttribMod(standard_names, "",
+                                                      HalconCpp::HTuple(attributes, (Hlong)(standard_count * point_count)));
+            }
+            if (extended_count > 0) {
+                ptr->model->SetObjectModel3dAttribMod(extended_names, "points",
+                                                      HalconCpp::HTuple(attributes + standard_count * point_count,
+                                                                        (Hlong)(extended_count * point_count)));
+            }
+        }
+        ptr->tracked_object_ = mapping_;
+        return ptr;
+    }
+
+}
@@ -0,0 +1,630 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_compressed_image.h>
+#include "image_kernels.h"
+#include "instrumentation.h"
+#include "pooled_buffers.h"
+#include <sensor_msgs/image_encodings.h>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <jpeglib.h>
+#include <png.h>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        // rows handed to the codecs per call, the interleaved strip stays small enough for the cache
+        const size_t STRIP_ROWS = 16;
+
+        bool isHostLittleEndian() {
+            const uint16_t probe = 1;
+            return *(const uint8_t*)&probe == 1;
+        }
+
+        /**
+         * \brief Planes from the image buffer pool that are released unless they are handed to a HImage.
+         */
+        class PlaneSet {
+            public:
+                PlaneSet(int count, size_t size) : count_(count) {
+                    planes_[0] = planes_[1] = planes_[2] = NULL;
+                    try {
+                        for (int i = 0; i < count; i++) {
+                            planes_[i] = (uint8_t*)imageBufferPool().acquire(size);
+                        }
+                    } catch (...) {
+                        // the destructor does not run for a failed constructor
+                        release();
+                        throw;
+                    }
+                }
+
+                ~PlaneSet() {
+                    release();
+                }
+
+                uint8_t* operator[](int i) const { return planes_[i]; }
+
+                void toHalcon(HalconCpp::HImage& image, const char* type, size_t width, size_t height) {
+                    if (count_ == 1) {
+                        image.GenImage1Extern(type, width, height, planes_[0], (void*)releaseImagePlane);
+                    } else {
+                        image.GenImage3Extern(type, width, height, planes_[0], planes_[1], planes_[2], (void*)releaseImagePlane);
+                    }
+                    planes_[0] = planes_[1] = planes_[2] = NULL;
+                }
+
+            private:
+                PlaneSet(const PlaneSet&);
+                PlaneSet& operator=(const PlaneSet&);
+
+                void release() {
+                    for (int i = 0; i < count_; i++) {
+                        if (planes_[i]) imageBufferPool().release(planes_[i]);
+                        planes_[i] = NULL;
+                    }
+                }
+
+                int count_;
+                uint8_t* planes_[3];
+        };
+
+        /**
+         * \brief Write decoded rows of packed pixels into the planes, keeping every column_stride-th pixel.
+         */
+        void splitRows(const uint8_t* src, size_t rows, size_t src_width, int channels, int type_size,
+                       size_t column_stride, const PlaneSet& planes, size_t first_row, size_t width) {
+            size_t src_row_size = src_width * channels * type_size;
+            size_t plane_row_size = width * type_size;
+            if ((column_stride == 1) && (channels == 1)) {
+                memcpy(planes[0] + first_row * plane_row_size, src, rows * src_row_size);
+            } else if (column_stride == 1) {
+                // the strip and the planes are contiguous, so all rows are split with a single call
+                size_t offset = first_row * plane_row_size;
+                if (type_size == 1) {
+                    deinterleavePixels8(src, planes[0] + offset, planes[1] + offset, planes[2] + offset, rows * width, channels);
+                } else {
+                    deinterleavePixels16(src, (uint16_t*)(planes[0] + offset), (uint16_t*)(planes[1] + offset),
+                                         (uint16_t*)(planes[2] + offset), rows * width, channels, false);
+                }
+            } else {
+                for (size_t row = 0; row < rows; row++) {
+                    size_t offset = (first_row + row) * plane_row_size;
+                    const uint8_t* src_row = src + row * src_row_size;
+                    if (type_size == 1) {
+                        decimatePixels8(src_row, planes[0] + offset, planes[1] ? planes[1] + offset : NULL,
+                                        planes[2] ? planes[2] + offset : NULL, width, channels, column_stride);
+                    } else {
+                        decimatePixels16(src_row, (uint16_t*)(planes[0] + offset), planes[1] ? (uint16_t*)(planes[1] + offset) : NULL,
+                                         planes[2] ? (uint16_t*)(planes[2] + offset) : NULL, width, channels, column_stride, false);
+                    }
+                }
+            }
+        }
+
+
+
+        // libjpeg reports errors by calling error_exit, which must not return. It jumps back to the setjmp of the
+        // codec method that called into libjpeg, where the error is turned into an exception.
+        struct JpegErrorManager {
+            jpeg_error_mgr base;
+            jmp_buf jump;
+            char message[JMSG_LENGTH_MAX];
+        };
+
+        void onJpegError(j_common_ptr info) {
+            JpegErrorManager* error = (JpegErrorManager*)info->err;
+            (*info->err->format_message)(info, error->message);
+            longjmp(error->jump, 1);
+        }
+
+        void onJpegMessage(j_common_ptr) {
+        }
+
+        void initJpegErrorManager(JpegErrorManager& error) {
+            jpeg_std_error(&error.base);
+            error.base.error_exit = onJpegError;
+            error.base.output_message = onJpegMessage;
+            error.message[0] = '\0';
+        }
+
+        class JpegDecoder {
+            public:
+                JpegDecoder() {
+                    info_.err = &error_.base;
+                    initJpegErrorManager(error_);
+                    jpeg_create_decompress(&info_);
+                }
+
+                ~JpegDecoder() {
+                    jpeg_destroy_decompress(&info_);
+                }
+
+                void start(const uint8_t* data, size_t size, unsigned int scale_denominator) {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG decoding failed: ") + error_.message);
+                    jpeg_mem_src(&info_, const_cast<uint8_t*>(data), size);
+                    jpeg_read_header(&info_, TRUE);
+                    info_.out_color_space = (info_.num_components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+                    info_.scale_num = 1;
+                    info_.scale_denom = scale_denominator;
+                    jpeg_start_decompress(&info_);
+                }
+
+                size_t readRows(uint8_t** rows, size_t count) {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG decoding failed: ") + error_.message);
+                    return jpeg_read_scanlines(&info_, rows, count);
+                }
+
+                void finish() {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG decoding failed: ") + error_.message);
+                    jpeg_finish_decompress(&info_);
+                }
+
+                size_t width() const { return info_.output_width; }
+                size_t height() const { return info_.output_height; }
+                int channels() const { return info_.output_components; }
+
+            private:
+                JpegDecoder(const JpegDecoder&);
+                JpegDecoder& operator=(const JpegDecoder&);
+
+                jpeg_decompress_struct info_;
+                JpegErrorManager error_;
+        };
+
+        class JpegEncoder {
+            public:
+                JpegEncoder() : buffer_(NULL), size_(0) {
+                    info_.err = &error_.base;
+                    initJpegErrorManager(error_);
+                    jpeg_create_compress(&info_);
+                }
+
+                ~JpegEncoder() {
+                    jpeg_destroy_compress(&info_);
+                    free(buffer_);
+                }
+
+                void start(size_t width, size_t height, int channels, int quality) {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG encoding failed: ") + error_.message);
+                    jpeg_mem_dest(&info_, &buffer_, &size_);
+                    info_.image_width = width;
+                    info_.image_height = height;
+                    info_.input_components = channels;
+                    info_.in_color_space = (channels == 1) ? JCS_GRAYSCALE : JCS_RGB;
+                    jpeg_set_defaults(&info_);
+                    jpeg_set_quality(&info_, std::min(std::max(quality, 1), 100), TRUE);
+                    jpeg_start_compress(&info_, TRUE);
+                }
+
+                void writeRows(uint8_t** rows, size_t count) {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG encoding failed: ") + error_.message);
+                    jpeg_write_scanlines(&info_, rows, count);
+                }
+
+                void finish(std::vector<uint8_t>& data) {
+                    if (setjmp(error_.jump)) throw Exception(std::string("JPEG encoding failed: ") + error_.message);
+                    jpeg_finish_compress(&info_);
+                    data.assign(buffer_, buffer_ + size_);
+                }
+
+            private:
+                JpegEncoder(const JpegEncoder&);
+                JpegEncoder& operator=(const JpegEncoder&);
+
+                jpeg_compress_struct info_;
+                JpegErrorManager error_;
+                unsigned char* buffer_;
+                unsigned long size_;
+        };
+
+
+
+        // libpng jumps back to png_jmpbuf after calling the error function, the message is kept for the exception
+        void onPngError(png_structp png, png_const_charp message) {
+            std::string* error = (std::string*)png_get_error_ptr(png);
+            *error = message;
+            longjmp(png_jmpbuf(png), 1);
+        }
+
+        void onPngWarning(png_structp, png_const_charp) {
+        }
+
+        struct PngSource {
+            const uint8_t* data;
+            size_t size;
+            size_t offset;
+        };
+
+        void readPngData(png_structp png, png_bytep dst, png_size_t length) {
+            PngSource* source = (PngSource*)png_get_io_ptr(png);
+            if (source->size - source->offset < length) {
+                png_error(png, "Unexpected end of data");
+            }
+            memcpy(dst, source->data + source->offset, length);
+            source->offset += length;
+        }
+
+        void writePngData(png_structp png, png_bytep src, png_size_t length) {
+            std::vector<uint8_t>* data = (std::vector<uint8_t>*)png_get_io_ptr(png);
+            data->insert(data->end(), src, src + length);
+        }
+
+        void flushPngData(png_structp) {
+        }
+
+        class PngDecoder {
+            public:
+                PngDecoder() : info_(NULL), interlaced_(false) {
+                    png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, &error_, onPngError, onPngWarning);
+                    if (png_) info_ = png_create_info_struct(png_);
+                    if (!info_) {
+                        png_destroy_read_struct(&png_, NULL, NULL);
+                        throw Exception("Could not create PNG decoder");
+                    }
+                }
+
+                ~PngDecoder() {
+                    png_destroy_read_struct(&png_, &info_, NULL);
+                }
+
+                void start(const uint8_t* data, size_t size) {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG decoding failed: " + error_);
+                    source_.data = data;
+                    source_.size = size;
+                    source_.offset = 0;
+                    png_set_read_fn(png_, &source_, readPngData);
+                    png_read_info(png_, info_);
+
+                    // reduce every format to 8 or 16 bit gray or rgb without alpha
+                    int color_type = png_get_color_type(png_, info_);
+                    int bit_depth = png_get_bit_depth(png_, info_);
+                    if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_);
+                    if ((color_type == PNG_COLOR_TYPE_GRAY) && (bit_depth < 8)) png_set_expand_gray_1_2_4_to_8(png_);
+                    if (color_type & PNG_COLOR_MASK_ALPHA) png_set_strip_alpha(png_);
+                    if ((bit_depth == 16) && isHostLittleEndian()) png_set_swap(png_);
+                    interlaced_ = png_set_interlace_handling(png_) > 1;
+                    png_read_update_info(png_, info_);
+                }
+
+                void readRow(uint8_t* row) {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG decoding failed: " + error_);
+                    png_read_row(png_, row, NULL);
+                }
+
+                void readImage(uint8_t** rows) {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG decoding failed: " + error_);
+                    png_read_image(png_, rows);
+                }
+
+                void finish() {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG decoding failed: " + error_);
+                    png_read_end(png_, NULL);
+                }
+
+                size_t width() const { return png_get_image_width(png_, info_); }
+                size_t height() const { return png_get_image_height(png_, info_); }
+                int channels() const { return png_get_channels(png_, info_); }
+                int typeSize() const { return png_get_bit_depth(png_, info_) / 8; }
+                bool isInterlaced() const { return interlaced_; }
+
+            private:
+                PngDecoder(const PngDecoder&);
+                PngDecoder& operator=(const PngDecoder&);
+
+                png_structp png_;
+                png_infop info_;
+                std::string error_;
+                PngSource source_;
+                bool interlaced_;
+        };
+
+        class PngEncoder {
+            public:
+                PngEncoder() : info_(NULL) {
+                    png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, &error_, onPngError, onPngWarning);
+                    if (png_) info_ = png_create_info_struct(png_);
+                    if (!info_) {
+                        png_destroy_write_struct(&png_, NULL);
+                        throw Exception("Could not create PNG encoder");
+                    }
+                }
+
+                ~PngEncoder() {
+                    png_destroy_write_struct(&png_, &info_);
+                }
+
+                void start(size_t width, size_t height, int channels, int type_size, int level, std::vector<uint8_t>& data) {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG encoding failed: " + error_);
+                    png_set_write_fn(png_, &data, writePngData, flushPngData);
+                    png_set_IHDR(png_, info_, width, height, type_size * 8, (channels == 1) ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB,
+                                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+                    png_set_compression_level(png_, std::min(std::max(level, 0), 9));
+                    png_write_info(png_, info_);
+                    if ((type_size == 2) && isHostLittleEndian()) png_set_swap(png_);
+                }
+
+                void writeRow(const uint8_t* row) {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG encoding failed: " + error_);
+                    png_write_row(png_, const_cast<uint8_t*>(row));
+                }
+
+                void finish() {
+                    if (setjmp(png_jmpbuf(png_))) throw Exception("PNG encoding failed: " + error_);
+                    png_write_end(png_, NULL);
+                }
+
+            private:
+                PngEncoder(const PngEncoder&);
+                PngEncoder& operator=(const PngEncoder&);
+
+                png_structp png_;
+                png_infop info_;
+                std::string error_;
+        };
+
+
+
+        void decodeJpeg(const sensor_msgs::CompressedImage& source, unsigned int scale_denominator, HalconImage& result) {
+            JpegDecoder decoder;
+            decoder.start(&source.data[0], source.data.size(), scale_denominator);
+            size_t width = decoder.width();
+            size_t height = decoder.height();
+            int channels = decoder.channels();
+
+            PlaneSet planes(channels, width * height);
+            std::vector<uint8_t> strip;
+            uint8_t* rows[STRIP_ROWS];
+            size_t row = 0;
+            while (row < height) {
+                size_t count = std::min(STRIP_ROWS, height - row);
+                if (channels == 1) {
+                    // gray rows are decoded straight into the plane
+                    for (size_t i = 0; i < count; i++) {
+                        rows[i] = planes[0] + (row + i) * width;
+                    }
+                } else {
+                    strip.resize(STRIP_ROWS * width * channels);
+                    for (size_t i = 0; i < count; i++) {
+                        rows[i] = &strip[i * width * channels];
+                    }
+                }
+                size_t read = decoder.readRows(rows, count);
+                if (read == 0) {
+                    throw Exception("JPEG decoding failed: no rows decoded");
+                }
+                if (channels > 1) {
+                    splitRows(&strip[0], read, width, channels, 1, 1, planes, row, width);
+                }
+                row += read;
+            }
+            decoder.finish();
+
+            result.encoding = (channels == 1) ? sensor_msgs::image_encodings::MONO8 : sensor_msgs::image_encodings::RGB8;
+            result.image = new HalconCpp::HImage();
+            HALCON_BRIDGE_STATS_ALLOCATION();
+            planes.toHalcon(*result.image, "byte", width, height);
+        }
+
+        void decodePng(const sensor_msgs::CompressedImage& source, unsigned int scale_denominator, HalconImage& result) {
+            PngDecoder decoder;
+            decoder.start(&source.data[0], source.data.size());
+            size_t src_width = decoder.width();
+            size_t src_height = decoder.height();
+            int channels = decoder.channels();
+            int type_size = decoder.typeSize();
+            size_t width = (src_width + scale_denominator - 1) / scale_denominator;
+            size_t height = (src_height + scale_denominator - 1) / scale_denominator;
+            size_t row_size = src_width * channels * type_size;
+
+            PlaneSet planes(channels, width * height * type_size);
+            if (decoder.isInterlaced()) {
+                // the passes of an interlaced image fill the rows repeatedly, so the whole image is decoded first
+                std::vector<uint8_t> image(row_size * src_height);
+                std::vector<uint8_t*> rows(src_height);
+                for (size_t row = 0; row < src_height; row++) {
+                    rows[row] = &image[row * row_size];
+                }
+                decoder.readImage(&rows[0]);
+                for (size_t row = 0; row < height; row++) {
+                    splitRows(rows[row * scale_denominator], 1, src_width, channels, type_size, scale_denominator, planes, row, width);
+                }
+            } else if ((channels == 1) && (scale_denominator == 1)) {
+                for (size_t row = 0; row < height; row++) {
+                    decoder.readRow(planes[0] + row * row_size);
+                }
+            } else {
+                std::vector<uint8_t> buffer(row_size);
+                for (size_t row = 0; row < src_height; row++) {
+                    decoder.readRow(&buffer[0]);
+                    if (row % scale_denominator == 0) {
+                        splitRows(&buffer[0], 1, src_width, channels, type_size, scale_denominator, planes, row / scale_denominator, width);
+                    }
+                }
+            }
+            decoder.finish();
+
+            if (channels == 1) {
+                result.encoding = (type_size == 1) ? sensor_msgs::image_encodings::MONO8 : sensor_msgs::image_encodings::MONO16;
+            } else {
+                result.encoding = (type_size == 1) ? sensor_msgs::image_encodings::RGB8 : sensor_msgs::image_encodings::RGB16;
+            }
+            result.image = new HalconCpp::HImage();
+            HALCON_BRIDGE_STATS_ALLOCATION();
+            planes.toHalcon(*result.image, (type_size == 1) ? "byte" : "uint2", width, height);
+        }
+
+
+        /**
+         * \brief Point rows[0..count) at the packed pixels of the image rows starting at first_row.
+         *
+         * Gray rows are used in place, color rows are interleaved into the strip.
+         */
+        void prepareRows(const uint8_t* const* planes, int channels, int type_size, size_t width, size_t first_row,
+                         size_t count, std::vector<uint8_t>& strip, uint8_t** rows) {
+            size_t row_size = width * channels * type_size;
+            if (channels == 1) {
+                for (size_t i = 0; i < count; i++) {
+                    rows[i] = const_cast<uint8_t*>(planes[0]) + (first_row + i) * row_size;
+                }
+                return;
+            }
+
+            strip.resize(STRIP_ROWS * row_size);
+            size_t offset = first_row * width;
+            if (type_size == 1) {
+                interleavePlanes8(planes[0] + offset, planes[1] + offset, planes[2] + offset, NULL, &strip[0], count * width, 3);
+            } else {
+                interleavePlanes16((const uint16_t*)planes[0] + offset, (const uint16_t*)planes[1] + offset,
+                                   (const uint16_t*)planes[2] + offset, NULL, (uint16_t*)&strip[0], count * width, 3);
+            }
+            for (size_t i = 0; i < count; i++) {
+                rows[i] = &strip[i * row_size];
+            }
+        }
+
+        void encodeJpeg(const uint8_t* const* planes, int channels, size_t width, size_t height, int quality,
+                        std::vector<uint8_t>& data) {
+            JpegEncoder encoder;
+            encoder.start(width, height, channels, quality);
+            std::vector<uint8_t> strip;
+            uint8_t* rows[STRIP_ROWS];
+            for (size_t row = 0; row < height; row += STRIP_ROWS) {
+                size_t count = std::min(STRIP_ROWS, height - row);
+                prepareRows(planes, channels, 1, width, row, count, strip, rows);
+                encoder.writeRows(rows, count);
+            }
+            encoder.finish(data);
+        }
+
+        void encodePng(const uint8_t* const* planes, int channels, int type_size, size_t width, size_t height, int level,
+                       std::vector<uint8_t>& data) {
+            PngEncoder encoder;
+            encoder.start(width, height, channels, type_size, level, data);
+            std::vector<uint8_t> strip;
+            uint8_t* rows[STRIP_ROWS];
+            for (size_t row = 0; row < height; row += STRIP_ROWS) {
+                size_t count = std::min(STRIP_ROWS, height - row);
+                prepareRows(planes, channels, type_size, width, row, count, strip, rows);
+                for (size_t i = 0; i < count; i++) {
+                    encoder.writeRow(rows[i]);
+                }
+            }
+            encoder.finish();
+        }
+
+    }
+
+
+
+    HalconImagePtr toHalconCopy(const sensor_msgs::CompressedImageConstPtr& source, unsigned int scale_denominator) {
+        return toHalconCopy(*source, scale_denominator);
+    }
+
+    HalconImagePtr toHalconCopy(const sensor_msgs::CompressedImage& source, unsigned int scale_denominator) {
+        HALCON_BRIDGE_STATS_SCOPE(COMPRESSED_IMAGE_TO_HALCON);
+        if ((scale_denominator != 1) && (scale_denominator != 2) && (scale_denominator != 4) && (scale_denominator != 8)) {
+            throw Exception("Scale denominator must be 1, 2, 4 or 8");
+        }
+        HALCON_BRIDGE_STATS_BYTES(source.data.size());
+
+        HalconImagePtr ptr = boost::make_shared<HalconImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = source.header;
+
+        const uint8_t* data = source.data.empty() ? NULL : &source.data[0];
+        if ((source.data.size() >= 3) && (data[0] == 0xff) && (data[1] == 0xd8) && (data[2] == 0xff)) {
+            decodeJpeg(source, scale_denominator, *ptr);
+        } else if ((source.data.size() >= 8) && (png_sig_cmp(const_cast<uint8_t*>(data), 0, 8) == 0)) {
+            decodePng(source, scale_denominator, *ptr);
+        } else {
+            throw Exception("Compressed image format " + source.format + " not supported, only JPEG and PNG can be decoded");
+        }
+        return ptr;
+    }
+
+
+
+    sensor_msgs::CompressedImagePtr toCompressedImageMsg(const HalconImage& image, const std::string& format, int quality) {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_COMPRESSED_IMAGE);
+        sensor_msgs::CompressedImagePtr ptr = boost::make_shared<sensor_msgs::CompressedImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        toCompressedImageMsg(image, *ptr, format, quality);
+        return ptr;
+    }
+
+    void toCompressedImageMsg(const HalconImage& image, sensor_msgs::CompressedImage& message, const std::string& format, int quality) {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_COMPRESSED_IMAGE);
+        bool jpeg = (format == "jpeg") || (format == "jpg");
+        if (!jpeg && (format != "png")) {
+            throw Exception("Compressed image format " + format + " not supported, use jpeg or png");
+        }
+        if (!image.image) {
+            throw Exception("Image is empty");
+        }
+
+        HalconCpp::HString type;
+        Hlong width, height;
+        const uint8_t* planes[4] = {NULL, NULL, NULL, NULL};
+        int channels = (image.image->CountChannels() > 1) ? 3 : 1;
+        if (channels == 1) {
+            planes[0] = (const uint8_t*)image.image->GetImagePointer1(&type, &width, &height);
+        } else {
+            // Halcon keeps color images in rgb order, which is what the encoders expect
+            void *red, *green, *blue;
+            image.image->GetImagePointer3(&red, &green, &blue, &type, &width, &height);
+            planes[0] = (const uint8_t*)red;
+            planes[1] = (const uint8_t*)green;
+            planes[2] = (const uint8_t*)blue;
+        }
+        int type_size = ((std::string)type == "byte") ? 1 : (((std::string)type == "uint2") ? 2 : 0);
+        if ((type_size == 0) || (jpeg && (type_size != 1))) {
+            throw Exception("Image type " + (std::string)type + " not supported for " + format + " compression");
+        }
+
+        message.header = image.header;
+        std::string compressed_encoding;
+        if (channels == 1) {
+            compressed_encoding = (type_size == 1) ? sensor_msgs::image_encodings::MONO8 : sensor_msgs::image_encodings::MONO16;
+        } else {
+            compressed_encoding = (type_size == 1) ? sensor_msgs::image_encodings::BGR8 : sensor_msgs::image_encodings::BGR16;
+        }
+        message.format = image.encoding + "; " + (jpeg ? "jpeg" : "png") + " compressed " + compressed_encoding;
+        message.data.clear();
+
+        size_t capacity = message.data.capacity();
+        if (jpeg) {
+            encodeJpeg(planes, channels, width, height, quality, message.data);
+        } else {
+            encodePng(planes, channels, type_size, width, height, quality, message.data);
+        }
+        if (message.data.capacity() != capacity) {
+            HALCON_BRIDGE_STATS_ALLOCATION();
+        }
+        HALCON_BRIDGE_STATS_BYTES(message.data.size());
+    }
+
+}
@@ -0,0 +1,253 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_depth_image.h>
+#include "cloud_kernels.h"
+#include "finite_domain.h"
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include "pooled_buffers.h"
+#include <sensor_msgs/image_encodings.h>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace halcon_bridge {
+
+    struct CameraRayCache::Rays {
+        size_t width;
+        size_t height;
+        /// X and Y of the ray of every pixel at depth 1, row major
+        std::vector<float> x;
+        std::vector<float> y;
+    };
+
+    namespace {
+
+        bool isHostBigEndian() {
+            const uint16_t probe = 1;
+            return *(const uint8_t*)&probe == 0;
+        }
+
+        bool hasDistortion(const sensor_msgs::CameraInfo& info) {
+            for (size_t i = 0; i < info.D.size(); i++) {
+                if (info.D[i] != 0.0) return true;
+            }
+            return false;
+        }
+
+        bool haveSameCalibration(const sensor_msgs::CameraInfo& a, const sensor_msgs::CameraInfo& b) {
+            return (a.K == b.K) && (a.P == b.P) && (a.D == b.D) && (a.distortion_model == b.distortion_model) &&
+                    (a.binning_x == b.binning_x) && (a.binning_y == b.binning_y) &&
+                    (a.roi.x_offset == b.roi.x_offset) && (a.roi.y_offset == b.roi.y_offset);
+        }
+
+        /**
+         * \brief Compute the ray of every pixel, in the coordinates of a binned or cropped image like image_geometry does.
+         */
+        boost::shared_ptr<CameraRayCache::Rays> computeRays(const sensor_msgs::CameraInfo& info, size_t width, size_t height,
+                                                            bool rectified) {
+            double fx = rectified ? info.P[0] : info.K[0];
+            double fy = rectified ? info.P[5] : info.K[4];
+            double cx = rectified ? info.P[2] : info.K[2];
+            double cy = rectified ? info.P[6] : info.K[5];
+            if ((fx == 0.0) || (fy == 0.0)) {
+                throw Exception("CameraInfo does not contain a calibration");
+            }
+            double binning_x = std::max<uint32_t>(info.binning_x, 1);
+            double binning_y = std::max<uint32_t>(info.binning_y, 1);
+            cx = (cx - info.roi.x_offset) / binning_x;
+            cy = (cy - info.roi.y_offset) / binning_y;
+            fx /= binning_x;
+            fy /= binning_y;
+
+            // k1, k2, p1, p2, k3, k4, k5, k6 of the plumb_bob and rational_polynomial models
+            double k[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+            bool undistort = !rectified && hasDistortion(info);
+            if (undistort) {
+                if ((info.distortion_model != "plumb_bob") && (info.distortion_model != "rational_polynomial")) {
+                    throw Exception("Distortion model " + info.distortion_model + " not supported");
+                }
+                std::copy(info.D.begin(), info.D.begin() + std::min<size_t>(info.D.size(), 8), k);
+            }
+
+            boost::shared_ptr<CameraRayCache::Rays> rays = boost::make_shared<CameraRayCache::Rays>();
+            rays->width = width;
+            rays->height = height;
+            rays->x.resize(width * height);
+            rays->y.resize(width * height);
+            // undistorting a ray costs about as much as converting 64 bytes, which decides about parallelization
+            parallelFor(height, width * height * 64, [&](size_t first_row, size_t last_row) {
+                for (size_t row = first_row; row < last_row; row++) {
+                    for (size_t column = 0; column < width; column++) {
+                        double x0 = (column - cx) / fx;
+                        double y0 = (row - cy) / fy;
+                        double x = x0;
+                        double y = y0;
+                        // the fixed-point iteration of cv::undistortPoints, with more iterations since the rays are cached
+                        for (int i = 0; undistort && (i < 20); i++) {
+                            double r2 = x * x + y * y;
+                            double inverse = (1.0 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2) /
+                                             (1.0 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2);
+                            double dx = 2.0 * k[2] * x * y + k[3] * (r2 + 2.0 * x * x);
+                            double dy = k[2] * (r2 + 2.0 * y * y) + 2.0 * k[3] * x * y;
+                            x = (x0 - dx) * inverse;
+                            y = (y0 - dy) * inverse;
+                        }
+                        rays->x[row * width + column] = (float)x;
+                        rays->y[row * width + column] = (float)y;
+                    }
+                }
+            });
+            return rays;
+        }
+
+        /**
+         * \brief Check the encoding and size of a depth image and get its scale to meters.
+         */
+        float getDepthScale(const sensor_msgs::Image& depth, bool& float_depth) {
+            size_t type_size;
+            float scale;
+            if ((depth.encoding == sensor_msgs::image_encodings::TYPE_16UC1) || (depth.encoding == sensor_msgs::image_encodings::MONO16)) {
+                float_depth = false;
+                type_size = 2;
+                scale = 0.001f;
+            } else if (depth.encoding == sensor_msgs::image_encodings::TYPE_32FC1) {
+                float_depth = true;
+                type_size = 4;
+                scale = 1.0f;
+            } else {
+                throw Exception("Depth encoding " + depth.encoding + " not supported, use 16UC1 or 32FC1");
+            }
+            if ((depth.step < depth.width * type_size) || (depth.data.size() < (size_t)depth.step * depth.height)) {
+                throw Exception("Image data does not match its width, height and step");
+            }
+            return scale;
+        }
+
+        /**
+         * \brief Back-project all rows of a depth image, only z if no rays are given.
+         */
+        void backprojectImage(const sensor_msgs::Image& depth, const CameraRayCache::Rays* rays, float* x, float* y, float* z) {
+            bool float_depth;
+            float scale = getDepthScale(depth, float_depth);
+            bool swap_bytes = (bool)depth.is_bigendian != isHostBigEndian();
+            size_t width = depth.width;
+            const uint8_t* data = depth.data.empty() ? NULL : &depth.data[0];
+            parallelFor(depth.height, (size_t)depth.step * depth.height, [&](size_t first_row, size_t last_row) {
+                for (size_t row = first_row; row < last_row; row++) {
+                    size_t offset = row * width;
+                    backprojectDepth(data + row * depth.step, width, float_depth, scale, swap_bytes,
+                                     rays ? &rays->x[offset] : NULL, rays ? &rays->y[offset] : NULL,
+                                     x ? x + offset : NULL, y ? y + offset : NULL, z + offset);
+                }
+            });
+        }
+
+    }
+
+
+
+    CameraRayCache::CameraRayCache() : rectified_(true) {
+    }
+
+    CameraRayCache::~CameraRayCache() {
+    }
+
+    boost::shared_ptr<const CameraRayCache::Rays> CameraRayCache::getRays(const sensor_msgs::CameraInfo& info, size_t width,
+                                                                          size_t height, bool rectified) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!rays_ || (rays_->width != width) || (rays_->height != height) || (rectified_ != rectified) ||
+                !haveSameCalibration(info_, info)) {
+            rays_ = computeRays(info, width, height, rectified);
+            info_ = info;
+            rectified_ = rectified;
+        }
+        return rays_;
+    }
+
+
+
+    HalconImagePtr toHalconDepth(const sensor_msgs::ImageConstPtr& source) {
+        return toHalconDepth(*source);
+    }
+
+    HalconImagePtr toHalconDepth(const sensor_msgs::Image& source) {
+        HALCON_BRIDGE_STATS_SCOPE(DEPTH_IMAGE_TO_HALCON);
+        bool float_depth;
+        getDepthScale(source, float_depth);
+        HALCON_BRIDGE_STATS_BYTES((size_t)source.step * source.height);
+
+        HalconImagePtr ptr = boost::make_shared<HalconImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = source.header;
+        ptr->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+
+        size_t count = (size_t)source.width * source.height;
+        float* z = (float*)imageBufferPool().acquire(count * sizeof(float));
+        backprojectImage(source, NULL, NULL, NULL, z);
+        HalconCpp::HRegion domain = getFiniteDomain(z, z, z, source.width, source.height);
+
+        HalconCpp::HImage image;
+        image.GenImage1Extern("real", source.width, source.height, z, (void*)releaseImagePlane);
+        ptr->image = new HalconCpp::HImage(image.ReduceDomain(domain));
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        return ptr;
+    }
+
+
+
+    HalconPointcloudPtr toHalconPointcloud(const sensor_msgs::ImageConstPtr& depth, const sensor_msgs::CameraInfoConstPtr& info,
+                                           CameraRayCache& ray_cache, const DepthConversionOptions& options) {
+        return toHalconPointcloud(*depth, *info, ray_cache, options);
+    }
+
+    HalconPointcloudPtr toHalconPointcloud(const sensor_msgs::Image& depth, const sensor_msgs::CameraInfo& info,
+                                           CameraRayCache& ray_cache, const DepthConversionOptions& options) {
+        HALCON_BRIDGE_STATS_SCOPE(DEPTH_IMAGE_TO_POINTCLOUD);
+        bool float_depth;
+        getDepthScale(depth, float_depth);
+        HALCON_BRIDGE_STATS_BYTES((size_t)depth.step * depth.height);
+        boost::shared_ptr<const CameraRayCache::Rays> rays = ray_cache.getRays(info, depth.width, depth.height, options.rectified);
+
+        HalconPointcloudPtr ptr = boost::make_shared<HalconPointcloud>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = depth.header;
+
+        // the coordinate planes are handed to the X/Y/Z images without another copy
+        size_t count = (size_t)depth.width * depth.height;
+        float* x = (float*)imageBufferPool().acquire(count * sizeof(float));
+        float* y = (float*)imageBufferPool().acquire(count * sizeof(float));
+        float* z = (float*)imageBufferPool().acquire(count * sizeof(float));
+        backprojectImage(depth, rays.get(), x, y, z);
+        HalconCpp::HRegion domain = getFiniteDomain(x, y, z, depth.width, depth.height);
+
+        ptr->x_image.GenImage1Extern("real", depth.width, depth.height, x, (void*)releaseImagePlane);
+        ptr->y_image.GenImage1Extern("real", depth.width, depth.height, y, (void*)releaseImagePlane);
+        ptr->z_image.GenImage1Extern("real", depth.width, depth.height, z, (void*)releaseImagePlane);
+        ptr->x_image = ptr->x_image.ReduceDomain(domain);
+        ptr->y_image = ptr->y_image.ReduceDomain(domain);
+        ptr->z_image = ptr->z_image.ReduceDomain(domain);
+        if (options.model) {
+            ptr->model = new HalconCpp::HObjectModel3D(ptr->x_image, ptr->y_image, ptr->z_image);
+            HALCON_BRIDGE_STATS_ALLOCATION();
+        }
+        return ptr;
+    }
+
+}
@@ -0,0 +1,263 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_disparity_image.h>
+#include "cloud_kernels.h"
+#include "finite_domain.h"
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include "pooled_buffers.h"
+#include <sensor_msgs/image_encodings.h>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        bool isHostBigEndian() {
+            const uint16_t probe = 1;
+            return *(const uint8_t*)&probe == 0;
+        }
+
+        void checkDisparityImage(const stereo_msgs::DisparityImage& disparity) {
+            const sensor_msgs::Image& image = disparity.image;
+            if (image.encoding != sensor_msgs::image_encodings::TYPE_32FC1) {
+                throw Exception("Disparity encoding " + image.encoding + " not supported, use 32FC1");
+            }
+            if ((image.step < image.width * sizeof(float)) || (image.data.size() < (size_t)image.step * image.height)) {
+                throw Exception("Image data does not match its width, height and step");
+            }
+        }
+
+        /**
+         * \brief Valid window clipped to the image, the whole image if the window is empty.
+         */
+        sensor_msgs::RegionOfInterest getValidWindow(const stereo_msgs::DisparityImage& disparity) {
+            sensor_msgs::RegionOfInterest window = disparity.valid_window;
+            uint32_t width = disparity.image.width;
+            uint32_t height = disparity.image.height;
+            if ((window.width == 0) || (window.height == 0)) {
+                window.x_offset = window.y_offset = 0;
+                window.width = width;
+                window.height = height;
+            }
+            window.x_offset = std::min(window.x_offset, width);
+            window.y_offset = std::min(window.y_offset, height);
+            window.width = std::min(window.width, width - window.x_offset);
+            window.height = std::min(window.height, height - window.y_offset);
+            return window;
+        }
+
+    }
+
+
+
+    HalconDisparityImage::HalconDisparityImage() : image(NULL), f(0.0f), T(0.0f), min_disparity(0.0f), max_disparity(0.0f),
+                                                   delta_d(0.0f) {
+        valid_window.x_offset = valid_window.y_offset = valid_window.width = valid_window.height = 0;
+        valid_window.do_rectify = false;
+    }
+
+    HalconDisparityImage::~HalconDisparityImage() {
+        delete image;
+    }
+
+    stereo_msgs::DisparityImagePtr HalconDisparityImage::toDisparityMsg() const {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_DISPARITY_IMAGE);
+        stereo_msgs::DisparityImagePtr ptr = boost::make_shared<stereo_msgs::DisparityImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        toDisparityMsg(*ptr);
+        return ptr;
+    }
+
+    void HalconDisparityImage::toDisparityMsg(stereo_msgs::DisparityImage& ros_disparity) const {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_DISPARITY_IMAGE);
+        ros_disparity.header = header;
+        ros_disparity.f = f;
+        ros_disparity.T = T;
+        ros_disparity.valid_window = valid_window;
+        ros_disparity.min_disparity = min_disparity;
+        ros_disparity.max_disparity = max_disparity;
+        ros_disparity.delta_d = delta_d;
+
+        HalconCpp::HString type;
+        Hlong width, height;
+        const float* disparities = (const float*)image->GetImagePointer1(&type, &width, &height);
+        if ((std::string)type != "real") {
+            throw Exception("Disparity image has to be a real image");
+        }
+        sensor_msgs::Image& ros_image = ros_disparity.image;
+        ros_image.header = header;
+        ros_image.width = width;
+        ros_image.height = height;
+        ros_image.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+        ros_image.is_bigendian = isHostBigEndian();
+        ros_image.step = width * sizeof(float);
+        resizeMessageBuffer(ros_image.data, (size_t)ros_image.step * height);
+        HALCON_BRIDGE_STATS_BYTES(ros_image.data.size());
+        if (!ros_image.data.empty()) {
+            memcpy(&ros_image.data[0], disparities, ros_image.data.size());
+        }
+    }
+
+
+
+    HalconDisparityImagePtr toHalconCopy(const stereo_msgs::DisparityImageConstPtr& source) {
+        return toHalconCopy(*source);
+    }
+
+    HalconDisparityImagePtr toHalconCopy(const stereo_msgs::DisparityImage& source) {
+        HALCON_BRIDGE_STATS_SCOPE(DISPARITY_IMAGE_TO_HALCON);
+        checkDisparityImage(source);
+        const sensor_msgs::Image& image = source.image;
+        HALCON_BRIDGE_STATS_BYTES((size_t)image.step * image.height);
+
+        HalconDisparityImagePtr ptr = boost::make_shared<HalconDisparityImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = source.header;
+        ptr->f = source.f;
+        ptr->T = source.T;
+        ptr->valid_window = source.valid_window;
+        ptr->min_disparity = source.min_disparity;
+        ptr->max_disparity = source.max_disparity;
+        ptr->delta_d = source.delta_d;
+
+        size_t width = image.width;
+        float* plane = (float*)imageBufferPool().acquire(width * image.height * sizeof(float));
+        bool swap_bytes = (bool)image.is_bigendian != isHostBigEndian();
+        const uint8_t* data = image.data.empty() ? NULL : &image.data[0];
+        parallelFor(image.height, (size_t)image.step * image.height, [&](size_t first_row, size_t last_row) {
+            for (size_t row = first_row; row < last_row; row++) {
+                const uint8_t* src = data + row * image.step;
+                float* dst = plane + row * width;
+                if (!swap_bytes) {
+                    memcpy(dst, src, width * sizeof(float));
+                    continue;
+                }
+                for (size_t column = 0; column < width; column++) {
+                    uint32_t bits;
+                    memcpy(&bits, src + column * sizeof(float), sizeof(bits));
+                    bits = __builtin_bswap32(bits);
+                    memcpy(dst + column, &bits, sizeof(bits));
+                }
+            }
+        });
+
+        HalconCpp::HImage disparities;
+        disparities.GenImage1Extern("real", image.width, image.height, plane, (void*)releaseImagePlane);
+        sensor_msgs::RegionOfInterest window = getValidWindow(source);
+        if ((window.width != image.width) || (window.height != image.height)) {
+            HalconCpp::HRegion domain;
+            if ((window.width == 0) || (window.height == 0)) {
+                domain.GenRegionRuns(HalconCpp::HTuple(), HalconCpp::HTuple(), HalconCpp::HTuple());
+            } else {
+                domain.GenRectangle1(window.y_offset, window.x_offset, window.y_offset + window.height - 1,
+                                     window.x_offset + window.width - 1);
+            }
+            disparities = disparities.ReduceDomain(domain);
+        }
+        ptr->image = new HalconCpp::HImage(disparities);
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        return ptr;
+    }
+
+
+
+    HalconPointcloudPtr toHalconPointcloud(const stereo_msgs::DisparityImageConstPtr& disparity,
+                                           const sensor_msgs::CameraInfoConstPtr& info, const DisparityConversionOptions& options) {
+        return toHalconPointcloud(*disparity, *info, options);
+    }
+
+    HalconPointcloudPtr toHalconPointcloud(const stereo_msgs::DisparityImage& disparity, const sensor_msgs::CameraInfo& info,
+                                           const DisparityConversionOptions& options) {
+        HALCON_BRIDGE_STATS_SCOPE(DISPARITY_IMAGE_TO_POINTCLOUD);
+        checkDisparityImage(disparity);
+        const sensor_msgs::Image& image = disparity.image;
+        HALCON_BRIDGE_STATS_BYTES((size_t)image.step * image.height);
+
+        // principal point and focal lengths of the rectified left camera, in the coordinates of a binned or
+        // cropped image like image_geometry does
+        double fx = info.P[0];
+        double fy = info.P[5];
+        if ((fx == 0.0) || (fy == 0.0)) {
+            throw Exception("CameraInfo does not contain a calibration");
+        }
+        double binning_x = std::max<uint32_t>(info.binning_x, 1);
+        double binning_y = std::max<uint32_t>(info.binning_y, 1);
+        double cx = (info.P[2] - info.roi.x_offset) / binning_x;
+        double cy = (info.P[6] - info.roi.y_offset) / binning_y;
+        fx /= binning_x;
+        fy /= binning_y;
+
+        HalconPointcloudPtr ptr = boost::make_shared<HalconPointcloud>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = disparity.header;
+
+        // the coordinate planes are handed to the X/Y/Z images without another copy
+        size_t width = image.width;
+        size_t count = width * image.height;
+        float* x = (float*)imageBufferPool().acquire(count * sizeof(float));
+        float* y = (float*)imageBufferPool().acquire(count * sizeof(float));
+        float* z = (float*)imageBufferPool().acquire(count * sizeof(float));
+
+        sensor_msgs::RegionOfInterest window = getValidWindow(disparity);
+        size_t window_begin = window.x_offset;
+        size_t window_end = window.x_offset + window.width;
+        float focal_baseline = disparity.f * disparity.T;
+        bool swap_bytes = (bool)image.is_bigendian != isHostBigEndian();
+        const uint8_t* data = image.data.empty() ? NULL : &image.data[0];
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        parallelFor(image.height, (size_t)image.step * image.height, [&](size_t first_row, size_t last_row) {
+            for (size_t row = first_row; row < last_row; row++) {
+                size_t offset = row * width;
+                bool inside = (row >= window.y_offset) && (row < (size_t)window.y_offset + window.height);
+                size_t begin = inside ? window_begin : width;
+                size_t end = inside ? window_end : width;
+                // pixels outside the valid window are invalid
+                std::fill(x + offset, x + offset + begin, nan);
+                std::fill(y + offset, y + offset + begin, nan);
+                std::fill(z + offset, z + offset + begin, nan);
+                std::fill(x + offset + end, x + offset + width, nan);
+                std::fill(y + offset + end, y + offset + width, nan);
+                std::fill(z + offset + end, z + offset + width, nan);
+                if (begin < end) {
+                    reprojectDisparity(data + row * image.step + begin * sizeof(float), end - begin, swap_bytes,
+                                       disparity.min_disparity, focal_baseline, (float)((begin - cx) / fx), (float)(1.0 / fx),
+                                       (float)((row - cy) / fy), x + offset + begin, y + offset + begin, z + offset + begin);
+                }
+            }
+        });
+        HalconCpp::HRegion domain = getFiniteDomain(x, y, z, image.width, image.height);
+
+        ptr->x_image.GenImage1Extern("real", image.width, image.height, x, (void*)releaseImagePlane);
+        ptr->y_image.GenImage1Extern("real", image.width, image.height, y, (void*)releaseImagePlane);
+        ptr->z_image.GenImage1Extern("real", image.width, image.height, z, (void*)releaseImagePlane);
+        ptr->x_image = ptr->x_image.ReduceDomain(domain);
+        ptr->y_image = ptr->y_image.ReduceDomain(domain);
+        ptr->z_image = ptr->z_image.ReduceDomain(domain);
+        if (options.model) {
+            ptr->model = new HalconCpp::HObjectModel3D(ptr->x_image, ptr->y_image, ptr->z_image);
+            HALCON_BRIDGE_STATS_ALLOCATION();
+        }
+        return ptr;
+    }
+
+}
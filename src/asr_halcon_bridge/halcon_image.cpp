@@ -16,9 +16,16 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 */
 
 #include <asr_halcon_bridge/halcon_image.h>
+#include "image_kernels.h"
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include "pooled_buffers.h"
 #include <sensor_msgs/image_encodings.h>
 #include <boost/make_shared.hpp>
 
+#include <algorithm>
+#include <list>
+
 namespace halcon_bridge {
 
     const char* INVALID = "invalid";
@@ -41,9 +48,17 @@ namespace halcon_bridge {
       if (encoding == sensor_msgs::image_encodings::RGB8)   return "rgb";
       if (encoding == sensor_msgs::image_encodings::BGRA8)  return "bgrx";
       if (encoding == sensor_msgs::image_encodings::RGBA8)  return "rgbx";
+      if (encoding == sensor_msgs::image_encodings::BGR16)  return "bgr";
+      if (encoding == sensor_msgs::image_encodings::RGB16)  return "rgb";
+      if (encoding == sensor_msgs::image_encodings::BGRA16) return "bgrx";
+      if (encoding == sensor_msgs::image_encodings::RGBA16) return "rgbx";
 
       // 1-channel encoding
       if (encoding == sensor_msgs::image_encodings::MONO8)  return "mono";
+      if (encoding == sensor_msgs::image_encodings::MONO16) return "mono";
+
+      // Bayer encodings are single-channel color filter array images until they are demosaiced
+      if (sensor_msgs::image_encodings::isBayer(encoding)) return "mono";
 
       // Other formats are not supported
       return INVALID;
@@ -58,6 +73,11 @@ namespace halcon_bridge {
                 (encoding == sensor_msgs::image_encodings::MONO8)) {
           return "byte";
         }
+      if (sensor_msgs::image_encodings::isBayer(encoding)) {
+         int depth = sensor_msgs::image_encodings::bitDepth(encoding);
+         if (depth == 8) return "byte";
+         if (depth == 16) return "uint2";
+      }
       if ((encoding == sensor_msgs::image_encodings::BGR16) || (encoding == sensor_msgs::image_encodings::RGB16) ||
               (encoding == sensor_msgs::image_encodings::BGRA16) || (encoding == sensor_msgs::image_encodings::RGBA16) ||
               (encoding == sensor_msgs::image_encodings::MONO16)) {
@@ -69,6 +89,30 @@ namespace halcon_bridge {
 
 
 
+    bool isHostBigEndian() {
+        const uint16_t probe = 1;
+        return *(const uint8_t*)&probe == 0;
+    }
+
+
+
+    bool isShareable(const sensor_msgs::Image& source) {
+        // only single-channel images map onto the one plane of GenImage1Extern
+        if ((getHalconEncoding(source.encoding) == INVALID) || (sensor_msgs::image_encodings::numChannels(source.encoding) != 1)) {
+            return false;
+        }
+        int type_size = getHalconTypeSize(getHalconChannelLength(source.encoding));
+        if (source.step != source.width * type_size) {
+            return false;
+        }
+        if ((type_size > 1) && ((bool)source.is_bigendian != isHostBigEndian())) {
+            return false;
+        }
+        return !source.data.empty() && (source.data.size() >= (size_t)source.step * source.height);
+    }
+
+
+
     const char* getColorChannelOrder(const std::string& encoding) {
         if ((encoding == sensor_msgs::image_encodings::BGR8) || (encoding == sensor_msgs::image_encodings::BGRA8) ||
                 (encoding == sensor_msgs::image_encodings::BGR16) || (encoding == sensor_msgs::image_encodings::BGRA16)) {
@@ -83,119 +127,343 @@ namespace halcon_bridge {
 
 
 
+    /**
+     * \brief Row and column parity of the red pixels of a Bayer encoding.
+     */
+    void getBayerRedPhase(const std::string& encoding, size_t& red_row, size_t& red_column) {
+        using namespace sensor_msgs::image_encodings;
+        red_row = ((encoding == BAYER_BGGR8) || (encoding == BAYER_BGGR16) ||
+                   (encoding == BAYER_GBRG8) || (encoding == BAYER_GBRG16)) ? 1 : 0;
+        red_column = ((encoding == BAYER_BGGR8) || (encoding == BAYER_BGGR16) ||
+                      (encoding == BAYER_GRBG8) || (encoding == BAYER_GRBG16)) ? 1 : 0;
+    }
+
+
+
+    /**
+     * \brief Pixels of an image selected by ImageConversionOptions.
+     */
+    struct ConversionRegion {
+        /// Clamped region of interest in the source image
+        size_t x, y, width, height;
+        /// Size of the region after applying the strides
+        size_t stride_width, stride_height;
+        /// Size of the smallest pyramid level, equal to the stride size if no level is built
+        size_t out_width, out_height;
+        /// Number of pyramid levels that can be built before a dimension would become 0
+        unsigned int levels;
+        bool full_frame;
+    };
+
+    ConversionRegion getConversionRegion(size_t width, size_t height, const ImageConversionOptions& options) {
+        if ((options.column_stride == 0) || (options.row_stride == 0)) {
+            throw Exception("Conversion strides must be at least 1");
+        }
+
+        ConversionRegion region;
+        region.x = std::min<size_t>(options.roi_x, width);
+        region.y = std::min<size_t>(options.roi_y, height);
+        region.width = width - region.x;
+        region.height = height - region.y;
+        if (options.roi_width > 0) region.width = std::min<size_t>(region.width, options.roi_width);
+        if (options.roi_height > 0) region.height = std::min<size_t>(region.height, options.roi_height);
+        if ((region.width == 0) || (region.height == 0)) {
+            throw Exception("Region of interest does not overlap the image");
+        }
 
-    HalconImage::~HalconImage() {
-        delete image;
+        region.stride_width = (region.width + options.column_stride - 1) / options.column_stride;
+        region.stride_height = (region.height + options.row_stride - 1) / options.row_stride;
+        region.full_frame = (region.width == width) && (region.height == height) &&
+                (options.column_stride == 1) && (options.row_stride == 1);
+
+        region.out_width = region.stride_width;
+        region.out_height = region.stride_height;
+        region.levels = 0;
+        while ((region.levels < options.pyramid_levels) && (region.out_width >= 2) && (region.out_height >= 2)) {
+            region.out_width /= 2;
+            region.out_height /= 2;
+            region.levels++;
+        }
+        return region;
     }
 
-    sensor_msgs::ImagePtr HalconImage::toImageMsg() const {
-      sensor_msgs::ImagePtr ptr = boost::make_shared<sensor_msgs::Image>();
-      toImageMsg(*ptr);
-      return ptr;
+
+
+    /**
+     * \brief Halve planar channels of the given size by averaging 2x2 blocks.
+     *
+     * \param dst   Destination planes with room for (width / 2) * (height / 2) values each
+     */
+    void downsamplePlanes(const uint8_t* const* src, uint8_t* const* dst, int plane_count, int type_size,
+                          size_t width, size_t height) {
+        size_t dst_width = width / 2;
+        size_t dst_height = height / 2;
+        parallelFor(dst_height, width * height * plane_count * type_size, [&](size_t first_row, size_t last_row) {
+            for (int i = 0; i < plane_count; i++) {
+                for (size_t row = first_row; row < last_row; row++) {
+                    const uint8_t* row0 = src[i] + 2 * row * width * type_size;
+                    const uint8_t* row1 = row0 + width * type_size;
+                    if (type_size == 1) {
+                        downsampleRows8(row0, row1, dst[i] + row * dst_width, dst_width);
+                    } else {
+                        downsampleRows16((const uint16_t*)row0, (const uint16_t*)row1,
+                                         (uint16_t*)(dst[i] + row * dst_width * 2), dst_width);
+                    }
+                }
+            }
+        });
     }
 
+    /**
+     * \brief Build the pyramid levels of freshly converted planes, every level owns its planes.
+     */
+    void buildPyramid(const uint8_t* const* planes, int plane_count, const char* type, int type_size,
+                      size_t width, size_t height, unsigned int levels, std::vector<HalconCpp::HImage>& pyramid) {
+        const uint8_t* src[3] = {planes[0], planes[1], planes[2]};
+        for (unsigned int level = 0; level < levels; level++) {
+            uint8_t* dst[3] = {NULL, NULL, NULL};
+            for (int i = 0; i < plane_count; i++) {
+                dst[i] = (uint8_t*)imageBufferPool().acquire((width / 2) * (height / 2) * type_size);
+            }
+            downsamplePlanes(src, dst, plane_count, type_size, width, height);
+            width /= 2;
+            height /= 2;
+
+            HalconCpp::HImage image;
+            if (plane_count == 1) {
+                image.GenImage1Extern(type, width, height, dst[0], (void*)releaseImagePlane);
+            } else {
+                image.GenImage3Extern(type, width, height, dst[0], dst[1], dst[2], (void*)releaseImagePlane);
+            }
+            pyramid.push_back(image);
+            for (int i = 0; i < plane_count; i++) {
+                src[i] = dst[i];
+            }
+        }
+    }
 
 
-    void HalconImage::toImageMsg(sensor_msgs::Image& ros_image) const {
-        long width, height;
-        width = image->Width();
-        height = image->Height();
 
-        int channel_count = image->CountChannels();
+    /**
+     * \brief Interleave planar channels of the given size into the rows of a message.
+     *
+     * \param planes         Channels in the order of the packed pixel, planes[3] is the alpha channel or NULL
+     * \param plane_count    1 for a mono image, 3 otherwise
+     * \param dst_channels   Channels of a packed pixel, 1, 3 or 4
+     */
+    void writeImageData(const uint8_t* const* planes, int plane_count, int type_size, int dst_channels,
+                        size_t width, size_t height, size_t step, uint8_t* dst) {
+        size_t row_size = dst_channels * width * type_size;
+        bool padded = step != row_size;
+
+        if (plane_count == 1) {
+            if (padded) {
+                for (size_t row = 0; row < height; row++) {
+                    memcpy(dst + row * step, planes[0] + row * row_size, row_size);
+                }
+            } else {
+                memcpy(dst, planes[0], row_size * height);
+            }
+            return;
+        }
 
-        ros_image.height = height;
-        ros_image.width = width;
-        ros_image.encoding = encoding;
-        ros_image.is_bigendian = false;
-        ros_image.step = channel_count * width;
+        // without padding a band of rows is interleaved with a single call
+        parallelFor(height, step * height, [&](size_t first_row, size_t last_row) {
+            size_t rows = padded ? last_row - first_row : 1;
+            size_t row_pixels = padded ? width : (last_row - first_row) * width;
+            for (size_t row = first_row; row < first_row + rows; row++) {
+                size_t offset = row * width;
+                if (type_size == 1) {
+                    interleavePlanes8(planes[0] + offset, planes[1] + offset, planes[2] + offset,
+                                      planes[3] ? planes[3] + offset : NULL, dst + row * step, row_pixels, dst_channels);
+                } else {
+                    interleavePlanes16((const uint16_t*)planes[0] + offset, (const uint16_t*)planes[1] + offset,
+                                       (const uint16_t*)planes[2] + offset, planes[3] ? (const uint16_t*)planes[3] + offset : NULL,
+                                       (uint16_t*)(dst + row * step), row_pixels, dst_channels);
+                }
+            }
+        });
+    }
 
 
-        HalconCpp::HString typeReturn;
-        Hlong widthReturn;
-        Hlong heightReturn;
-        HalconCpp::HString type = image->GetImageType();
 
-        if (channel_count > 1) {
 
-            //build interleaved image from 3-channel image
+    HalconImage::HalconImage() : image(NULL) {
+    }
 
-            HalconCpp::HImage *interleavedImage = new HalconCpp::HImage(type, width * 3, height);
+    HalconImage::~HalconImage() {
+        delete image;
+    }
 
-            HalconCpp::HHomMat2D homMat;
-            homMat = homMat.HomMat2dScale(1, 3, 0, 0);
+    sensor_msgs::ImagePtr HalconImage::toImageMsg(unsigned int row_alignment) const {
+      ImageConversionOptions options;
+      options.row_alignment = row_alignment;
+      return toImageMsg(options);
+    }
 
-            HalconCpp::HImage transImage = image->AffineTransImageSize(homMat, "constant", width * 3, height);
+    sensor_msgs::ImagePtr HalconImage::toImageMsg(const ImageConversionOptions& options) const {
+      HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_IMAGE);
+      sensor_msgs::ImagePtr ptr;
+      if (isBufferPoolEnabled()) {
+          HalconCpp::HString type = image->GetImageType();
+          ConversionRegion region = getConversionRegion(image->Width(), image->Height(), options);
+          ptr = imageMessagePool().acquire(region.out_width * region.out_height * image->CountChannels() * getHalconTypeSize((std::string)type));
+      } else {
+          ptr = boost::make_shared<sensor_msgs::Image>();
+          HALCON_BRIDGE_STATS_ALLOCATION();
+      }
+      toImageMsg(*ptr, options);
+      return ptr;
+    }
 
-            HalconCpp::HImage imageRed;
-            HalconCpp::HImage imageGreen;
-            HalconCpp::HImage imageBlue;
-            imageRed = transImage.Decompose3(&imageGreen, &imageBlue);
 
 
-            HalconCpp::HRegion regionGrid;
-            regionGrid.GenGridRegion(2 * height, 3, "lines", width * 3, height + 1);
-            HalconCpp::HRegion movedRegion = regionGrid.MoveRegion(-1, 0);
-            HalconCpp::HRegion clippedRegion = movedRegion.ClipRegion(0, 0, height - 1, (3 * width) - 1);
+    void HalconImage::toImageMsgLayout(sensor_msgs::Image& ros_image, unsigned int row_alignment) const {
+        ImageConversionOptions options;
+        options.row_alignment = row_alignment;
+        toImageMsgLayout(ros_image, options);
+    }
+
+    void HalconImage::toImageMsgLayout(sensor_msgs::Image& ros_image, const ImageConversionOptions& options) const {
+        ConversionRegion region = getConversionRegion(image->Width(), image->Height(), options);
+        int dst_channels = 1;
+        if (image->CountChannels() > 1) {
+            dst_channels = sensor_msgs::image_encodings::hasAlpha(encoding) ? 4 : 3;
+        }
+        int type_size = getHalconTypeSize((std::string)image->GetImageType());
+        size_t step = dst_channels * region.out_width * type_size;
+        if (options.row_alignment > 1) {
+            step = ((step + options.row_alignment - 1) / options.row_alignment) * options.row_alignment;
+        }
+
+        ros_image.header = header;
+        ros_image.height = region.out_height;
+        ros_image.width = region.out_width;
+        ros_image.encoding = encoding;
+        ros_image.is_bigendian = isHostBigEndian();
+        ros_image.step = step;
+    }
 
-            if (getColorChannelOrder(encoding) == RGB) {
-                imageRed = imageRed.ReduceDomain(clippedRegion);
-            } else {
-                imageBlue = imageBlue.ReduceDomain(clippedRegion);
-            }
-            movedRegion = regionGrid.MoveRegion(-1, 1);
-            clippedRegion = movedRegion.ClipRegion(0, 0, height - 1, (3 * width) - 1);
-            imageGreen = imageGreen.ReduceDomain(clippedRegion);
-            movedRegion = regionGrid.MoveRegion(-1, 2);
-            clippedRegion = movedRegion.ClipRegion(0, 0, height - 1, (3 * width) - 1);
-            if (getColorChannelOrder(encoding) == RGB) {
-                imageBlue = imageBlue.ReduceDomain(clippedRegion);
-            } else {
-                imageRed = imageRed.ReduceDomain(clippedRegion);
-            }
 
-            interleavedImage->OverpaintGray(imageRed);
-            interleavedImage->OverpaintGray(imageGreen);
-            interleavedImage->OverpaintGray(imageBlue);
 
+    void HalconImage::toImageMsg(sensor_msgs::Image& ros_image, unsigned int row_alignment) const {
+        ImageConversionOptions options;
+        options.row_alignment = row_alignment;
+        toImageMsg(ros_image, options);
+    }
 
+    void HalconImage::toImageMsg(sensor_msgs::Image& ros_image, const ImageConversionOptions& options) const {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_IMAGE);
+        toImageMsgLayout(ros_image, options);
+        ConversionRegion region = getConversionRegion(image->Width(), image->Height(), options);
 
-            // copy data of interleaved image into sensor_msg
-            unsigned char* colorData = (unsigned char*)interleavedImage->GetImagePointer1(&typeReturn, &widthReturn, &heightReturn);
-            int interleavedHeight = interleavedImage->Height();
-            int interleavedWidth =  interleavedImage->Width();
-            size_t size = interleavedHeight * interleavedWidth * getHalconTypeSize((std::string)typeReturn);
-            ros_image.data.resize(size);
-            memcpy((unsigned char*)(&ros_image.data[0]), colorData, size);
+        int channel_count = image->CountChannels();
+        int dst_channels = 1;
+        if (channel_count > 1) {
+            dst_channels = sensor_msgs::image_encodings::hasAlpha(encoding) ? 4 : 3;
+        }
+        int type_size = getHalconTypeSize((std::string)image->GetImageType());
+        resizeMessageBuffer(ros_image.data, (size_t)ros_image.step * ros_image.height);
+        HALCON_BRIDGE_STATS_BYTES(ros_image.data.size());
 
-            interleavedImage->Clear();
-            imageRed.Clear();
-            imageGreen.Clear();
-            imageBlue.Clear();
-            homMat.Clear();
-            regionGrid.Clear();
-            clippedRegion.Clear();
-            movedRegion.Clear();
 
+        HalconCpp::HString typeReturn;
+        Hlong widthReturn;
+        Hlong heightReturn;
+
+        // fetch the planes once, in the order in which they appear in a packed pixel
+        const uint8_t* planes[4] = {NULL, NULL, NULL, NULL};
+        int plane_count = 1;
+        HalconCpp::HImage alphaImage;
+        if (channel_count > 1) {
+            if ((type_size != 1) && (type_size != 2)) {
+                throw Exception("Image type " + (std::string)image->GetImageType() + " not supported for multi-channel images");
+            }
+
+            void *red, *green, *blue;
+            image->GetImagePointer3(&red, &green, &blue, &typeReturn, &widthReturn, &heightReturn);
+            planes[0] = (const uint8_t*)red;
+            planes[1] = (const uint8_t*)green;
+            planes[2] = (const uint8_t*)blue;
+            if (getColorChannelOrder(encoding) == BGR) {
+                std::swap(planes[0], planes[2]);
+            }
+            plane_count = 3;
 
+            if ((channel_count > 3) && (dst_channels > 3)) {
+                alphaImage = image->AccessChannel(4);
+                planes[3] = (const uint8_t*)alphaImage.GetImagePointer1(&typeReturn, &widthReturn, &heightReturn);
+            }
         } else {
+            planes[0] = (const uint8_t*)image->GetImagePointer1(&typeReturn, &widthReturn, &heightReturn);
+        }
+        int used_planes = planes[3] ? 4 : plane_count;
+
+        // crop and decimate into scratch planes, then halve them once per pyramid level. A list does not allocate
+        // until a plane is added, so full frame exports do not allocate at all.
+        std::list<PooledBuffer> scratch;
+        if (!region.full_frame) {
+            size_t width = image->Width();
+            for (int i = 0; i < used_planes; i++) {
+                scratch.emplace_back(imageBufferPool(), region.stride_width * region.stride_height * type_size);
+                uint8_t* dst = (uint8_t*)scratch.back().data();
+                const uint8_t* src = planes[i];
+                parallelFor(region.stride_height, region.stride_width * region.stride_height * type_size, [&](size_t first_row, size_t last_row) {
+                    for (size_t row = first_row; row < last_row; row++) {
+                        const uint8_t* src_row = src + ((region.y + row * options.row_stride) * width + region.x) * type_size;
+                        if (type_size == 1) {
+                            decimatePixels8(src_row, dst + row * region.stride_width, NULL, NULL,
+                                            region.stride_width, 1, options.column_stride);
+                        } else if (type_size == 2) {
+                            decimatePixels16(src_row, (uint16_t*)(dst + row * region.stride_width * 2), NULL, NULL,
+                                             region.stride_width, 1, options.column_stride, false);
+                        } else {
+                            for (size_t col = 0; col < region.stride_width; col++) {
+                                memcpy(dst + (row * region.stride_width + col) * type_size,
+                                       src_row + col * options.column_stride * type_size, type_size);
+                            }
+                        }
+                    }
+                });
+                planes[i] = dst;
+            }
+        }
 
-            // 1-channel image: copy data of original image
-            unsigned char* colorData = (unsigned char*)image->GetImagePointer1(&typeReturn, &widthReturn, &heightReturn);
-            size_t size = height * width * getHalconTypeSize((std::string)typeReturn);
-            ros_image.data.resize(size);
-            memcpy((unsigned char*)(&ros_image.data[0]), colorData, size);
+        if (region.levels > 0) {
+            if ((type_size != 1) && (type_size != 2)) {
+                throw Exception("Image type " + (std::string)image->GetImageType() + " not supported for pyramids");
+            }
+            size_t width = region.stride_width;
+            size_t height = region.stride_height;
+            for (unsigned int level = 0; level < region.levels; level++) {
+                uint8_t* dst[4];
+                for (int i = 0; i < used_planes; i++) {
+                    scratch.emplace_back(imageBufferPool(), (width / 2) * (height / 2) * type_size);
+                    dst[i] = (uint8_t*)scratch.back().data();
+                }
+                downsamplePlanes(planes, dst, used_planes, type_size, width, height);
+                width /= 2;
+                height /= 2;
+                for (int i = 0; i < used_planes; i++) {
+                    planes[i] = dst[i];
+                }
+            }
         }
 
+        writeImageData(planes, plane_count, type_size, dst_channels, region.out_width, region.out_height,
+                       ros_image.step, &ros_image.data[0]);
     }
 
 
 
-    HalconImagePtr toHalconCopy(const sensor_msgs::ImageConstPtr& source) {
-      return toHalconCopy(*source);
+    HalconImagePtr toHalconCopy(const sensor_msgs::ImageConstPtr& source, const ImageConversionOptions& options) {
+      return toHalconCopy(*source, options);
     }
 
-    HalconImagePtr toHalconCopy(const sensor_msgs::Image& source) {
+    HalconImagePtr toHalconCopy(const sensor_msgs::Image& source, const ImageConversionOptions& options) {
+        HALCON_BRIDGE_STATS_SCOPE(IMAGE_TO_HALCON);
         HalconImagePtr ptr = boost::make_shared<HalconImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
         ptr->header = source.header;
         ptr->encoding = source.encoding;
 
@@ -203,19 +471,228 @@ namespace halcon_bridge {
             throw Exception("Encoding " + ptr->encoding + " not supported");
         }
 
-        long* pixeldata = (long*)const_cast<unsigned char*>(&source.data[0]);
+        const char* type = getHalconChannelLength(source.encoding);
+        int type_size = getHalconTypeSize(type);
+        int channels = sensor_msgs::image_encodings::numChannels(source.encoding);
+        size_t row_size = source.width * channels * type_size;
+        if ((source.step < row_size) || (source.data.size() < (size_t)source.step * source.height)) {
+            throw Exception("Image data does not match its width, height and step");
+        }
+        ConversionRegion region = getConversionRegion(source.width, source.height, options);
+
+        bool swap_bytes = (type_size > 1) && ((bool)source.is_bigendian != isHostBigEndian());
+        bool padded = source.step != row_size;
+        size_t width = region.stride_width;
+        size_t height = region.stride_height;
+        size_t count = width * height;
+        size_t pixel_size = channels * type_size;
+        // only the selected rows are read, starting at the first selected pixel
+        const uint8_t* src = &source.data[0] + region.y * source.step + region.x * pixel_size;
+        size_t src_step = (size_t)source.step * options.row_stride;
+        HALCON_BRIDGE_STATS_BYTES(region.full_frame ? (size_t)source.step * source.height : count * pixel_size);
         HalconCpp::HImage *img = new HalconCpp::HImage();
-        if ((std::string)getHalconEncoding(source.encoding) == "mono") {
-             img->GenImage1(getHalconChannelLength(source.encoding), source.width, source.height, pixeldata);
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        uint8_t* planes[3] = {NULL, NULL, NULL};
+        int plane_count = (channels == 1) ? 1 : 3;
+
+        if (options.demosaic && sensor_msgs::image_encodings::isBayer(source.encoding)) {
+            // interpolate the missing colors of the selected pixels straight into planes owned by the HImage or the
+            // buffer pool, every source row is read once per output row that needs it
+            if ((source.width < 2) || (source.height < 2)) {
+                throw Exception("Bayer images need at least 2x2 pixels to be demosaiced");
+            }
+            ptr->encoding = (type_size == 1) ? sensor_msgs::image_encodings::RGB8 : sensor_msgs::image_encodings::RGB16;
+            plane_count = 3;
+            for (int i = 0; i < 3; i++) {
+                planes[i] = (uint8_t*)imageBufferPool().acquire(count * type_size);
+            }
+            size_t red_row, red_column;
+            getBayerRedPhase(source.encoding, red_row, red_column);
+
+            const uint8_t* data = &source.data[0];
+            parallelFor(height, count * 3 * type_size, [&](size_t first_row, size_t last_row) {
+                // with a column stride, full rows of the region are demosaiced into scratch planes and decimated
+                std::vector<uint8_t> scratch;
+                if (options.column_stride > 1) {
+                    scratch.resize(3 * region.width * type_size);
+                }
+                for (size_t row = first_row; row < last_row; row++) {
+                    size_t src_row = region.y + row * options.row_stride;
+                    const uint8_t* above = data + ((src_row > 0) ? src_row - 1 : 1) * source.step;
+                    const uint8_t* below = data + ((src_row + 1 < source.height) ? src_row + 1 : source.height - 2) * source.step;
+                    const uint8_t* center = data + src_row * source.step;
+
+                    bool x_is_red = (src_row & 1) == red_row;
+                    bool x_at_odd = x_is_red ? red_column : !red_column;
+                    size_t offset = row * width * type_size;
+                    uint8_t* x = (x_is_red ? planes[0] : planes[2]) + offset;
+                    uint8_t* green = planes[1] + offset;
+                    uint8_t* y = (x_is_red ? planes[2] : planes[0]) + offset;
+                    uint8_t* dst[3] = {x, green, y};
+                    if (options.column_stride > 1) {
+                        for (int i = 0; i < 3; i++) {
+                            dst[i] = &scratch[i * region.width * type_size];
+                        }
+                    }
+
+                    size_t columns = (options.column_stride > 1) ? region.width : width;
+                    if (type_size == 1) {
+                        demosaicRow8(above, center, below, source.width, region.x, columns, x_at_odd, dst[0], dst[1], dst[2]);
+                    } else {
+                        demosaicRow16(above, center, below, source.width, region.x, columns, x_at_odd, swap_bytes,
+                                      (uint16_t*)dst[0], (uint16_t*)dst[1], (uint16_t*)dst[2]);
+                    }
+
+                    if (options.column_stride > 1) {
+                        uint8_t* planes_of_row[3] = {x, green, y};
+                        for (int i = 0; i < 3; i++) {
+                            if (type_size == 1) {
+                                decimatePixels8(dst[i], planes_of_row[i], NULL, NULL, width, 1, options.column_stride);
+                            } else {
+                                decimatePixels16(dst[i], (uint16_t*)planes_of_row[i], NULL, NULL, width, 1, options.column_stride, false);
+                            }
+                        }
+                    }
+                }
+            });
+            img->GenImage3Extern(type, width, height, planes[0], planes[1], planes[2], (void*)releaseImagePlane);
+        } else if (region.full_frame && (region.levels == 0) && !padded && !swap_bytes && ((channels == 1) || (type_size == 1)) &&
+                !isBufferPoolEnabled()) {
+            // the message layout can be read by Halcon as it is, copy it in bulk
+            long* pixeldata = (long*)const_cast<unsigned char*>(src);
+            if (channels == 1) {
+                img->GenImage1(type, source.width, source.height, pixeldata);
+            } else {
+                img->GenImageInterleaved(pixeldata, getHalconEncoding(source.encoding), source.width, source.height, 0,
+                                         type, source.width, source.height, 0, 0, -1, 0);
+            }
+        } else if (channels == 1) {
+            // copy the selected rows into a buffer owned by the HImage or the buffer pool, swapping the byte order if needed
+            size_t plane_row = width * type_size;
+            planes[0] = (uint8_t*)imageBufferPool().acquire(count * type_size);
+            uint8_t* plane = planes[0];
+            parallelFor(height, count * type_size, [&](size_t first_row, size_t last_row) {
+                for (size_t row = first_row; row < last_row; row++) {
+                    const uint8_t* src_row = src + row * src_step;
+                    if (options.column_stride > 1) {
+                        if (type_size == 1) {
+                            decimatePixels8(src_row, plane + row * plane_row, NULL, NULL, width, 1, options.column_stride);
+                        } else {
+                            decimatePixels16(src_row, (uint16_t*)(plane + row * plane_row), NULL, NULL, width, 1,
+                                             options.column_stride, swap_bytes);
+                        }
+                    } else if (swap_bytes) {
+                        swapBytes16(src_row, (uint16_t*)(plane + row * plane_row), width);
+                    } else {
+                        memcpy(plane + row * plane_row, src_row, plane_row);
+                    }
+                }
+            });
+            img->GenImage1Extern(type, width, height, plane, (void*)releaseImagePlane);
         } else {
-            img->GenImageInterleaved(pixeldata, getHalconEncoding(source.encoding), source.width, source.height, 0,
-                                 getHalconChannelLength(source.encoding), source.width, source.height, 0, 0, -1, 0);
+            // split the selected pixels into planes owned by the HImage or the buffer pool in a single pass
+            for (int i = 0; i < 3; i++) {
+                planes[i] = (uint8_t*)imageBufferPool().acquire(count * type_size);
+            }
+            uint8_t* first = planes[0];
+            uint8_t* third = planes[2];
+            if (getColorChannelOrder(source.encoding) == BGR) {
+                first = planes[2];
+                third = planes[0];
+            }
+
+            // without padding a band of rows of the full frame is split with a single call
+            bool contiguous = region.full_frame && !padded;
+            parallelFor(height, count * pixel_size, [&](size_t first_row, size_t last_row) {
+                size_t rows = contiguous ? 1 : last_row - first_row;
+                size_t row_pixels = contiguous ? (last_row - first_row) * width : width;
+                for (size_t row = first_row; row < first_row + rows; row++) {
+                    const uint8_t* src_row = src + row * src_step;
+                    size_t offset = row * width * type_size;
+                    if (type_size == 1) {
+                        if (options.column_stride > 1) {
+                            decimatePixels8(src_row, first + offset, planes[1] + offset, third + offset,
+                                            row_pixels, channels, options.column_stride);
+                        } else {
+                            deinterleavePixels8(src_row, first + offset, planes[1] + offset, third + offset,
+                                                row_pixels, channels);
+                        }
+                    } else {
+                        if (options.column_stride > 1) {
+                            decimatePixels16(src_row, (uint16_t*)(first + offset), (uint16_t*)(planes[1] + offset),
+                                             (uint16_t*)(third + offset), row_pixels, channels, options.column_stride, swap_bytes);
+                        } else {
+                            deinterleavePixels16(src_row, (uint16_t*)(first + offset), (uint16_t*)(planes[1] + offset),
+                                                 (uint16_t*)(third + offset), row_pixels, channels, swap_bytes);
+                        }
+                    }
+                }
+            });
+            img->GenImage3Extern(type, width, height, planes[0], planes[1], planes[2], (void*)releaseImagePlane);
         }
         ptr->image = img;
 
+        if (region.levels > 0) {
+            buildPyramid(planes, plane_count, type, type_size, width, height, region.levels, ptr->pyramid);
+        }
+
         return ptr;
     }
 
-}
 
 
+    HalconImageConstPtr toHalconShare(const sensor_msgs::ImageConstPtr& source) {
+        return toHalconShare(*source, source);
+    }
+
+    HalconImageConstPtr toHalconShare(const sensor_msgs::Image& source, const boost::shared_ptr<void const>& tracked_object) {
+        HALCON_BRIDGE_STATS_SCOPE(IMAGE_SHARE_TO_HALCON);
+        if (!isShareable(source)) {
+            return toHalconCopy(source);
+        }
+
+        HalconImagePtr ptr = boost::make_shared<HalconImage>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        ptr->header = source.header;
+        ptr->encoding = source.encoding;
+        ptr->tracked_object_ = tracked_object;
+
+        // Halcon must not free the message buffer, so no clear procedure is passed
+        void* pixeldata = const_cast<unsigned char*>(&source.data[0]);
+        HalconCpp::HImage *img = new HalconCpp::HImage();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        img->GenImage1Extern(getHalconChannelLength(source.encoding), source.width, source.height, pixeldata, NULL);
+        ptr->image = img;
+
+        return ptr;
+    }
+
+
+
+    LazyHalconImage::LazyHalconImage(const sensor_msgs::ImageConstPtr& source) :
+            header(source->header), encoding(source->encoding), source_(source) {
+    }
+
+    HalconImageConstPtr LazyHalconImage::getHalconImage() const {
+        std::call_once(converted_flag_, [this]() {
+            HalconImageConstPtr converted = toHalconShare(source_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            converted_ = converted;
+        });
+        return converted_;
+    }
+
+    const HalconCpp::HImage& LazyHalconImage::getImage() const {
+        return *getHalconImage()->image;
+    }
+
+    bool LazyHalconImage::isConverted() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (bool)converted_;
+    }
+
+    LazyHalconImageConstPtr toHalconLazy(const sensor_msgs::ImageConstPtr& source) {
+        return boost::make_shared<LazyHalconImage>(source);
+    }
+
+}
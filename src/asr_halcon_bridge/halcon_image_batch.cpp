@@ -0,0 +1,121 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_image_batch.h>
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include <boost/make_shared.hpp>
+
+#include <chrono>
+#include <exception>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        double getSecondsSince(const std::chrono::steady_clock::time_point& start) {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    }
+
+
+
+    HalconImageBatch::HalconImageBatch() : conversion_time(0.0) {
+    }
+
+    size_t HalconImageBatch::size() const {
+        return headers.size();
+    }
+
+    HalconCpp::HImage HalconImageBatch::getImage(size_t index) const {
+        if (index >= size()) {
+            throw Exception("Image index out of range");
+        }
+        return images.SelectObj(index + 1);
+    }
+
+
+
+    HalconImageBatchPtr toHalconCopy(const std::vector<sensor_msgs::ImageConstPtr>& sources, const ImageConversionOptions& options) {
+        HALCON_BRIDGE_STATS_SCOPE(IMAGE_BATCH_TO_HALCON);
+        if (sources.empty()) {
+            throw Exception("Image batch is empty");
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < sources.size(); i++) {
+            bytes += (size_t)sources[i]->step * sources[i]->height;
+        }
+        HALCON_BRIDGE_STATS_BYTES(bytes);
+
+        // an exception of one image, including an HException, is rethrown once all images are done
+        std::vector<HalconImagePtr> converted(sources.size());
+        std::vector<double> times(sources.size());
+        std::vector<std::exception_ptr> errors(sources.size());
+        auto convert = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                std::chrono::steady_clock::time_point image_start = std::chrono::steady_clock::now();
+                try {
+                    converted[i] = toHalconCopy(*sources[i], options);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+                times[i] = getSecondsSince(image_start);
+            }
+        };
+
+        // conversions inside a parallelFor body run on their thread only, so converting the images side by side
+        // gives up the row parallelism of every single image
+        if (sources.size() >= getConversionThreads()) {
+            parallelFor(sources.size(), bytes, convert);
+        } else {
+            convert(0, sources.size());
+        }
+
+        for (size_t i = 0; i < errors.size(); i++) {
+            if (errors[i]) {
+                std::rethrow_exception(errors[i]);
+            }
+        }
+
+        HalconImageBatchPtr ptr = boost::make_shared<HalconImageBatch>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
+        for (size_t i = 0; i < converted.size(); i++) {
+            ptr->headers.push_back(converted[i]->header);
+            ptr->encodings.push_back(converted[i]->encoding);
+            ptr->images = (i == 0) ? *converted[i]->image : ptr->images.ConcatObj(*converted[i]->image);
+        }
+        ptr->image_conversion_times = times;
+        ptr->conversion_time = getSecondsSince(start);
+        return ptr;
+    }
+
+    HalconImageBatchPtr toHalconStereoCopy(const sensor_msgs::ImageConstPtr& left, const sensor_msgs::ImageConstPtr& right,
+                                           const ImageConversionOptions& options) {
+        if ((left->width != right->width) || (left->height != right->height) || (left->encoding != right->encoding)) {
+            throw Exception("Left and right image of a stereo pair must have the same size and encoding");
+        }
+        std::vector<sensor_msgs::ImageConstPtr> sources(2);
+        sources[0] = left;
+        sources[1] = right;
+        return toHalconCopy(sources, options);
+    }
+
+}
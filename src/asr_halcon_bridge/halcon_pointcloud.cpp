@@ -21,6 +21,16 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <sensor_msgs/PointCloud2.h>
 #include <sensor_msgs/PointField.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "cloud_kernels.h"
+#include "finite_domain.h"
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include "pooled_buffers.h"
+
 namespace halcon_bridge {
 
     int getSizeFromDatatype(int datatype) {
@@ -36,224 +46,648 @@ namespace halcon_bridge {
         return -1;
     }
 
+    const double* getRealArray(HalconCpp::HTuple& tuple) {
+        if (tuple.Type() != HalconCpp::eTupleTypeDouble) {
+            tuple = tuple.TupleReal();
+        }
+        return tuple.DArr();
+    }
+
+    inline bool isFinitePoint(const float* x, const float* y, const float* z, size_t i) {
+        return std::isfinite(x[i]) && std::isfinite(y[i]) && std::isfinite(z[i]);
+    }
+
+    HalconCpp::HRegion getFiniteDomain(const float* x, const float* y, const float* z, size_t width, size_t height) {
+        std::vector<Hlong> rows, column_begins, column_ends;
+        for (size_t row = 0; row < height; row++) {
+            size_t row_start = row * width;
+            size_t column = 0;
+            while (column < width) {
+                while ((column < width) && !isFinitePoint(x, y, z, row_start + column)) column++;
+                if (column == width) break;
+                size_t begin = column;
+                while ((column < width) && isFinitePoint(x, y, z, row_start + column)) column++;
+                rows.push_back(row);
+                column_begins.push_back(begin);
+                column_ends.push_back(column - 1);
+            }
+        }
+
+        HalconCpp::HRegion domain;
+        Hlong runs = rows.size();
+        if (runs > 0) {
+            domain.GenRegionRuns(HalconCpp::HTuple(&rows[0], runs), HalconCpp::HTuple(&column_begins[0], runs),
+                                 HalconCpp::HTuple(&column_ends[0], runs));
+        } else {
+            domain.GenRegionRuns(HalconCpp::HTuple(), HalconCpp::HTuple(), HalconCpp::HTuple());
+        }
+        return domain;
+    }
+
+    size_t compactFinitePoints(float* x, float* y, float* z, size_t count, const std::vector<float*>& attributes) {
+        size_t valid = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!isFinitePoint(x, y, z, i)) continue;
+            x[valid] = x[i];
+            y[valid] = y[i];
+            z[valid] = z[i];
+            for (size_t j = 0; j < attributes.size(); j++) {
+                attributes[j][valid] = attributes[j][i];
+            }
+            valid++;
+        }
+        return valid;
+    }
+
+    bool hasAttribute(const HalconCpp::HTuple& names, const char* name) {
+        for (Hlong i = 0; i < names.Length(); i++) {
+            if ((HalconCpp::HString)names[i] == HalconCpp::HString(name)) return true;
+        }
+        return false;
+    }
+
+    std::string getModelAttributeName(const std::string& field_name) {
+        if ((field_name == "x") || (field_name == "y") || (field_name == "z")) return "point_coord_" + field_name;
+        if ((field_name == "normal_x") || (field_name == "normal_y") || (field_name == "normal_z")) return "point_" + field_name;
+        return "&" + field_name;
+    }
+
+    void addFloatField(std::vector<sensor_msgs::PointField>& fields, const std::string& name) {
+        sensor_msgs::PointField field;
+        field.name = name;
+        field.count = 1;
+        field.datatype = sensor_msgs::PointField::FLOAT32;
+        field.offset = fields.size() * sizeof(float);
+        fields.push_back(field);
+    }
+
+    // Per-thread scratch of the point cloud export. It keeps its capacity, so steady-state exports into pooled
+    // messages do not allocate.
+    struct ExportScratch {
+        sensor_msgs::PointCloud2 layout;
+        std::vector<HalconCpp::HTuple> values;
+        std::vector<const double*> arrays;
+    };
+
+    ExportScratch& getExportScratch() {
+        thread_local ExportScratch scratch;
+        return scratch;
+    }
+
+    HalconPointcloud::HalconPointcloud() : model(NULL) {
+    }
+
     HalconPointcloud::~HalconPointcloud() {
         delete model;
-        curvature.Clear();
     }
 
     sensor_msgs::PointCloud2Ptr HalconPointcloud::toPointcloudMsg() const {
-        sensor_msgs::PointCloud2Ptr ptr = boost::make_shared<sensor_msgs::PointCloud2>();
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_POINTCLOUD);
+        sensor_msgs::PointCloud2Ptr ptr;
+        if (isBufferPoolEnabled()) {
+            sensor_msgs::PointCloud2& layout = getExportScratch().layout;
+            toPointcloudMsgLayout(layout);
+            ptr = pointcloudMessagePool().acquire((size_t)layout.row_step * layout.height);
+        } else {
+            ptr = boost::make_shared<sensor_msgs::PointCloud2>();
+            HALCON_BRIDGE_STATS_ALLOCATION();
+        }
         toPointcloudMsg(*ptr);
         return ptr;
     }
 
-    void HalconPointcloud::toPointcloudMsg(sensor_msgs::PointCloud2& ros_pointcloud) const {
+    void HalconPointcloud::toPointcloudMsgLayout(sensor_msgs::PointCloud2& ros_pointcloud) const {
+        if (!model) {
+            throw Exception("Point cloud has no model");
+        }
+        size_t count = (int)model->GetObjectModel3dParams("num_points")[0];
+        bool organized = ((HalconCpp::HString)model->GetObjectModel3dParams("has_xyz_mapping")) == HalconCpp::HString("true");
+
         ros_pointcloud.header = header;
-        ros_pointcloud.height = 1;
-        ros_pointcloud.width = (int)model->GetObjectModel3dParams("num_points")[0];
+        if (organized) {
+            // restore the grid of the images the model was created from
+            HalconCpp::HTuple mapping_size = model->GetObjectModel3dParams("mapping_size");
+            ros_pointcloud.width = (int)mapping_size[0];
+            ros_pointcloud.height = (int)mapping_size[1];
+        } else {
+            ros_pointcloud.height = 1;
+            ros_pointcloud.width = count;
+        }
         ros_pointcloud.is_dense = false;
         ros_pointcloud.is_bigendian = false;
         bool has_normals = ((HalconCpp::HString)model->GetObjectModel3dParams("has_point_normals")) == HalconCpp::HString("true");
-        std::vector<sensor_msgs::PointField> fields;
+        HalconCpp::HTuple attribute_names = model->GetObjectModel3dParams("extended_attribute_names");
+
+        // fill the fields in place, they keep their capacity when the message is reused
+        std::vector<sensor_msgs::PointField>& fields = ros_pointcloud.fields;
+        fields.clear();
+        addFloatField(fields, "x");
+        addFloatField(fields, "y");
+        addFloatField(fields, "z");
         if (has_normals) {
-            ros_pointcloud.point_step = 28;
-            fields = std::vector<sensor_msgs::PointField>(7);
-        } else {
-            ros_pointcloud.point_step = 12;
-            fields = std::vector<sensor_msgs::PointField>(3);
+            addFloatField(fields, "normal_x");
+            addFloatField(fields, "normal_y");
+            addFloatField(fields, "normal_z");
+        }
+        if (has_normals || hasAttribute(attribute_names, "&curvature")) {
+            addFloatField(fields, "curvature");
+        }
+        bool has_color = hasAttribute(attribute_names, "&red") && hasAttribute(attribute_names, "&green") && hasAttribute(attribute_names, "&blue");
+        if (has_color) {
+            addFloatField(fields, "rgb");
+        }
+        // every other extended attribute becomes a field of its own
+        for (Hlong i = 0; i < attribute_names.Length(); i++) {
+            std::string name = (const char*)(HalconCpp::HString)attribute_names[i];
+            if ((name.size() < 2) || (name[0] != '&') || (name == "&curvature")) continue;
+            if (has_color && ((name == "&red") || (name == "&green") || (name == "&blue"))) continue;
+            addFloatField(fields, name.substr(1));
         }
 
+        ros_pointcloud.point_step = fields.size() * sizeof(float);
         ros_pointcloud.row_step = ros_pointcloud.width * ros_pointcloud.point_step;
+    }
 
+    void HalconPointcloud::toPointcloudMsg(sensor_msgs::PointCloud2& ros_pointcloud) const {
+        HALCON_BRIDGE_STATS_SCOPE(HALCON_TO_POINTCLOUD);
+        toPointcloudMsgLayout(ros_pointcloud);
+
+        size_t count = (int)model->GetObjectModel3dParams("num_points")[0];
+        bool organized = ((HalconCpp::HString)model->GetObjectModel3dParams("has_xyz_mapping")) == HalconCpp::HString("true");
+
+        size_t cells = (size_t)ros_pointcloud.width * ros_pointcloud.height;
+        resizeMessageBuffer(ros_pointcloud.data, cells * ros_pointcloud.point_step);
+        HALCON_BRIDGE_STATS_BYTES(ros_pointcloud.data.size());
+
+        // fetch every attribute once as a raw array and write the records straight into the message
+        HalconCpp::HTuple attribute_names = model->GetObjectModel3dParams("extended_attribute_names");
+        size_t field_count = ros_pointcloud.fields.size();
+        ExportScratch& scratch = getExportScratch();
+        std::vector<HalconCpp::HTuple>& values = scratch.values;
+        std::vector<const double*>& arrays = scratch.arrays;
+        values.clear();
+        values.resize(field_count);
+        arrays.assign(field_count, (const double*)NULL);
+        int rgb_index = -1;
+        for (size_t i = 0; i < field_count; i++) {
+            const std::string& name = ros_pointcloud.fields[i].name;
+            if (name == "rgb") {
+                // written separately below, the packed value is not a number
+                rgb_index = i;
+                continue;
+            }
+            std::string attribute = getModelAttributeName(name);
+            if ((attribute[0] != '&') || hasAttribute(attribute_names, attribute.c_str())) {
+                values[i] = model->GetObjectModel3dParams(attribute.c_str());
+            }
+            if ((size_t)values[i].Length() == count) {
+                arrays[i] = getRealArray(values[i]);
+            }
+        }
 
-        sensor_msgs::PointField x_field;
-        x_field.name = "x";
-        x_field.count = 1;
-        x_field.datatype = sensor_msgs::PointField::FLOAT32;
-        x_field.offset = 0;
-        fields[0] = x_field;
-
-        sensor_msgs::PointField y_field;
-        y_field.name = "y";
-        y_field.count = 1;
-        y_field.datatype = sensor_msgs::PointField::FLOAT32;
-        y_field.offset = 4;
-        fields[1] = y_field;
-
-        sensor_msgs::PointField z_field;
-        z_field.name = "z";
-        z_field.count = 1;
-        z_field.datatype = sensor_msgs::PointField::FLOAT32;
-        z_field.offset = 8;
-        fields[2] = z_field;
+        HalconCpp::HTuple colors[3];
+        const double* color_arrays[3] = { NULL, NULL, NULL };
+        if (rgb_index >= 0) {
+            colors[0] = model->GetObjectModel3dParams("&red");
+            colors[1] = model->GetObjectModel3dParams("&green");
+            colors[2] = model->GetObjectModel3dParams("&blue");
+            for (int i = 0; i < 3; i++) {
+                color_arrays[i] = ((size_t)colors[i].Length() == count) ? getRealArray(colors[i]) : NULL;
+            }
+            if (!color_arrays[0] || !color_arrays[1] || !color_arrays[2]) {
+                rgb_index = -1;
+            }
+        }
+        PooledBuffer packed_colors(pointcloudBufferPool(), (rgb_index >= 0) ? count * sizeof(uint32_t) : 0);
+        uint32_t* packed = (uint32_t*)packed_colors.data();
 
-        if (has_normals) {
-            sensor_msgs::PointField x_normals_field;
-            x_normals_field.name = "normal_x";
-            x_normals_field.count = 1;
-            x_normals_field.datatype = sensor_msgs::PointField::FLOAT32;
-            x_normals_field.offset = 12;
-            fields[3] = x_normals_field;
+        if (cells == 0) {
+            values.clear();
+            return;
+        }
+        float* dst = (float*)&ros_pointcloud.data[0];
+        if (organized) {
+            // cells without a point are invalid measurements
+            std::fill(dst, dst + cells * field_count, std::numeric_limits<float>::quiet_NaN());
+            HalconCpp::HTuple rows = model->GetObjectModel3dParams("mapping_row");
+            HalconCpp::HTuple cols = model->GetObjectModel3dParams("mapping_col");
+            const Hlong* row_values = rows.LArr();
+            const Hlong* col_values = cols.LArr();
+            parallelFor(count, cells * ros_pointcloud.point_step, [&](size_t begin, size_t end) {
+                scatterFields<Hlong>(&arrays[0], field_count, begin, end, row_values, col_values, ros_pointcloud.width, dst);
+                if (rgb_index >= 0) {
+                    packColors(color_arrays[0] + begin, color_arrays[1] + begin, color_arrays[2] + begin, end - begin, packed + begin);
+                    for (size_t i = begin; i < end; i++) {
+                        size_t cell = (size_t)row_values[i] * ros_pointcloud.width + (size_t)col_values[i];
+                        memcpy(dst + cell * field_count + rgb_index, packed + i, sizeof(uint32_t));
+                    }
+                }
+            });
+        } else {
+            parallelFor(count, cells * ros_pointcloud.point_step, [&](size_t begin, size_t end) {
+                interleaveFields(&arrays[0], field_count, begin, end, dst);
+                if (rgb_index >= 0) {
+                    packColors(color_arrays[0] + begin, color_arrays[1] + begin, color_arrays[2] + begin, end - begin, packed + begin);
+                    for (size_t i = begin; i < end; i++) {
+                        memcpy(dst + i * field_count + rgb_index, packed + i, sizeof(uint32_t));
+                    }
+                }
+            });
+        }
+        values.clear();
+    }
 
-            sensor_msgs::PointField y_normals_field;
-            y_normals_field.name = "normal_y";
-            y_normals_field.count = 1;
-            y_normals_field.datatype = sensor_msgs::PointField::FLOAT32;
-            y_normals_field.offset = 16;
-            fields[4] = y_normals_field;
 
-            sensor_msgs::PointField z_normals_field;
-            z_normals_field.name = "normal_z";
-            z_normals_field.count = 1;
-            z_normals_field.datatype = sensor_msgs::PointField::FLOAT32;
-            z_normals_field.offset = 20;
-            fields[5] = z_normals_field;
 
-            sensor_msgs::PointField curvature;
-            curvature.name = "curvature";
-            curvature.count = 1;
-            curvature.datatype = sensor_msgs::PointField::FLOAT32;
-            curvature.offset = 24;
-            fields[6] = curvature;
-        }
+    struct FieldLocation {
+        bool present;
+        uint32_t offset;
+        uint8_t datatype;
+    };
 
+    struct PointCloudLayoutCache::Layout {
+        PointLayout point_layout;
+        FieldLocation x, y, z, normal_x, normal_y, normal_z, curvature, rgb, intensity;
+        /// scalar fields without a standard meaning, stored as extended attributes
+        std::vector<sensor_msgs::PointField> extra_fields;
+    };
 
-        ros_pointcloud.fields = fields;
+    bool isFloatAt(const FieldLocation& field, uint32_t offset) {
+        return field.present && (field.offset == offset) && (field.datatype == sensor_msgs::PointField::FLOAT32);
+    }
 
+    bool isColorAt(const FieldLocation& field, uint32_t offset) {
+        return field.present && (field.offset == offset) && (getSizeFromDatatype(field.datatype) == 4);
+    }
 
-        HalconCpp::HTuple x_values = model->GetObjectModel3dParams("point_coord_x");
-        HalconCpp::HTuple y_values = model->GetObjectModel3dParams("point_coord_y");
-        HalconCpp::HTuple z_values = model->GetObjectModel3dParams("point_coord_z");
+    // A fixed layout only fills the attributes it has, so it is chosen only if every other attribute is absent.
+    PointLayout getPointLayout(const PointCloudLayoutCache::Layout& layout, uint32_t point_step) {
+        if (!isFloatAt(layout.x, 0) || !isFloatAt(layout.y, 4) || !isFloatAt(layout.z, 8)) {
+            return POINT_LAYOUT_GENERIC;
+        }
+        bool normals = isFloatAt(layout.normal_x, 16) && isFloatAt(layout.normal_y, 20) && isFloatAt(layout.normal_z, 24);
+        bool no_normals = !layout.normal_x.present && !layout.normal_y.present && !layout.normal_z.present && !layout.curvature.present;
+        bool no_color = !layout.rgb.present;
+        bool no_intensity = !layout.intensity.present;
 
-        HalconCpp::HTuple x_normal_values;
-        HalconCpp::HTuple y_normal_values;
-        HalconCpp::HTuple z_normal_values;
+        if ((point_step == 16) && no_normals && no_color && no_intensity) {
+            return POINT_LAYOUT_XYZ;
+        }
+        if ((point_step == 32) && no_normals) {
+            if (isFloatAt(layout.intensity, 16) && no_color) return POINT_LAYOUT_XYZI;
+            if (isColorAt(layout.rgb, 16) && no_intensity) return POINT_LAYOUT_XYZRGB;
+        }
+        if ((point_step == 48) && normals && no_intensity) {
+            if (isFloatAt(layout.curvature, 32) && no_color) return POINT_LAYOUT_NORMAL;
+            if (isFloatAt(layout.curvature, 36) && isColorAt(layout.rgb, 32)) return POINT_LAYOUT_XYZRGB_NORMAL;
+        }
+        return POINT_LAYOUT_GENERIC;
+    }
 
+    // the color channels are stored in these attributes, so fields of the same name cannot be kept next to them
+    bool isReservedFieldName(const std::string& name) {
+        return (name == "red") || (name == "green") || (name == "blue");
+    }
 
-        float *interleavedPoints;
+    PointCloudLayoutCache::Layout getPointCloudLayout(const sensor_msgs::PointCloud2& source) {
+        FieldLocation missing = { false, 0, 0 };
+        PointCloudLayoutCache::Layout layout;
+        layout.x = layout.y = layout.z = missing;
+        layout.normal_x = layout.normal_y = layout.normal_z = missing;
+        layout.curvature = layout.rgb = layout.intensity = missing;
 
-        if (has_normals) {
-            x_normal_values = model->GetObjectModel3dParams("point_normal_x");
-            y_normal_values = model->GetObjectModel3dParams("point_normal_y");
-            z_normal_values = model->GetObjectModel3dParams("point_normal_z");
-            interleavedPoints = new float[ros_pointcloud.width * 7];
-        } else {
-            interleavedPoints = new float[ros_pointcloud.width * 3];
-        }
-
-        for (size_t i = 0; i < ros_pointcloud.width; i++) {
-            interleavedPoints[i * 3] = (float)x_values[i];
-            interleavedPoints[i * 3 + 1] = (float)y_values[i];
-            interleavedPoints[i * 3 + 2] = (float)z_values[i];
-            if (has_normals) {
-                interleavedPoints[i * 3 + 3] = (float)x_normal_values[i];
-                interleavedPoints[i * 3 + 4] = (float)y_normal_values[i];
-                interleavedPoints[i * 3 + 5] = (float)z_normal_values[i];
-                interleavedPoints[i * 3 + 6] = (float)(curvature)[i];
+        for (unsigned int i = 0; i < source.fields.size(); i++) {
+            const sensor_msgs::PointField *field = &source.fields[i];
+            if (field->count == 0) continue;
+            FieldLocation location = { true, field->offset, field->datatype };
+            if (field->name == "x") layout.x = location;
+            else if (field->name == "y") layout.y = location;
+            else if (field->name == "z") layout.z = location;
+            else if (field->name == "normal_x") layout.normal_x = location;
+            else if (field->name == "normal_y") layout.normal_y = location;
+            else if (field->name == "normal_z") layout.normal_z = location;
+            else if (field->name == "curvature") layout.curvature = location;
+            else if ((field->name == "rgb") || (field->name == "rgba")) layout.rgb = location;
+            else if (field->name == "intensity") layout.intensity = location;
+            else if ((field->count == 1) && (getSizeFromDatatype(field->datatype) > 0) && !field->name.empty() && (field->name[0] != '_') &&
+                     !isReservedFieldName(field->name) && (field->offset + getSizeFromDatatype(field->datatype) <= source.point_step)) {
+                // fields starting with '_' are padding written by PCL
+                layout.extra_fields.push_back(*field);
             }
         }
+        layout.point_layout = getPointLayout(layout, source.point_step);
+        return layout;
+    }
 
-        size_t size;
-        if (has_normals) {
-            size = ros_pointcloud.width * 7 * 4;
-        } else {
-            size = ros_pointcloud.width * 3 * 4;
+    bool haveSameFields(const std::vector<sensor_msgs::PointField>& a, const std::vector<sensor_msgs::PointField>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if ((a[i].offset != b[i].offset) || (a[i].datatype != b[i].datatype) || (a[i].count != b[i].count) || (a[i].name != b[i].name)) {
+                return false;
+            }
         }
-        ros_pointcloud.data.resize(size);
+        return true;
+    }
 
-        memcpy((float*)(&ros_pointcloud.data[0]), &interleavedPoints[0], size);
 
 
+    PointCloudLayoutCache::PointCloudLayoutCache() : point_step_(0) {
+    }
+
+    PointCloudLayoutCache::~PointCloudLayoutCache() {
+    }
+
+    boost::shared_ptr<const PointCloudLayoutCache::Layout> PointCloudLayoutCache::getLayout(const sensor_msgs::PointCloud2& source) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!layout_ || (source.point_step != point_step_) || !haveSameFields(source.fields, fields_)) {
+            layout_ = boost::make_shared<Layout>(getPointCloudLayout(source));
+            point_step_ = source.point_step;
+            fields_ = source.fields;
+        }
+        return layout_;
     }
 
 
 
-    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source) {
-         return toHalconCopy(*source);
+    void gatherGenericLayout(const PointCloudLayoutCache::Layout& layout, const uint8_t* points, size_t point_step, size_t count,
+                             float* x, float* y, float* z, const PointAttributes& attributes) {
+        bool float_xyz = (layout.x.datatype == sensor_msgs::PointField::FLOAT32) && (layout.y.datatype == sensor_msgs::PointField::FLOAT32) &&
+                (layout.z.datatype == sensor_msgs::PointField::FLOAT32);
+        if (float_xyz) {
+            gatherXYZ(points, point_step, count, layout.x.offset, layout.y.offset, layout.z.offset, x, y, z);
+        } else {
+            gatherField(points, point_step, count, layout.x.offset, layout.x.datatype, x);
+            gatherField(points, point_step, count, layout.y.offset, layout.y.datatype, y);
+            gatherField(points, point_step, count, layout.z.offset, layout.z.datatype, z);
+        }
+        if (attributes.normal_x) {
+            gatherField(points, point_step, count, layout.normal_x.offset, layout.normal_x.datatype, attributes.normal_x);
+            gatherField(points, point_step, count, layout.normal_y.offset, layout.normal_y.datatype, attributes.normal_y);
+            gatherField(points, point_step, count, layout.normal_z.offset, layout.normal_z.datatype, attributes.normal_z);
+        }
+        if (attributes.curvature) {
+            gatherField(points, point_step, count, layout.curvature.offset, layout.curvature.datatype, attributes.curvature);
+        }
+        if (attributes.red) {
+            unpackColors(points, point_step, count, layout.rgb.offset, attributes.red, attributes.green, attributes.blue);
+        }
+        if (attributes.intensity) {
+            gatherField(points, point_step, count, layout.intensity.offset, layout.intensity.datatype, attributes.intensity);
+        }
     }
 
-    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source) {
+    HalconPointcloudPtr convertPointcloud(const sensor_msgs::PointCloud2& source, const PointCloudLayoutCache::Layout& layout,
+                                          const PointcloudConversionOptions& options) {
+        HALCON_BRIDGE_STATS_SCOPE(POINTCLOUD_TO_HALCON);
         HalconPointcloudPtr ptr = boost::make_shared<HalconPointcloud>();
+        HALCON_BRIDGE_STATS_ALLOCATION();
         ptr->header = source.header;
 
-
-        int offset_x, offset_y, offset_z, offset_x_normal, offset_y_normal, offset_z_normal, offset_curvature;
-        offset_x = offset_y = offset_z = offset_x_normal = offset_y_normal = offset_z_normal = offset_curvature = 0;
-        int count_x_normal, count_y_normal, count_z_normal, count_curvature;
-        count_x_normal = count_y_normal = count_z_normal = count_curvature = 0;
-
-        for (unsigned int i = 0; i < source.fields.size(); i++) {
-            sensor_msgs::PointField field = source.fields[i];
-            if (field.name == "x") {
-                offset_x = field.offset;
-            }
-            if (field.name == "y") {
-                offset_y = field.offset;
+        if (!layout.x.present || !layout.y.present || !layout.z.present) {
+            throw Exception("Point cloud has no x, y and z fields");
+        }
+        size_t count = (size_t)source.width * source.height;
+        if (source.data.size() < count * source.point_step) {
+            throw Exception("Point cloud data does not match its width, height and point_step");
+        }
+        HALCON_BRIDGE_STATS_BYTES(count * source.point_step);
+        bool has_normals = layout.normal_x.present && layout.normal_y.present && layout.normal_z.present;
+        bool has_curvature = layout.curvature.present;
+        bool has_color = options.color && layout.rgb.present && (getSizeFromDatatype(layout.rgb.datatype) == 4);
+        bool has_intensity = options.intensity && layout.intensity.present;
+
+        const std::vector<sensor_msgs::PointField>& extra_fields = layout.extra_fields;
+
+        // gather every field into one contiguous block of arrays, the extended attributes are adjacent:
+        // x, y, z, [normal_x, normal_y, normal_z], [curvature], [red, green, blue], [intensity], [extra fields]
+        size_t curvature_index = has_normals ? 3 : 0;
+        size_t color_index = curvature_index + (has_curvature ? 1 : 0);
+        size_t intensity_index = color_index + (has_color ? 3 : 0);
+        size_t extra_index = intensity_index + (has_intensity ? 1 : 0);
+        size_t attribute_count = extra_index + extra_fields.size();
+        PooledBuffer values(pointcloudBufferPool(), count * (3 + attribute_count) * sizeof(float));
+        float *x_coords = (float*)values.data();
+        float *y_coords = x_coords + count;
+        float *z_coords = y_coords + count;
+        float *attributes = z_coords + count;
+
+        const uint8_t* src = source.data.empty() ? NULL : &source.data[0];
+        size_t point_step = source.point_step;
+
+        // organized clouds keep their grid and leave filtered points out of the domain, all others are compacted
+        bool voxel_grid = options.voxel_size > 0.0f;
+        bool keep_grid = (source.height > 1) && !voxel_grid;
+        PointFilter filter;
+        filter.finite = (options.remove_invalid || voxel_grid) && !source.is_dense;
+        filter.crop = options.crop;
+        filter.min[0] = options.crop_min_x;
+        filter.min[1] = options.crop_min_y;
+        filter.min[2] = options.crop_min_z;
+        filter.max[0] = options.crop_max_x;
+        filter.max[1] = options.crop_max_y;
+        filter.max[2] = options.crop_max_z;
+        bool compact = !keep_grid && (filter.finite || filter.crop);
+        std::mutex chunk_mutex;
+        // first point and number of kept points of every compacted chunk
+        std::vector<std::pair<size_t, size_t> > chunks;
+
+        parallelFor(count, count * point_step, [&](size_t begin, size_t end) {
+            const uint8_t* points = src + begin * point_step;
+            size_t n = end - begin;
+            float* normals = attributes + begin;
+            float* curvature = attributes + curvature_index * count + begin;
+            float* colors = attributes + color_index * count + begin;
+            float* intensity = attributes + intensity_index * count + begin;
+            PointAttributes destinations;
+            destinations.normal_x = has_normals ? normals : NULL;
+            destinations.normal_y = has_normals ? normals + count : NULL;
+            destinations.normal_z = has_normals ? normals + 2 * count : NULL;
+            destinations.curvature = has_curvature ? curvature : NULL;
+            destinations.red = has_color ? colors : NULL;
+            destinations.green = has_color ? colors + count : NULL;
+            destinations.blue = has_color ? colors + 2 * count : NULL;
+            destinations.intensity = has_intensity ? intensity : NULL;
+            if (layout.point_layout != POINT_LAYOUT_GENERIC) {
+                // offsets and point step are known at compile time, all fields are read in one pass
+                gatherFixedLayout(layout.point_layout, points, n, x_coords + begin, y_coords + begin, z_coords + begin, destinations);
+            } else {
+                gatherGenericLayout(layout, points, point_step, n, x_coords + begin, y_coords + begin, z_coords + begin, destinations);
             }
-            if (field.name == "z") {
-                offset_z = field.offset;
+            for (size_t i = 0; i < extra_fields.size(); i++) {
+                gatherField(points, point_step, n, extra_fields[i].offset, extra_fields[i].datatype,
+                            attributes + (extra_index + i) * count + begin);
             }
-            if (field.name == "normal_x") {
-                offset_x_normal = field.offset;
-                count_x_normal = field.count;
+
+            // filter the chunk while its values are still in the cache
+            if (keep_grid && filter.crop) {
+                invalidatePoints(x_coords + begin, y_coords + begin, z_coords + begin, n, filter);
+            } else if (compact) {
+                std::vector<float*> chunk_attributes(attribute_count);
+                for (size_t i = 0; i < attribute_count; i++) {
+                    chunk_attributes[i] = attributes + i * count + begin;
+                }
+                size_t kept = compactPoints(x_coords + begin, y_coords + begin, z_coords + begin,
+                                            chunk_attributes.empty() ? NULL : &chunk_attributes[0], attribute_count, n, filter);
+                std::lock_guard<std::mutex> lock(chunk_mutex);
+                chunks.push_back(std::make_pair(begin, kept));
             }
-            if (field.name == "normal_y") {
-                offset_y_normal = field.offset;
-                count_y_normal = field.count;
+        });
+
+        size_t point_count = count;
+        // distance between two of the arrays, the values of every array start at its front
+        size_t stride = count;
+        if (compact) {
+            // close the gaps the filter left between the chunks
+            std::sort(chunks.begin(), chunks.end());
+            point_count = 0;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                for (size_t j = 0; j < 3 + attribute_count; j++) {
+                    float* array = x_coords + j * count;
+                    memmove(array + point_count, array + chunks[i].first, chunks[i].second * sizeof(float));
+                }
+                point_count += chunks[i].second;
             }
-            if (field.name == "normal_z") {
-                offset_z_normal = field.offset;
-                count_z_normal = field.count;
+        }
+
+        std::vector<std::pair<uint64_t, uint32_t> > voxel_order;
+        size_t voxel_count = 0;
+        if (voxel_grid) {
+            voxel_count = sortVoxels(x_coords, y_coords, z_coords, point_count, options.voxel_size, voxel_order);
+            if ((voxel_count == 0) && (point_count > 0)) {
+                throw Exception("Voxel size is too small for the extent of the point cloud");
             }
-            if (field.name == "curvature") {
-                offset_curvature = field.offset;
-                count_curvature = field.count;
+        }
+        PooledBuffer centroids(pointcloudBufferPool(), voxel_count * (3 + attribute_count) * sizeof(float));
+        if (voxel_grid) {
+            std::vector<const float*> sources;
+            std::vector<float*> destinations;
+            for (size_t j = 0; j < 3 + attribute_count; j++) {
+                sources.push_back(x_coords + j * count);
+                destinations.push_back((float*)centroids.data() + j * voxel_count);
             }
-
+            averageVoxels(voxel_order, &sources[0], sources.size(), &destinations[0]);
+            x_coords = (float*)centroids.data();
+            y_coords = x_coords + voxel_count;
+            z_coords = y_coords + voxel_count;
+            attributes = z_coords + voxel_count;
+            point_count = stride = voxel_count;
         }
 
-        HalconCpp::HTuple x_coords = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-        HalconCpp::HTuple y_coords = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-        HalconCpp::HTuple z_coords = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-
-        HalconCpp::HTuple x_normals = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-        HalconCpp::HTuple y_normals = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-        HalconCpp::HTuple z_normals = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-
-        HalconCpp::HTuple curvature = HalconCpp::HTuple::TupleGenConst((int)(source.width * source.height), 0);
-
-        for (int i = 0; i < x_coords.Length(); i++) {
-            x_coords[i] = *(float*)&source.data[(i * source.point_step) + offset_x];
-            y_coords[i] = *(float*)&source.data[(i * source.point_step) + offset_y];
-            z_coords[i] = *(float*)&source.data[(i * source.point_step) + offset_z];
-
-            if ((count_x_normal > 0) && (count_y_normal > 0) && (count_z_normal > 0)) {
-                x_normals[i] = *(float*)&source.data[(i * source.point_step) + offset_x_normal];
-                y_normals[i] = *(float*)&source.data[(i * source.point_step) + offset_y_normal];
-                z_normals[i] = *(float*)&source.data[(i * source.point_step) + offset_z_normal];
+        if (keep_grid) {
+            // organized cloud: keep the sensor grid as X/Y/Z images, points with non-finite coordinates are
+            // left out of the domain and the model is created with an xyz mapping
+            HalconCpp::HRegion domain = getFiniteDomain(x_coords, y_coords, z_coords, source.width, source.height);
+            ptr->x_image.GenImage1("real", source.width, source.height, x_coords);
+            ptr->y_image.GenImage1("real", source.width, source.height, y_coords);
+            ptr->z_image.GenImage1("real", source.width, source.height, z_coords);
+            ptr->x_image = ptr->x_image.ReduceDomain(domain);
+            ptr->y_image = ptr->y_image.ReduceDomain(domain);
+            ptr->z_image = ptr->z_image.ReduceDomain(domain);
+            ptr->model = new HalconCpp::HObjectModel3D(ptr->x_image, ptr->y_image, ptr->z_image);
+            HALCON_BRIDGE_STATS_ALLOCATION();
+
+            // the model stores the points of the domain in row major order, compact the attributes accordingly
+            std::vector<float*> attribute_arrays;
+            for (size_t i = 0; i < attribute_count; i++) {
+                attribute_arrays.push_back(attributes + i * count);
+            }
+            point_count = compactFinitePoints(x_coords, y_coords, z_coords, count, attribute_arrays);
+            // move the compacted attributes next to each other for the bulk attribute calls below
+            for (size_t i = 1; i < attribute_count; i++) {
+                memmove(attributes + i * point_count, attributes + i * count, point_count * sizeof(float));
+            }
+        } else {
+            ptr->model = new HalconCpp::HObjectModel3D(HalconCpp::HTuple(x_coords, (Hlong)point_count),
+                                                       HalconCpp::HTuple(y_coords, (Hlong)point_count),
+                                                       HalconCpp::HTuple(z_coords, (Hlong)point_count));
+            HALCON_BRIDGE_STATS_ALLOCATION();
+            if (stride != point_count) {
+                // move the filtered attributes next to each other for the bulk attribute calls below
+                for (size_t i = 1; i < attribute_count; i++) {
+                    memmove(attributes + i * point_count, attributes + i * stride, point_count * sizeof(float));
+                }
             }
-
         }
-        ptr->model = new HalconCpp::HObjectModel3D(x_coords, y_coords, z_coords);
 
-        if (source.fields.size() > 4) {
+        if (has_normals) {
+
             HalconCpp::HTuple attrib_names("point_normal_x");
             attrib_names.Append("point_normal_y");
             attrib_names.Append("point_normal_z");
-            HalconCpp::HTuple attrib_values = (x_normals.TupleConcat(y_normals)).TupleConcat(z_normals);
-            HalconCpp::HObjectModel3D p_n_model = ptr->model->SetObjectModel3dAttrib(attrib_names, "", attrib_values);
-            *ptr->model = p_n_model;
+            ptr->model->SetObjectModel3dAttribMod(attrib_names, "", HalconCpp::HTuple(attributes, (Hlong)(3 * point_count)));
+        }
 
-            for (int i = 0; i < curvature.Length(); i++) {
-                curvature[i] = *(float*)&source.data[(i * source.point_step) + offset_curvature];
+        if (attribute_count > curvature_index) {
+            // all extended attributes are adjacent and set with a single call
+            HalconCpp::HTuple attrib_names;
+            if (has_curvature) {
+                attrib_names.Append("&curvature");
             }
-            ptr->curvature = curvature;
+            if (has_color) {
+                attrib_names.Append("&red");
+                attrib_names.Append("&green");
+                attrib_names.Append("&blue");
+            }
+            if (has_intensity) {
+                attrib_names.Append("&intensity");
+            }
+            for (size_t i = 0; i < extra_fields.size(); i++) {
+                attrib_names.Append(("&" + extra_fields[i].name).c_str());
+            }
+            ptr->model->SetObjectModel3dAttribMod(attrib_names, "points",
+                                                  HalconCpp::HTuple(attributes + curvature_index * point_count,
+                                                                    (Hlong)((attribute_count - curvature_index) * point_count)));
         }
 
         return ptr;
     }
 
-}
 
 
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source, const PointcloudConversionOptions& options) {
+         return toHalconCopy(*source, options);
+    }
+
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source, const PointcloudConversionOptions& options) {
+        return convertPointcloud(source, getPointCloudLayout(source), options);
+    }
+
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2ConstPtr& source, PointCloudLayoutCache& layout_cache,
+                                     const PointcloudConversionOptions& options) {
+        return toHalconCopy(*source, layout_cache, options);
+    }
+
+    HalconPointcloudPtr toHalconCopy(const sensor_msgs::PointCloud2& source, PointCloudLayoutCache& layout_cache,
+                                     const PointcloudConversionOptions& options) {
+        return convertPointcloud(source, *layout_cache.getLayout(source), options);
+    }
+
+
+
+    LazyHalconPointcloud::LazyHalconPointcloud(const sensor_msgs::PointCloud2ConstPtr& source) :
+            header(source->header), width(source->width), height(source->height), source_(source) {
+    }
+
+    HalconPointcloudConstPtr LazyHalconPointcloud::getHalconPointcloud() const {
+        std::call_once(converted_flag_, [this]() {
+            HalconPointcloudConstPtr converted = toHalconCopy(*source_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            converted_ = converted;
+        });
+        return converted_;
+    }
+
+    const HalconCpp::HObjectModel3D& LazyHalconPointcloud::getModel() const {
+        return *getHalconPointcloud()->model;
+    }
+
+    bool LazyHalconPointcloud::isConverted() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (bool)converted_;
+    }
+
+    LazyHalconPointcloudConstPtr toHalconLazy(const sensor_msgs::PointCloud2ConstPtr& source) {
+        return boost::make_shared<LazyHalconPointcloud>(source);
+    }
 
+}
@@ -0,0 +1,633 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "image_kernels.h"
+#include "kernel_dispatch.h"
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALCON_BRIDGE_X86_DISPATCH
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HALCON_BRIDGE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace halcon_bridge {
+
+    namespace {
+
+        template<typename T>
+        void interleaveScalar(const T* plane0, const T* plane1, const T* plane2, const T* plane3, T fill,
+                              T* dst, size_t begin, size_t count, int dst_channels) {
+            if (dst_channels == 3) {
+                for (size_t i = begin; i < count; i++) {
+                    dst[i * 3] = plane0[i];
+                    dst[i * 3 + 1] = plane1[i];
+                    dst[i * 3 + 2] = plane2[i];
+                }
+            } else if (plane3) {
+                for (size_t i = begin; i < count; i++) {
+                    dst[i * 4] = plane0[i];
+                    dst[i * 4 + 1] = plane1[i];
+                    dst[i * 4 + 2] = plane2[i];
+                    dst[i * 4 + 3] = plane3[i];
+                }
+            } else {
+                for (size_t i = begin; i < count; i++) {
+                    dst[i * 4] = plane0[i];
+                    dst[i * 4 + 1] = plane1[i];
+                    dst[i * 4 + 2] = plane2[i];
+                    dst[i * 4 + 3] = fill;
+                }
+            }
+        }
+
+        void deinterleaveScalar8(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2,
+                                 size_t begin, size_t count, int src_channels) {
+            for (size_t i = begin; i < count; i++) {
+                const uint8_t* pixel = src + i * src_channels;
+                plane0[i] = pixel[0];
+                plane1[i] = pixel[1];
+                plane2[i] = pixel[2];
+            }
+        }
+
+        template<bool Swap>
+        inline uint16_t load16(const uint8_t* src) {
+            uint16_t value;
+            memcpy(&value, src, sizeof(value));
+            return Swap ? (uint16_t)((value << 8) | (value >> 8)) : value;
+        }
+
+        template<bool Swap>
+        void deinterleaveScalar16(const uint8_t* src, uint16_t* plane0, uint16_t* plane1, uint16_t* plane2,
+                                  size_t count, int src_channels) {
+            const size_t pixel_size = src_channels * sizeof(uint16_t);
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t* pixel = src + i * pixel_size;
+                plane0[i] = load16<Swap>(pixel);
+                plane1[i] = load16<Swap>(pixel + 2);
+                plane2[i] = load16<Swap>(pixel + 4);
+            }
+        }
+
+        template<typename T, bool Swap>
+        void decimateScalar(const uint8_t* src, T* plane0, T* plane1, T* plane2, size_t count, int src_channels, size_t column_stride) {
+            const size_t pixel_size = src_channels * sizeof(T);
+            const size_t step = column_stride * pixel_size;
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t* pixel = src + i * step;
+                if (sizeof(T) == 1) {
+                    plane0[i] = pixel[0];
+                    if (src_channels > 1) {
+                        plane1[i] = pixel[1];
+                        plane2[i] = pixel[2];
+                    }
+                } else {
+                    plane0[i] = load16<Swap>(pixel);
+                    if (src_channels > 1) {
+                        plane1[i] = load16<Swap>(pixel + 2);
+                        plane2[i] = load16<Swap>(pixel + 4);
+                    }
+                }
+            }
+        }
+
+        template<typename T>
+        void downsampleScalar(const T* row0, const T* row1, T* dst, size_t begin, size_t dst_width) {
+            for (size_t i = begin; i < dst_width; i++) {
+                uint32_t sum = (uint32_t)row0[2 * i] + row0[2 * i + 1] + row1[2 * i] + row1[2 * i + 1];
+                dst[i] = (T)((sum + 2) >> 2);
+            }
+        }
+
+        // Bilinear demosaic of one row. In every row of a Bayer pattern the non-green pixels have the same color,
+        // called x here, and the non-green pixels of the rows above and below have the other color, called y.
+        // Columns outside the image are mirrored, so the pattern phase is kept at the borders.
+        template<typename T, bool Swap>
+        struct BayerRow {
+            const uint8_t* above;
+            const uint8_t* row;
+            const uint8_t* below;
+            size_t width;
+
+            T at(const uint8_t* src, size_t column) const {
+                if (sizeof(T) == 1) return src[column];
+                return load16<Swap>(src + column * 2);
+            }
+
+            void demosaic(size_t column, bool x_at_odd, T& x, T& green, T& y) const {
+                size_t left = (column > 0) ? column - 1 : column + 1;
+                size_t right = (column + 1 < width) ? column + 1 : column - 1;
+                uint32_t center = at(row, column);
+                uint32_t up = at(above, column);
+                uint32_t down = at(below, column);
+                uint32_t horizontal = (uint32_t)at(row, left) + at(row, right);
+                if ((column & 1) == (size_t)x_at_odd) {
+                    uint32_t diagonal = (uint32_t)at(above, left) + at(above, right) + at(below, left) + at(below, right);
+                    x = (T)center;
+                    green = (T)((horizontal + up + down + 2) >> 2);
+                    y = (T)((diagonal + 2) >> 2);
+                } else {
+                    x = (T)((horizontal + 1) >> 1);
+                    green = (T)center;
+                    y = (T)((up + down + 1) >> 1);
+                }
+            }
+        };
+
+        template<typename T, bool Swap>
+        void demosaicScalar(const BayerRow<T, Swap>& bayer, size_t begin, size_t first, size_t last, bool x_at_odd,
+                            T* x, T* green, T* y) {
+            for (size_t column = first; column < last; column++) {
+                size_t i = column - begin;
+                bayer.demosaic(column, x_at_odd, x[i], green[i], y[i]);
+            }
+        }
+
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+
+        // Each output vector of a packed 3-channel row takes bytes from all three planes, the shuffle masks
+        // place them at their interleaved position and zero everything else.
+        __attribute__((target("ssse3")))
+        size_t interleave3x8Ssse3(const uint8_t* plane0, const uint8_t* plane1, const uint8_t* plane2, uint8_t* dst, size_t count) {
+            const __m128i m00 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+            const __m128i m10 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+            const __m128i m20 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+            const __m128i m01 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+            const __m128i m11 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+            const __m128i m21 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+            const __m128i m02 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+            const __m128i m12 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+            const __m128i m22 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i c0 = _mm_loadu_si128((const __m128i*)(plane0 + i));
+                __m128i c1 = _mm_loadu_si128((const __m128i*)(plane1 + i));
+                __m128i c2 = _mm_loadu_si128((const __m128i*)(plane2 + i));
+                __m128i *out = (__m128i*)(dst + i * 3);
+                _mm_storeu_si128(out, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(c1, m10)), _mm_shuffle_epi8(c2, m20)));
+                _mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m01), _mm_shuffle_epi8(c1, m11)), _mm_shuffle_epi8(c2, m21)));
+                _mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m02), _mm_shuffle_epi8(c1, m12)), _mm_shuffle_epi8(c2, m22)));
+            }
+            return i;
+        }
+
+        __attribute__((target("ssse3")))
+        size_t interleave3x16Ssse3(const uint16_t* plane0, const uint16_t* plane1, const uint16_t* plane2, uint16_t* dst, size_t count) {
+            const __m128i m00 = _mm_setr_epi8(0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, 4, 5, -1, -1);
+            const __m128i m10 = _mm_setr_epi8(-1, -1, 0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, 4, 5);
+            const __m128i m20 = _mm_setr_epi8(-1, -1, -1, -1, 0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1);
+            const __m128i m01 = _mm_setr_epi8(-1, -1, 6, 7, -1, -1, -1, -1, 8, 9, -1, -1, -1, -1, 10, 11);
+            const __m128i m11 = _mm_setr_epi8(-1, -1, -1, -1, 6, 7, -1, -1, -1, -1, 8, 9, -1, -1, -1, -1);
+            const __m128i m21 = _mm_setr_epi8(4, 5, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1, 8, 9, -1, -1);
+            const __m128i m02 = _mm_setr_epi8(-1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15, -1, -1, -1, -1);
+            const __m128i m12 = _mm_setr_epi8(10, 11, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15, -1, -1);
+            const __m128i m22 = _mm_setr_epi8(-1, -1, 10, 11, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i c0 = _mm_loadu_si128((const __m128i*)(plane0 + i));
+                __m128i c1 = _mm_loadu_si128((const __m128i*)(plane1 + i));
+                __m128i c2 = _mm_loadu_si128((const __m128i*)(plane2 + i));
+                __m128i *out = (__m128i*)(dst + i * 3);
+                _mm_storeu_si128(out, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(c1, m10)), _mm_shuffle_epi8(c2, m20)));
+                _mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m01), _mm_shuffle_epi8(c1, m11)), _mm_shuffle_epi8(c2, m21)));
+                _mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m02), _mm_shuffle_epi8(c1, m12)), _mm_shuffle_epi8(c2, m22)));
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        size_t interleave4x8Sse2(const uint8_t* plane0, const uint8_t* plane1, const uint8_t* plane2, const uint8_t* plane3, uint8_t* dst, size_t count) {
+            const __m128i opaque = _mm_set1_epi8((char)0xff);
+
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i c0 = _mm_loadu_si128((const __m128i*)(plane0 + i));
+                __m128i c1 = _mm_loadu_si128((const __m128i*)(plane1 + i));
+                __m128i c2 = _mm_loadu_si128((const __m128i*)(plane2 + i));
+                __m128i c3 = plane3 ? _mm_loadu_si128((const __m128i*)(plane3 + i)) : opaque;
+                __m128i lo01 = _mm_unpacklo_epi8(c0, c1);
+                __m128i hi01 = _mm_unpackhi_epi8(c0, c1);
+                __m128i lo23 = _mm_unpacklo_epi8(c2, c3);
+                __m128i hi23 = _mm_unpackhi_epi8(c2, c3);
+                __m128i *out = (__m128i*)(dst + i * 4);
+                _mm_storeu_si128(out, _mm_unpacklo_epi16(lo01, lo23));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo01, lo23));
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi01, hi23));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi01, hi23));
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        size_t interleave4x16Sse2(const uint16_t* plane0, const uint16_t* plane1, const uint16_t* plane2, const uint16_t* plane3, uint16_t* dst, size_t count) {
+            const __m128i opaque = _mm_set1_epi16((short)0xffff);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i c0 = _mm_loadu_si128((const __m128i*)(plane0 + i));
+                __m128i c1 = _mm_loadu_si128((const __m128i*)(plane1 + i));
+                __m128i c2 = _mm_loadu_si128((const __m128i*)(plane2 + i));
+                __m128i c3 = plane3 ? _mm_loadu_si128((const __m128i*)(plane3 + i)) : opaque;
+                __m128i lo01 = _mm_unpacklo_epi16(c0, c1);
+                __m128i hi01 = _mm_unpackhi_epi16(c0, c1);
+                __m128i lo23 = _mm_unpacklo_epi16(c2, c3);
+                __m128i hi23 = _mm_unpackhi_epi16(c2, c3);
+                __m128i *out = (__m128i*)(dst + i * 4);
+                _mm_storeu_si128(out, _mm_unpacklo_epi32(lo01, lo23));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(lo01, lo23));
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi32(hi01, hi23));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi32(hi01, hi23));
+            }
+            return i;
+        }
+
+        // Inverse of interleave3x8Ssse3: every plane collects its bytes from all three input vectors.
+        __attribute__((target("ssse3")))
+        size_t deinterleave3x8Ssse3(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2, size_t count) {
+            const __m128i m00 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const __m128i m01 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+            const __m128i m02 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+            const __m128i m10 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const __m128i m11 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+            const __m128i m12 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+            const __m128i m20 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const __m128i m21 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+            const __m128i m22 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                const __m128i *in = (const __m128i*)(src + i * 3);
+                __m128i v0 = _mm_loadu_si128(in);
+                __m128i v1 = _mm_loadu_si128(in + 1);
+                __m128i v2 = _mm_loadu_si128(in + 2);
+                _mm_storeu_si128((__m128i*)(plane0 + i), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m00), _mm_shuffle_epi8(v1, m01)), _mm_shuffle_epi8(v2, m02)));
+                _mm_storeu_si128((__m128i*)(plane1 + i), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m10), _mm_shuffle_epi8(v1, m11)), _mm_shuffle_epi8(v2, m12)));
+                _mm_storeu_si128((__m128i*)(plane2 + i), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, m20), _mm_shuffle_epi8(v1, m21)), _mm_shuffle_epi8(v2, m22)));
+            }
+            return i;
+        }
+
+        // Groups the channels of four pixels per vector, then transposes the 4x4 block of 32 bit groups.
+        __attribute__((target("ssse3")))
+        size_t deinterleave4x8Ssse3(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2, size_t count) {
+            const __m128i group = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16) {
+                const __m128i *in = (const __m128i*)(src + i * 4);
+                __m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128(in), group);
+                __m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), group);
+                __m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), group);
+                __m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), group);
+                __m128i lo01 = _mm_unpacklo_epi32(t0, t1);
+                __m128i lo23 = _mm_unpacklo_epi32(t2, t3);
+                __m128i hi01 = _mm_unpackhi_epi32(t0, t1);
+                __m128i hi23 = _mm_unpackhi_epi32(t2, t3);
+                _mm_storeu_si128((__m128i*)(plane0 + i), _mm_unpacklo_epi64(lo01, lo23));
+                _mm_storeu_si128((__m128i*)(plane1 + i), _mm_unpackhi_epi64(lo01, lo23));
+                _mm_storeu_si128((__m128i*)(plane2 + i), _mm_unpacklo_epi64(hi01, hi23));
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        size_t swapBytes16Sse2(const uint8_t* src, uint16_t* dst, size_t count) {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i values = _mm_loadu_si128((const __m128i*)(src + i * 2));
+                _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8)));
+            }
+            return i;
+        }
+
+        // Splits 16 pixels of both rows into the even and odd ones widened to 16 bit, so the four values of
+        // every 2x2 block can be added up without overflow.
+        __attribute__((target("sse2")))
+        size_t downsample8Sse2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dst_width) {
+            const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+            const __m128i rounding = _mm_set1_epi16(2);
+            size_t i = 0;
+            for (; i + 8 <= dst_width; i += 8) {
+                __m128i a = _mm_loadu_si128((const __m128i*)(row0 + 2 * i));
+                __m128i b = _mm_loadu_si128((const __m128i*)(row1 + 2 * i));
+                __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, low_bytes), _mm_srli_epi16(a, 8)),
+                                            _mm_add_epi16(_mm_and_si128(b, low_bytes), _mm_srli_epi16(b, 8)));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+                _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(sum, sum));
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        inline __m128i average4Sse2(__m128i a, __m128i b, __m128i c, __m128i d) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                                        _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+            __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                                         _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+            low = _mm_srli_epi16(_mm_add_epi16(low, rounding), 2);
+            high = _mm_srli_epi16(_mm_add_epi16(high, rounding), 2);
+            return _mm_packus_epi16(low, high);
+        }
+
+        // Computes both interpolation cases for 16 pixels and selects the right one per column parity.
+        // first must be even and at least 1, so the lanes keep the parity of their columns.
+        __attribute__((target("sse2")))
+        size_t demosaic8Sse2(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                             size_t begin, size_t first, size_t last, bool x_at_odd, uint8_t* x, uint8_t* green, uint8_t* y) {
+            const __m128i x_lanes = x_at_odd ? _mm_set1_epi16((short)0xff00) : _mm_set1_epi16(0x00ff);
+            size_t column = first;
+            for (; (column + 17 <= width) && (column + 16 <= last); column += 16) {
+                __m128i center = _mm_loadu_si128((const __m128i*)(row + column));
+                __m128i left = _mm_loadu_si128((const __m128i*)(row + column - 1));
+                __m128i right = _mm_loadu_si128((const __m128i*)(row + column + 1));
+                __m128i up = _mm_loadu_si128((const __m128i*)(above + column));
+                __m128i down = _mm_loadu_si128((const __m128i*)(below + column));
+                __m128i up_left = _mm_loadu_si128((const __m128i*)(above + column - 1));
+                __m128i up_right = _mm_loadu_si128((const __m128i*)(above + column + 1));
+                __m128i down_left = _mm_loadu_si128((const __m128i*)(below + column - 1));
+                __m128i down_right = _mm_loadu_si128((const __m128i*)(below + column + 1));
+
+                __m128i horizontal = _mm_avg_epu8(left, right);
+                __m128i vertical = _mm_avg_epu8(up, down);
+                __m128i cross = average4Sse2(left, right, up, down);
+                __m128i diagonal = average4Sse2(up_left, up_right, down_left, down_right);
+
+                size_t i = column - begin;
+                _mm_storeu_si128((__m128i*)(x + i), _mm_or_si128(_mm_and_si128(x_lanes, center), _mm_andnot_si128(x_lanes, horizontal)));
+                _mm_storeu_si128((__m128i*)(green + i), _mm_or_si128(_mm_and_si128(x_lanes, cross), _mm_andnot_si128(x_lanes, center)));
+                _mm_storeu_si128((__m128i*)(y + i), _mm_or_si128(_mm_and_si128(x_lanes, diagonal), _mm_andnot_si128(x_lanes, vertical)));
+            }
+            return column;
+        }
+
+#elif defined(HALCON_BRIDGE_NEON)
+
+        size_t swapBytes16Neon(const uint8_t* src, uint16_t* dst, size_t count) {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                vst1q_u8((uint8_t*)(dst + i), vrev16q_u8(vld1q_u8(src + i * 2)));
+            }
+            return i;
+        }
+
+        size_t deinterleave8Neon(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2, size_t count, int src_channels) {
+            size_t i = 0;
+            if (src_channels == 3) {
+                for (; i + 16 <= count; i += 16) {
+                    uint8x16x3_t pixels = vld3q_u8(src + i * 3);
+                    vst1q_u8(plane0 + i, pixels.val[0]);
+                    vst1q_u8(plane1 + i, pixels.val[1]);
+                    vst1q_u8(plane2 + i, pixels.val[2]);
+                }
+            } else {
+                for (; i + 16 <= count; i += 16) {
+                    uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+                    vst1q_u8(plane0 + i, pixels.val[0]);
+                    vst1q_u8(plane1 + i, pixels.val[1]);
+                    vst1q_u8(plane2 + i, pixels.val[2]);
+                }
+            }
+            return i;
+        }
+
+        size_t interleave8Neon(const uint8_t* plane0, const uint8_t* plane1, const uint8_t* plane2, const uint8_t* plane3, uint8_t* dst, size_t count, int dst_channels) {
+            size_t i = 0;
+            if (dst_channels == 3) {
+                for (; i + 16 <= count; i += 16) {
+                    uint8x16x3_t pixels;
+                    pixels.val[0] = vld1q_u8(plane0 + i);
+                    pixels.val[1] = vld1q_u8(plane1 + i);
+                    pixels.val[2] = vld1q_u8(plane2 + i);
+                    vst3q_u8(dst + i * 3, pixels);
+                }
+            } else {
+                const uint8x16_t opaque = vdupq_n_u8(0xff);
+                for (; i + 16 <= count; i += 16) {
+                    uint8x16x4_t pixels;
+                    pixels.val[0] = vld1q_u8(plane0 + i);
+                    pixels.val[1] = vld1q_u8(plane1 + i);
+                    pixels.val[2] = vld1q_u8(plane2 + i);
+                    pixels.val[3] = plane3 ? vld1q_u8(plane3 + i) : opaque;
+                    vst4q_u8(dst + i * 4, pixels);
+                }
+            }
+            return i;
+        }
+
+        size_t interleave16Neon(const uint16_t* plane0, const uint16_t* plane1, const uint16_t* plane2, const uint16_t* plane3, uint16_t* dst, size_t count, int dst_channels) {
+            size_t i = 0;
+            if (dst_channels == 3) {
+                for (; i + 8 <= count; i += 8) {
+                    uint16x8x3_t pixels;
+                    pixels.val[0] = vld1q_u16(plane0 + i);
+                    pixels.val[1] = vld1q_u16(plane1 + i);
+                    pixels.val[2] = vld1q_u16(plane2 + i);
+                    vst3q_u16(dst + i * 3, pixels);
+                }
+            } else {
+                const uint16x8_t opaque = vdupq_n_u16(0xffff);
+                for (; i + 8 <= count; i += 8) {
+                    uint16x8x4_t pixels;
+                    pixels.val[0] = vld1q_u16(plane0 + i);
+                    pixels.val[1] = vld1q_u16(plane1 + i);
+                    pixels.val[2] = vld1q_u16(plane2 + i);
+                    pixels.val[3] = plane3 ? vld1q_u16(plane3 + i) : opaque;
+                    vst4q_u16(dst + i * 4, pixels);
+                }
+            }
+            return i;
+        }
+
+        size_t downsample8Neon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dst_width) {
+            size_t i = 0;
+            for (; i + 8 <= dst_width; i += 8) {
+                uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * i)), vpaddlq_u8(vld1q_u8(row1 + 2 * i)));
+                vst1_u8(dst + i, vrshrn_n_u16(sum, 2));
+            }
+            return i;
+        }
+
+        inline uint8x16_t average4Neon(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+            uint16x8_t low = vaddq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), vaddl_u8(vget_low_u8(c), vget_low_u8(d)));
+            uint16x8_t high = vaddq_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), vaddl_u8(vget_high_u8(c), vget_high_u8(d)));
+            return vcombine_u8(vrshrn_n_u16(low, 2), vrshrn_n_u16(high, 2));
+        }
+
+        size_t demosaic8Neon(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                             size_t begin, size_t first, size_t last, bool x_at_odd, uint8_t* x, uint8_t* green, uint8_t* y) {
+            const uint8x16_t x_lanes = vreinterpretq_u8_u16(vdupq_n_u16(x_at_odd ? 0xff00 : 0x00ff));
+            size_t column = first;
+            for (; (column + 17 <= width) && (column + 16 <= last); column += 16) {
+                uint8x16_t center = vld1q_u8(row + column);
+                uint8x16_t left = vld1q_u8(row + column - 1);
+                uint8x16_t right = vld1q_u8(row + column + 1);
+                uint8x16_t up = vld1q_u8(above + column);
+                uint8x16_t down = vld1q_u8(below + column);
+
+                uint8x16_t horizontal = vrhaddq_u8(left, right);
+                uint8x16_t vertical = vrhaddq_u8(up, down);
+                uint8x16_t cross = average4Neon(left, right, up, down);
+                uint8x16_t diagonal = average4Neon(vld1q_u8(above + column - 1), vld1q_u8(above + column + 1),
+                                                   vld1q_u8(below + column - 1), vld1q_u8(below + column + 1));
+
+                size_t i = column - begin;
+                vst1q_u8(x + i, vbslq_u8(x_lanes, center, horizontal));
+                vst1q_u8(green + i, vbslq_u8(x_lanes, cross, center));
+                vst1q_u8(y + i, vbslq_u8(x_lanes, diagonal, vertical));
+            }
+            return column;
+        }
+
+#endif
+
+    }
+
+
+
+    void interleavePlanes8(const uint8_t* plane0, const uint8_t* plane1, const uint8_t* plane2, const uint8_t* plane3,
+                           uint8_t* dst, size_t count, int dst_channels) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (dst_channels == 3) {
+            if (kernelVariantEnabled(KERNEL_VARIANT_SSSE3)) done = interleave3x8Ssse3(plane0, plane1, plane2, dst, count);
+        } else if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) {
+            done = interleave4x8Sse2(plane0, plane1, plane2, plane3, dst, count);
+        }
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = interleave8Neon(plane0, plane1, plane2, plane3, dst, count, dst_channels);
+#endif
+        interleaveScalar<uint8_t>(plane0, plane1, plane2, plane3, 0xff, dst, done, count, dst_channels);
+    }
+
+    void interleavePlanes16(const uint16_t* plane0, const uint16_t* plane1, const uint16_t* plane2, const uint16_t* plane3,
+                            uint16_t* dst, size_t count, int dst_channels) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (dst_channels == 3) {
+            if (kernelVariantEnabled(KERNEL_VARIANT_SSSE3)) done = interleave3x16Ssse3(plane0, plane1, plane2, dst, count);
+        } else if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) {
+            done = interleave4x16Sse2(plane0, plane1, plane2, plane3, dst, count);
+        }
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = interleave16Neon(plane0, plane1, plane2, plane3, dst, count, dst_channels);
+#endif
+        interleaveScalar<uint16_t>(plane0, plane1, plane2, plane3, 0xffff, dst, done, count, dst_channels);
+    }
+
+    void deinterleavePixels8(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2,
+                             size_t count, int src_channels) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSSE3)) {
+            if (src_channels == 3) {
+                done = deinterleave3x8Ssse3(src, plane0, plane1, plane2, count);
+            } else {
+                done = deinterleave4x8Ssse3(src, plane0, plane1, plane2, count);
+            }
+        }
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = deinterleave8Neon(src, plane0, plane1, plane2, count, src_channels);
+#endif
+        deinterleaveScalar8(src, plane0, plane1, plane2, done, count, src_channels);
+    }
+
+    void swapBytes16(const uint8_t* src, uint16_t* dst, size_t count) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) done = swapBytes16Sse2(src, dst, count);
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = swapBytes16Neon(src, dst, count);
+#endif
+        for (size_t i = done; i < count; i++) {
+            dst[i] = load16<true>(src + i * 2);
+        }
+    }
+
+    void deinterleavePixels16(const uint8_t* src, uint16_t* plane0, uint16_t* plane1, uint16_t* plane2,
+                              size_t count, int src_channels, bool swap_bytes) {
+        if (swap_bytes) {
+            deinterleaveScalar16<true>(src, plane0, plane1, plane2, count, src_channels);
+        } else {
+            deinterleaveScalar16<false>(src, plane0, plane1, plane2, count, src_channels);
+        }
+    }
+
+    void decimatePixels8(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2,
+                         size_t count, int src_channels, size_t column_stride) {
+        decimateScalar<uint8_t, false>(src, plane0, plane1, plane2, count, src_channels, column_stride);
+    }
+
+    void decimatePixels16(const uint8_t* src, uint16_t* plane0, uint16_t* plane1, uint16_t* plane2,
+                          size_t count, int src_channels, size_t column_stride, bool swap_bytes) {
+        if (swap_bytes) {
+            decimateScalar<uint16_t, true>(src, plane0, plane1, plane2, count, src_channels, column_stride);
+        } else {
+            decimateScalar<uint16_t, false>(src, plane0, plane1, plane2, count, src_channels, column_stride);
+        }
+    }
+
+    void downsampleRows8(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dst_width) {
+        size_t done = 0;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) done = downsample8Sse2(row0, row1, dst, dst_width);
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = downsample8Neon(row0, row1, dst, dst_width);
+#endif
+        downsampleScalar<uint8_t>(row0, row1, dst, done, dst_width);
+    }
+
+    void downsampleRows16(const uint16_t* row0, const uint16_t* row1, uint16_t* dst, size_t dst_width) {
+        downsampleScalar<uint16_t>(row0, row1, dst, 0, dst_width);
+    }
+
+    void demosaicRow8(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                      size_t begin, size_t count, bool x_at_odd, uint8_t* x, uint8_t* green, uint8_t* y) {
+        BayerRow<uint8_t, false> bayer = {above, row, below, width};
+        size_t last = begin + count;
+        // the first column needs its mirrored left neighbour, the vector loop starts at an even column after it
+        size_t first = std::min(std::max<size_t>((begin + 1) & ~(size_t)1, 2), last);
+        demosaicScalar(bayer, begin, begin, first, x_at_odd, x, green, y);
+        size_t done = first;
+#if defined(HALCON_BRIDGE_X86_DISPATCH)
+        if (kernelVariantEnabled(KERNEL_VARIANT_SSE2)) done = demosaic8Sse2(above, row, below, width, begin, first, last, x_at_odd, x, green, y);
+#elif defined(HALCON_BRIDGE_NEON)
+        if (kernelVariantEnabled(KERNEL_VARIANT_NEON)) done = demosaic8Neon(above, row, below, width, begin, first, last, x_at_odd, x, green, y);
+#endif
+        demosaicScalar(bayer, begin, done, last, x_at_odd, x, green, y);
+    }
+
+    void demosaicRow16(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                       size_t begin, size_t count, bool x_at_odd, bool swap_bytes, uint16_t* x, uint16_t* green, uint16_t* y) {
+        if (swap_bytes) {
+            BayerRow<uint16_t, true> bayer = {above, row, below, width};
+            demosaicScalar(bayer, begin, begin, begin + count, x_at_odd, x, green, y);
+        } else {
+            BayerRow<uint16_t, false> bayer = {above, row, below, width};
+            demosaicScalar(bayer, begin, begin, begin + count, x_at_odd, x, green, y);
+        }
+    }
+
+}
@@ -0,0 +1,148 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_IMAGE_KERNELS_H
+#define ASR_HALCON_BRIDGE_IMAGE_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Interleave planar 8 bit channels into packed pixels.
+     *
+     * The planes are given in the order in which they appear in the packed pixel. If dst_channels is 4 and
+     * plane3 is NULL, the fourth channel is filled with 0xff.
+     *
+     * \param plane0        First channel of every pixel
+     * \param plane1        Second channel of every pixel
+     * \param plane2        Third channel of every pixel
+     * \param plane3        Fourth channel of every pixel, may be NULL
+     * \param dst           Destination buffer with room for count * dst_channels bytes
+     * \param count         Number of pixels
+     * \param dst_channels  Number of channels of a packed pixel, either 3 or 4
+     */
+    void interleavePlanes8(const uint8_t* plane0, const uint8_t* plane1, const uint8_t* plane2, const uint8_t* plane3,
+                           uint8_t* dst, size_t count, int dst_channels);
+
+    /**
+     * \brief Interleave planar 16 bit channels into packed pixels.
+     *
+     * Same as interleavePlanes8, a missing fourth channel is filled with 0xffff.
+     */
+    void interleavePlanes16(const uint16_t* plane0, const uint16_t* plane1, const uint16_t* plane2, const uint16_t* plane3,
+                            uint16_t* dst, size_t count, int dst_channels);
+
+    /**
+     * \brief Copy 16 bit values from a possibly unaligned buffer, swapping the byte order of every value.
+     */
+    void swapBytes16(const uint8_t* src, uint16_t* dst, size_t count);
+
+    /**
+     * \brief Split packed 8 bit pixels into planar channels in a single pass.
+     *
+     * Only the first three channels of a pixel are kept, a fourth (alpha) channel is skipped.
+     *
+     * \param src           Packed pixels
+     * \param count         Number of pixels
+     * \param src_channels  Number of channels of a packed pixel, either 3 or 4
+     */
+    void deinterleavePixels8(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2,
+                             size_t count, int src_channels);
+
+    /**
+     * \brief Split packed 16 bit pixels into planar channels in a single pass.
+     *
+     * Only the first three channels of a pixel are kept, a fourth (alpha) channel is skipped.
+     *
+     * \param src           Packed pixels, does not need to be aligned
+     * \param count         Number of pixels
+     * \param src_channels  Number of channels of a packed pixel, either 3 or 4
+     * \param swap_bytes    Swap the byte order of every value while copying
+     */
+    void deinterleavePixels16(const uint8_t* src, uint16_t* plane0, uint16_t* plane1, uint16_t* plane2,
+                              size_t count, int src_channels, bool swap_bytes);
+
+    /**
+     * \brief Split every column_stride-th packed 8 bit pixel into planar channels.
+     *
+     * \param src             Packed pixels
+     * \param plane1          Second channel, not used if src_channels is 1
+     * \param plane2          Third channel, not used if src_channels is 1
+     * \param count           Number of pixels written to every plane
+     * \param src_channels    Number of channels of a packed pixel, 1, 3 or 4
+     * \param column_stride   Distance between two pixels that are kept
+     */
+    void decimatePixels8(const uint8_t* src, uint8_t* plane0, uint8_t* plane1, uint8_t* plane2,
+                         size_t count, int src_channels, size_t column_stride);
+
+    /**
+     * \brief Split every column_stride-th packed 16 bit pixel into planar channels.
+     *
+     * Same as decimatePixels8, the source does not need to be aligned.
+     *
+     * \param swap_bytes      Swap the byte order of every value while copying
+     */
+    void decimatePixels16(const uint8_t* src, uint16_t* plane0, uint16_t* plane1, uint16_t* plane2,
+                          size_t count, int src_channels, size_t column_stride, bool swap_bytes);
+
+    /**
+     * \brief Average the 2x2 blocks of two 8 bit rows into one row of half the width, rounding to nearest.
+     *
+     * \param dst_width   Number of pixels written, the rows contain at least twice as many
+     */
+    void downsampleRows8(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, size_t dst_width);
+
+    /**
+     * \brief Average the 2x2 blocks of two 16 bit rows into one row of half the width, rounding to nearest.
+     */
+    void downsampleRows16(const uint16_t* row0, const uint16_t* row1, uint16_t* dst, size_t dst_width);
+
+    /**
+     * \brief Bilinear demosaic of one row of a Bayer image into three planar channels.
+     *
+     * All non-green pixels of a Bayer row have the same color x, the non-green pixels of the neighbouring rows
+     * have the other color y. Columns outside the image are mirrored. Output i belongs to column begin + i.
+     *
+     * \param above      Row above, the mirrored row below for the first row of the image
+     * \param row        Row to demosaic
+     * \param below      Row below, the mirrored row above for the last row of the image
+     * \param width      Number of pixels of a row, at least 2
+     * \param begin      First column to demosaic
+     * \param count      Number of columns to demosaic
+     * \param x_at_odd   Whether the non-green pixels of the row are in the odd columns
+     * \param x          Destination of the color of the non-green pixels of the row
+     * \param green      Destination of the green channel
+     * \param y          Destination of the other color
+     */
+    void demosaicRow8(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                      size_t begin, size_t count, bool x_at_odd, uint8_t* x, uint8_t* green, uint8_t* y);
+
+    /**
+     * \brief Bilinear demosaic of one row of a 16 bit Bayer image, the rows do not need to be aligned.
+     *
+     * Same as demosaicRow8.
+     *
+     * \param swap_bytes   Swap the byte order of every value while reading
+     */
+    void demosaicRow16(const uint8_t* above, const uint8_t* row, const uint8_t* below, size_t width,
+                       size_t begin, size_t count, bool x_at_odd, bool swap_bytes, uint16_t* x, uint16_t* green, uint16_t* y);
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_INSTRUMENTATION_H
+#define ASR_HALCON_BRIDGE_INSTRUMENTATION_H
+
+#include <asr_halcon_bridge/conversion_stats.h>
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Measures a conversion call from construction to destruction and records it.
+     *
+     * Allocations made by the thread while the timer exists are attributed to it, and so are the allocations of
+     * worker threads running a parallelFor() body on its behalf. A timer nested in another timer of the same function
+     * (an overload delegating to another one) records nothing.
+     */
+    class ScopedConversionTimer {
+        public:
+            explicit ScopedConversionTimer(ConversionFunction function);
+            ~ScopedConversionTimer();
+
+            void addBytes(size_t bytes) {
+                bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            }
+
+            /**
+             * \brief Count an allocation for the innermost active timer of the calling thread, if any.
+             */
+            static void addAllocation();
+
+            /**
+             * \brief The innermost active timer of the calling thread, NULL outside of a conversion.
+             */
+            static ScopedConversionTimer* getCurrent();
+
+            /**
+             * \brief Attributes the allocations of a worker thread to the timer of the thread it works for.
+             */
+            class Forward {
+                public:
+                    explicit Forward(ScopedConversionTimer* timer);
+                    ~Forward();
+
+                private:
+                    Forward(const Forward&);
+                    Forward& operator=(const Forward&);
+
+                    ScopedConversionTimer* previous_;
+            };
+
+        private:
+            ScopedConversionTimer(const ScopedConversionTimer&);
+            ScopedConversionTimer& operator=(const ScopedConversionTimer&);
+
+            ConversionFunction function_;
+            bool active_;
+            // workers forwarded to this timer update the counters concurrently
+            std::atomic<size_t> bytes_;
+            std::atomic<unsigned long> allocations_;
+            std::chrono::steady_clock::time_point start_;
+            ScopedConversionTimer* outer_;
+    };
+
+}
+
+#ifdef HALCON_BRIDGE_STATS
+#define HALCON_BRIDGE_STATS_SCOPE(function) halcon_bridge::ScopedConversionTimer halcon_bridge_conversion_timer(function)
+#define HALCON_BRIDGE_STATS_BYTES(bytes) halcon_bridge_conversion_timer.addBytes(bytes)
+#define HALCON_BRIDGE_STATS_ALLOCATION() halcon_bridge::ScopedConversionTimer::addAllocation()
+#else
+#define HALCON_BRIDGE_STATS_SCOPE(function) ((void)0)
+#define HALCON_BRIDGE_STATS_BYTES(bytes) ((void)0)
+#define HALCON_BRIDGE_STATS_ALLOCATION() ((void)0)
+#endif
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Resize a message buffer, counting an allocation if its capacity had to grow.
+     */
+    template<typename Buffer>
+    void resizeMessageBuffer(Buffer& buffer, size_t size) {
+        size_t capacity = buffer.capacity();
+        buffer.resize(size);
+        if (buffer.capacity() != capacity) {
+            HALCON_BRIDGE_STATS_ALLOCATION();
+        }
+    }
+
+}
+
+#endif
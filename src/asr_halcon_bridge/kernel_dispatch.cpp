@@ -0,0 +1,79 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "kernel_dispatch.h"
+#include <asr_halcon_bridge/halcon_exception.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace halcon_bridge {
+
+    namespace {
+
+        KernelVariant getBestKernelVariant() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            if (__builtin_cpu_supports("ssse3")) return KERNEL_VARIANT_SSSE3;
+            return KERNEL_VARIANT_SSE2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+            return KERNEL_VARIANT_NEON;
+#else
+            return KERNEL_VARIANT_SCALAR;
+#endif
+        }
+
+        std::atomic<int>& getSelectedVariant() {
+            static std::atomic<int> selected(getBestKernelVariant());
+            return selected;
+        }
+
+    }
+
+
+
+    std::vector<KernelVariant> getKernelVariants() {
+        std::vector<KernelVariant> variants;
+        variants.push_back(KERNEL_VARIANT_SCALAR);
+        KernelVariant best = getBestKernelVariant();
+        if (best == KERNEL_VARIANT_NEON) {
+            variants.push_back(KERNEL_VARIANT_NEON);
+        } else {
+            for (int variant = KERNEL_VARIANT_SSE2; variant <= best; variant++) {
+                variants.push_back((KernelVariant)variant);
+            }
+        }
+        return variants;
+    }
+
+    void setKernelVariant(KernelVariant variant) {
+        std::vector<KernelVariant> variants = getKernelVariants();
+        if (std::find(variants.begin(), variants.end(), variant) == variants.end()) {
+            throw Exception("Kernel variant is not supported by this CPU");
+        }
+        getSelectedVariant().store(variant, std::memory_order_relaxed);
+    }
+
+    KernelVariant getKernelVariant() {
+        return (KernelVariant)getSelectedVariant().load(std::memory_order_relaxed);
+    }
+
+    bool kernelVariantEnabled(KernelVariant variant) {
+        // only variants of the architecture are compiled, so on ARM the selection is either scalar or NEON
+        return variant <= getSelectedVariant().load(std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,61 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_KERNEL_DISPATCH_H
+#define ASR_HALCON_BRIDGE_KERNEL_DISPATCH_H
+
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Instruction set variants of the conversion kernels, ordered so that a variant includes all smaller ones
+     * of its architecture.
+     */
+    enum KernelVariant {
+        /// Plain C++, the reference all other variants must match exactly
+        KERNEL_VARIANT_SCALAR,
+        KERNEL_VARIANT_SSE2,
+        KERNEL_VARIANT_SSSE3,
+        KERNEL_VARIANT_NEON
+    };
+
+    /**
+     * \brief Variants supported by this build and CPU, starting with KERNEL_VARIANT_SCALAR.
+     */
+    std::vector<KernelVariant> getKernelVariants();
+
+    /**
+     * \brief Restrict the kernels to variant, e.g. KERNEL_VARIANT_SCALAR for the reference path.
+     *
+     * The best supported variant is used by default. Throws an Exception if variant is not supported.
+     */
+    void setKernelVariant(KernelVariant variant);
+
+    /**
+     * \brief The variant selected by setKernelVariant.
+     */
+    KernelVariant getKernelVariant();
+
+    /**
+     * \brief Whether the kernels of variant may be used, i.e. variant is part of the selected one.
+     */
+    bool kernelVariantEnabled(KernelVariant variant);
+
+}
+
+#endif
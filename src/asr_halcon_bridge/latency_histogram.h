@@ -0,0 +1,89 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_LATENCY_HISTOGRAM_H
+#define ASR_HALCON_BRIDGE_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+
+namespace halcon_bridge {
+
+    /// Number of power-of-two latency bins, bin i counts latencies in [2^i, 2^(i+1)) nanoseconds
+    const int LATENCY_BINS = 64;
+
+    inline int getLatencyBin(uint64_t nanoseconds) {
+        int bin = 0;
+        while ((nanoseconds >>= 1) != 0) bin++;
+        return bin;
+    }
+
+    inline unsigned long getBinCount(unsigned long count) {
+        return count;
+    }
+
+    inline unsigned long getBinCount(const std::atomic<unsigned long>& count) {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Estimate a latency percentile in seconds from LATENCY_BINS power-of-two bins.
+     *
+     * \param bins              Plain or atomic counters of every bin
+     * \param count             Number of latencies in the bins
+     * \param fraction          The percentile, e.g. 0.99
+     * \param max_nanoseconds   Largest latency in the bins, which bounds the estimate
+     */
+    template<typename Bin>
+    double getLatencyPercentile(const Bin* bins, unsigned long count, double fraction, uint64_t max_nanoseconds) {
+        if (count == 0) return 0.0;
+        unsigned long target = std::max(1UL, (unsigned long)(fraction * count + 0.5));
+        unsigned long seen = 0;
+        for (int bin = 0; bin < LATENCY_BINS; bin++) {
+            seen += getBinCount(bins[bin]);
+            if (seen >= target) {
+                // upper bound of the bin, but never more than the largest measurement
+                uint64_t bound = (bin < LATENCY_BINS - 1) ? ((uint64_t)2 << bin) : max_nanoseconds;
+                return std::min(bound, max_nanoseconds) * 1e-9;
+            }
+        }
+        return max_nanoseconds * 1e-9;
+    }
+
+    /**
+     * \brief Latency histogram for a single thread or guarded by a lock, zero-initialized by memset.
+     */
+    struct LatencyHistogram {
+        unsigned long count;
+        uint64_t max_nanoseconds;
+        unsigned long bins[LATENCY_BINS];
+
+        void add(uint64_t nanoseconds) {
+            bins[getLatencyBin(nanoseconds)]++;
+            count++;
+            max_nanoseconds = std::max(max_nanoseconds, nanoseconds);
+        }
+
+        double getPercentile(double fraction) const {
+            return getLatencyPercentile(bins, count, fraction, max_nanoseconds);
+        }
+    };
+
+}
+
+#endif
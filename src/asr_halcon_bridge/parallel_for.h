@@ -0,0 +1,53 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_PARALLEL_FOR_H
+#define ASR_HALCON_BRIDGE_PARALLEL_FOR_H
+
+#include <stddef.h>
+#include <functional>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Run body over [0, count) split into contiguous ranges on the conversion worker pool.
+     *
+     * body(begin, end) is called for disjoint ranges covering [0, count) and parallelFor returns once all of them
+     * are done. The whole range is processed by the calling thread if bytes is below the parallel conversion
+     * threshold, if only one thread is configured, if the pool is busy with another conversion or if parallelFor is
+     * called from inside a body.
+     *
+     * If body throws, the ranges that have not started yet are skipped and the first exception is rethrown once
+     * all running ranges are done.
+     *
+     * \param count   Number of work items, e.g. rows of an image or points of a cloud
+     * \param bytes   Amount of data touched by the whole conversion
+     * \param body    Function converting the items [begin, end)
+     */
+    void parallelFor(size_t count, size_t bytes, const std::function<void(size_t, size_t)>& body);
+
+    /**
+     * \brief Same as above for any callable, which is passed by reference so that wrapping it does not allocate.
+     */
+    template<typename Body>
+    void parallelFor(size_t count, size_t bytes, const Body& body) {
+        parallelFor(count, bytes, std::function<void(size_t, size_t)>(std::cref(body)));
+    }
+
+}
+
+#endif
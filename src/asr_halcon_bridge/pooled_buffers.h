@@ -0,0 +1,226 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_POOLED_BUFFERS_H
+#define ASR_HALCON_BRIDGE_POOLED_BUFFERS_H
+
+#include <asr_halcon_bridge/buffer_pool.h>
+#include "instrumentation.h"
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace halcon_bridge {
+
+    /**
+     * \brief Pool of 64 byte aligned buffers, keyed by their size.
+     *
+     * Buffers handed out while the pool is disabled are not tracked and simply freed on release.
+     */
+    class BufferPool {
+        public:
+            BufferPool();
+
+            void* acquire(size_t size);
+            void release(void* buffer);
+
+            void setCapacity(size_t bytes);
+            void clear();
+            BufferPoolStats getStats() const;
+
+        private:
+            mutable std::mutex mutex_;
+            std::map<size_t, std::vector<void*> > cached_;
+            std::map<void*, size_t> sizes_;
+            size_t capacity_;
+            BufferPoolStats stats_;
+    };
+
+    /**
+     * \brief Pool of ROS messages whose data vectors keep their capacity between uses.
+     *
+     * The reference counts of the returned shared pointers are recycled as well, so acquiring a cached message does
+     * not allocate.
+     */
+    template<typename Message>
+    class MessagePool {
+        public:
+            MessagePool() : block_size_(0), capacity_(256 << 20) {
+                clear();
+            }
+
+            /**
+             * \brief Get a message, preferably a released one whose data can hold size bytes.
+             */
+            boost::shared_ptr<Message> acquire(size_t size) {
+                Message* message = NULL;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    for (size_t i = 0; i < cached_.size(); i++) {
+                        if (cached_[i]->data.capacity() >= size) {
+                            message = cached_[i];
+                            cached_.erase(cached_.begin() + i);
+                            stats_.cached_buffers--;
+                            stats_.cached_bytes -= message->data.capacity();
+                            stats_.hits++;
+                            break;
+                        }
+                    }
+                    if (!message) stats_.misses++;
+                }
+                if (!message) {
+                    message = new Message();
+                    HALCON_BRIDGE_STATS_ALLOCATION();
+                }
+                return boost::shared_ptr<Message>(message, Releaser(this), BlockAllocator<Message>(this));
+            }
+
+            void setCapacity(size_t bytes) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                capacity_ = bytes;
+            }
+
+            void clear() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (size_t i = 0; i < cached_.size(); i++) {
+                    delete cached_[i];
+                }
+                cached_.clear();
+                for (size_t i = 0; i < blocks_.size(); i++) {
+                    ::operator delete(blocks_[i]);
+                }
+                blocks_.clear();
+                stats_.hits = stats_.misses = 0;
+                stats_.cached_buffers = stats_.cached_bytes = 0;
+            }
+
+            BufferPoolStats getStats() const {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return stats_;
+            }
+
+        private:
+            struct Releaser {
+                MessagePool* pool;
+                Releaser(MessagePool* pool) : pool(pool) {}
+                void operator()(Message* message) const { pool->release(message); }
+            };
+
+            void release(Message* message) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    size_t size = message->data.capacity();
+                    if (isBufferPoolEnabled() && (stats_.cached_bytes + size <= capacity_)) {
+                        cached_.push_back(message);
+                        stats_.cached_buffers++;
+                        stats_.cached_bytes += size;
+                        return;
+                    }
+                }
+                delete message;
+            }
+
+            // Allocator of the reference counts, which all have the same size.
+            template<typename T>
+            struct BlockAllocator : public std::allocator<T> {
+                MessagePool* pool;
+                BlockAllocator(MessagePool* pool) : pool(pool) {}
+                template<typename U>
+                BlockAllocator(const BlockAllocator<U>& other) : pool(other.pool) {}
+                template<typename U>
+                struct rebind { typedef BlockAllocator<U> other; };
+
+                T* allocate(size_t n) { return (T*)pool->allocateBlock(n * sizeof(T)); }
+                void deallocate(T* block, size_t) { pool->releaseBlock(block); }
+            };
+
+            void* allocateBlock(size_t size) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!blocks_.empty() && (size == block_size_)) {
+                    void* block = blocks_.back();
+                    blocks_.pop_back();
+                    return block;
+                }
+                block_size_ = size;
+                return ::operator new(size);
+            }
+
+            void releaseBlock(void* block) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                blocks_.push_back(block);
+            }
+
+            mutable std::mutex mutex_;
+            std::vector<Message*> cached_;
+            std::vector<void*> blocks_;
+            size_t block_size_;
+            size_t capacity_;
+            BufferPoolStats stats_;
+    };
+
+    /**
+     * \brief Pool for the planes of images created by toHalconCopy.
+     */
+    BufferPool& imageBufferPool();
+
+    /**
+     * \brief Clear procedure for HImages whose planes come from imageBufferPool().
+     */
+    void releaseImagePlane(void* plane);
+
+    /**
+     * \brief Pool for the messages returned by HalconImage::toImageMsg().
+     */
+    MessagePool<sensor_msgs::Image>& imageMessagePool();
+
+    /**
+     * \brief Pool for the scratch buffers of point cloud conversions.
+     */
+    BufferPool& pointcloudBufferPool();
+
+    /**
+     * \brief Pool for the messages returned by HalconPointcloud::toPointcloudMsg().
+     */
+    MessagePool<sensor_msgs::PointCloud2>& pointcloudMessagePool();
+
+    /**
+     * \brief Buffer from a BufferPool that is released when it goes out of scope.
+     */
+    class PooledBuffer {
+        public:
+            PooledBuffer(BufferPool& pool, size_t size) : pool_(pool), data_(pool.acquire(size)) {}
+            ~PooledBuffer() { pool_.release(data_); }
+
+            void* data() const { return data_; }
+
+        private:
+            PooledBuffer(const PooledBuffer&);
+            PooledBuffer& operator=(const PooledBuffer&);
+
+            BufferPool& pool_;
+            void* data_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,989 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "halconcpp/HalconCpp.h"
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace HalconCpp {
+
+    namespace StandIn {
+
+        struct Run {
+            Hlong row;
+            Hlong begin;
+            Hlong end;
+
+            bool operator<(const Run& other) const {
+                return (row < other.row) || ((row == other.row) && (begin < other.begin));
+            }
+        };
+
+        typedef std::vector<Run, Allocator<Run> > Runs;
+
+        struct Plane {
+            std::atomic<long> references;
+            void* data;
+            /// Called with data once the last image using the plane is gone, data is freed if NULL
+            void (*clear_proc)(void*);
+        };
+
+        struct Iconic {
+            std::atomic<long> references;
+            bool image;
+            String type;
+            Hlong width;
+            Hlong height;
+            std::vector<Plane*, Allocator<Plane*> > channels;
+            /// Domain of an image or runs of a region, sorted and without overlaps
+            Runs runs;
+        };
+
+        struct Attribute {
+            String name;
+            std::vector<double, Allocator<double> > values;
+        };
+
+        struct Model {
+            std::atomic<long> references;
+            std::vector<double, Allocator<double> > coordinates[3];
+            bool has_normals;
+            std::vector<double, Allocator<double> > normals[3];
+            bool has_mapping;
+            Hlong mapping_width;
+            Hlong mapping_height;
+            std::vector<Hlong, Allocator<Hlong> > mapping_rows;
+            std::vector<Hlong, Allocator<Hlong> > mapping_cols;
+            std::vector<Attribute, Allocator<Attribute> > attributes;
+        };
+
+        template<typename T>
+        T* create() {
+            void* memory = malloc(sizeof(T));
+            if (!memory) throw std::bad_alloc();
+            T* object = new (memory) T();
+            object->references = 1;
+            return object;
+        }
+
+        template<typename T>
+        void destroy(T* object) {
+            object->~T();
+            free(object);
+        }
+
+        void release(Plane* plane) {
+            if (--plane->references > 0) return;
+            if (plane->clear_proc) {
+                plane->clear_proc(plane->data);
+            } else {
+                free(plane->data);
+            }
+            destroy(plane);
+        }
+
+        void release(Iconic* object) {
+            if (--object->references > 0) return;
+            for (size_t i = 0; i < object->channels.size(); i++) {
+                release(object->channels[i]);
+            }
+            destroy(object);
+        }
+
+        void release(Model* model) {
+            if (model && (--model->references == 0)) {
+                destroy(model);
+            }
+        }
+
+        size_t getTypeSize(const char* type) {
+            if (!strcmp(type, "byte") || !strcmp(type, "int1") || !strcmp(type, "direction") || !strcmp(type, "cyclic")) return 1;
+            if (!strcmp(type, "uint2") || !strcmp(type, "int2")) return 2;
+            if (!strcmp(type, "int4") || !strcmp(type, "real")) return 4;
+            if (!strcmp(type, "int8")) return 8;
+            throw HException("gen_image1", "Wrong pixel type");
+        }
+
+        Runs getRectangle(Hlong row1, Hlong column1, Hlong row2, Hlong column2) {
+            Runs runs;
+            if ((row2 < row1) || (column2 < column1)) return runs;
+            runs.reserve(row2 - row1 + 1);
+            for (Hlong row = row1; row <= row2; row++) {
+                Run run = { row, column1, column2 };
+                runs.push_back(run);
+            }
+            return runs;
+        }
+
+        // Sort the runs and merge overlapping or touching runs of a row
+        void normalize(Runs& runs) {
+            std::sort(runs.begin(), runs.end());
+            size_t kept = 0;
+            for (size_t i = 0; i < runs.size(); i++) {
+                if (runs[i].end < runs[i].begin) continue;
+                if ((kept > 0) && (runs[kept - 1].row == runs[i].row) && (runs[i].begin <= runs[kept - 1].end + 1)) {
+                    runs[kept - 1].end = std::max(runs[kept - 1].end, runs[i].end);
+                } else {
+                    runs[kept++] = runs[i];
+                }
+            }
+            runs.resize(kept);
+        }
+
+        Runs intersect(const Runs& a, const Runs& b) {
+            Runs result;
+            size_t i = 0, j = 0;
+            while ((i < a.size()) && (j < b.size())) {
+                if (a[i].row != b[j].row) {
+                    if (a[i].row < b[j].row) i++; else j++;
+                    continue;
+                }
+                Run run = { a[i].row, std::max(a[i].begin, b[j].begin), std::min(a[i].end, b[j].end) };
+                if (run.begin <= run.end) result.push_back(run);
+                if (a[i].end < b[j].end) i++; else j++;
+            }
+            return result;
+        }
+
+        Iconic* createImage(const char* type, Hlong width, Hlong height) {
+            if ((width <= 0) || (height <= 0)) {
+                throw HException("gen_image", "Wrong image size");
+            }
+            Iconic* object = create<Iconic>();
+            object->image = true;
+            object->type = type;
+            object->width = width;
+            object->height = height;
+            object->runs = getRectangle(0, 0, height - 1, width - 1);
+            return object;
+        }
+
+        Plane* createPlane(void* data, void (*clear_proc)(void*)) {
+            Plane* plane = create<Plane>();
+            plane->data = data;
+            plane->clear_proc = clear_proc;
+            return plane;
+        }
+
+        Iconic* copyImage(const Iconic& source) {
+            Iconic* object = create<Iconic>();
+            object->image = true;
+            object->type = source.type;
+            object->width = source.width;
+            object->height = source.height;
+            object->runs = source.runs;
+            return object;
+        }
+
+        void addChannel(Iconic* object, Plane* plane) {
+            plane->references++;
+            object->channels.push_back(plane);
+        }
+
+        template<typename T>
+        void appendAll(T& destination, const T& source) {
+            destination.insert(destination.end(), source.begin(), source.end());
+        }
+
+        // Memory of extern images without a clear procedure stays with the caller
+        void keepData(void*) {
+        }
+
+        void (*getClearProc(void* clear_proc))(void*) {
+            return clear_proc ? (void (*)(void*))clear_proc : &keepData;
+        }
+
+    }
+
+    using namespace StandIn;
+
+
+
+    HString::HString() {
+    }
+
+    HString::HString(const char* text) : text_(text ? text : "") {
+    }
+
+    const char* HString::Text() const {
+        return text_.c_str();
+    }
+
+    HString::operator const char*() const {
+        return text_.c_str();
+    }
+
+    bool HString::operator==(const HString& other) const {
+        return text_ == other.text_;
+    }
+
+    bool HString::operator!=(const HString& other) const {
+        return text_ != other.text_;
+    }
+
+
+
+    HException::HException(const char* proc_name, const char* message) : proc_name_(proc_name), message_(message) {
+    }
+
+    HString HException::ErrorMessage() const {
+        return message_;
+    }
+
+    HString HException::ProcName() const {
+        return proc_name_;
+    }
+
+
+
+    HTupleElement::HTupleElement(HTuple* tuple, Hlong index) : tuple_(tuple), index_(index) {
+        tuple_->checkIndex(index);
+    }
+
+    HTupleElement::operator double() const {
+        HTupleType type = (tuple_->type_ == eTupleTypeMixed) ? tuple_->types_[index_] : tuple_->type_;
+        if (type == eTupleTypeDouble) return tuple_->doubles_[index_];
+        if (type == eTupleTypeLong) return (double)tuple_->longs_[index_];
+        throw HException("HTupleElement", "Tuple element is not a number");
+    }
+
+    HTupleElement::operator float() const {
+        return (float)(double)*this;
+    }
+
+    HTupleElement::operator int() const {
+        return (int)(Hlong)*this;
+    }
+
+    HTupleElement::operator Hlong() const {
+        HTupleType type = (tuple_->type_ == eTupleTypeMixed) ? tuple_->types_[index_] : tuple_->type_;
+        if (type == eTupleTypeLong) return tuple_->longs_[index_];
+        if (type == eTupleTypeDouble) return (Hlong)tuple_->doubles_[index_];
+        throw HException("HTupleElement", "Tuple element is not a number");
+    }
+
+    HTupleElement::operator HString() const {
+        HTupleType type = (tuple_->type_ == eTupleTypeMixed) ? tuple_->types_[index_] : tuple_->type_;
+        if (type != eTupleTypeString) {
+            throw HException("HTupleElement", "Tuple element is not a string");
+        }
+        return HString(tuple_->strings_[index_].c_str());
+    }
+
+    HTupleElement& HTupleElement::operator=(double value) {
+        HTuple& tuple = *tuple_;
+        if ((tuple.type_ == eTupleTypeDouble) || (tuple.type_ == eTupleTypeEmpty)) {
+            tuple.type_ = eTupleTypeDouble;
+            if (index_ == (Hlong)tuple.doubles_.size()) tuple.doubles_.push_back(value); else tuple.doubles_[index_] = value;
+            return *this;
+        }
+        tuple.makeMixed();
+        if (index_ == tuple.Length()) {
+            tuple.types_.push_back(eTupleTypeDouble);
+            tuple.longs_.push_back(0);
+            tuple.doubles_.push_back(value);
+            tuple.strings_.push_back(String());
+        } else {
+            tuple.types_[index_] = eTupleTypeDouble;
+            tuple.doubles_[index_] = value;
+        }
+        return *this;
+    }
+
+    HTupleElement& HTupleElement::operator=(int value) {
+        return *this = (Hlong)value;
+    }
+
+    HTupleElement& HTupleElement::operator=(Hlong value) {
+        HTuple& tuple = *tuple_;
+        if ((tuple.type_ == eTupleTypeLong) || (tuple.type_ == eTupleTypeEmpty)) {
+            tuple.type_ = eTupleTypeLong;
+            if (index_ == (Hlong)tuple.longs_.size()) tuple.longs_.push_back(value); else tuple.longs_[index_] = value;
+            return *this;
+        }
+        tuple.makeMixed();
+        if (index_ == tuple.Length()) {
+            tuple.types_.push_back(eTupleTypeLong);
+            tuple.longs_.push_back(value);
+            tuple.doubles_.push_back(0.0);
+            tuple.strings_.push_back(String());
+        } else {
+            tuple.types_[index_] = eTupleTypeLong;
+            tuple.longs_[index_] = value;
+        }
+        return *this;
+    }
+
+    HTupleElement& HTupleElement::operator=(const char* value) {
+        HTuple& tuple = *tuple_;
+        if ((tuple.type_ == eTupleTypeString) || (tuple.type_ == eTupleTypeEmpty)) {
+            tuple.type_ = eTupleTypeString;
+            if (index_ == (Hlong)tuple.strings_.size()) tuple.strings_.push_back(value); else tuple.strings_[index_] = value;
+            return *this;
+        }
+        tuple.makeMixed();
+        if (index_ == tuple.Length()) {
+            tuple.types_.push_back(eTupleTypeString);
+            tuple.longs_.push_back(0);
+            tuple.doubles_.push_back(0.0);
+            tuple.strings_.push_back(value);
+        } else {
+            tuple.types_[index_] = eTupleTypeString;
+            tuple.strings_[index_] = value;
+        }
+        return *this;
+    }
+
+
+
+    HTuple::HTuple() : type_(eTupleTypeEmpty) {
+    }
+
+    HTuple::HTuple(int value) : type_(eTupleTypeLong), longs_(1, value) {
+    }
+
+    HTuple::HTuple(Hlong value) : type_(eTupleTypeLong), longs_(1, value) {
+    }
+
+    HTuple::HTuple(double value) : type_(eTupleTypeDouble), doubles_(1, value) {
+    }
+
+    HTuple::HTuple(const char* value) : type_(eTupleTypeString), strings_(1, String(value)) {
+    }
+
+    HTuple::HTuple(const HString& value) : type_(eTupleTypeString), strings_(1, String(value.Text())) {
+    }
+
+    HTuple::HTuple(const Hlong* values, Hlong length) : type_((length > 0) ? eTupleTypeLong : eTupleTypeEmpty) {
+        if (length > 0) longs_.assign(values, values + length);
+    }
+
+    HTuple::HTuple(const double* values, Hlong length) : type_((length > 0) ? eTupleTypeDouble : eTupleTypeEmpty) {
+        if (length > 0) doubles_.assign(values, values + length);
+    }
+
+    HTuple::HTuple(const float* values, Hlong length) : type_((length > 0) ? eTupleTypeDouble : eTupleTypeEmpty) {
+        if (length > 0) doubles_.assign(values, values + length);
+    }
+
+    Hlong HTuple::Length() const {
+        switch (type_) {
+            case eTupleTypeLong:   return longs_.size();
+            case eTupleTypeDouble: return doubles_.size();
+            case eTupleTypeString: return strings_.size();
+            case eTupleTypeMixed:  return types_.size();
+            default:               return 0;
+        }
+    }
+
+    HTupleType HTuple::Type() const {
+        return type_;
+    }
+
+    Hlong* HTuple::LArr() {
+        if (type_ == eTupleTypeEmpty) return NULL;
+        if (type_ != eTupleTypeLong) throw HException("HTuple::LArr", "Tuple does not only contain integers");
+        return &longs_[0];
+    }
+
+    const Hlong* HTuple::LArr() const {
+        return const_cast<HTuple*>(this)->LArr();
+    }
+
+    double* HTuple::DArr() {
+        if (type_ == eTupleTypeEmpty) return NULL;
+        if (type_ != eTupleTypeDouble) throw HException("HTuple::DArr", "Tuple does not only contain reals");
+        return &doubles_[0];
+    }
+
+    const double* HTuple::DArr() const {
+        return const_cast<HTuple*>(this)->DArr();
+    }
+
+    HTupleElement HTuple::operator[](Hlong index) {
+        return HTupleElement(this, index);
+    }
+
+    HTupleElement HTuple::operator[](Hlong index) const {
+        return HTupleElement(const_cast<HTuple*>(this), index);
+    }
+
+    HTuple HTuple::TupleReal() const {
+        HTuple result;
+        if (type_ == eTupleTypeDouble) return *this;
+        if (type_ == eTupleTypeEmpty) return result;
+        if (type_ == eTupleTypeString) throw HException("tuple_real", "Wrong type of tuple");
+        Hlong length = Length();
+        result.type_ = eTupleTypeDouble;
+        result.doubles_.resize(length);
+        for (Hlong i = 0; i < length; i++) {
+            result.doubles_[i] = (double)(*this)[i];
+        }
+        return result;
+    }
+
+    HTuple& HTuple::Append(const HTuple& other) {
+        if (other.type_ == eTupleTypeEmpty) return *this;
+        if (type_ == eTupleTypeEmpty) return *this = other;
+        if ((type_ == other.type_) && (type_ != eTupleTypeMixed)) {
+            appendAll(longs_, other.longs_);
+            appendAll(doubles_, other.doubles_);
+            appendAll(strings_, other.strings_);
+            return *this;
+        }
+        HTuple tail = other;
+        makeMixed();
+        tail.makeMixed();
+        appendAll(types_, tail.types_);
+        appendAll(longs_, tail.longs_);
+        appendAll(doubles_, tail.doubles_);
+        appendAll(strings_, tail.strings_);
+        return *this;
+    }
+
+    void HTuple::Clear() {
+        *this = HTuple();
+    }
+
+    double HTuple::D() const {
+        if (Length() != 1) throw HException("HTuple::D", "Tuple does not contain exactly one value");
+        return (double)(*this)[0];
+    }
+
+    Hlong HTuple::L() const {
+        if (Length() != 1) throw HException("HTuple::L", "Tuple does not contain exactly one value");
+        return (Hlong)(*this)[0];
+    }
+
+    HString HTuple::S() const {
+        if (Length() != 1) throw HException("HTuple::S", "Tuple does not contain exactly one value");
+        return (HString)(*this)[0];
+    }
+
+    HTuple::operator HString() const {
+        return S();
+    }
+
+    void HTuple::makeMixed() {
+        if (type_ == eTupleTypeMixed) return;
+        size_t length = Length();
+        types_.assign(length, type_);
+        longs_.resize(length, 0);
+        doubles_.resize(length, 0.0);
+        strings_.resize(length);
+        type_ = eTupleTypeMixed;
+    }
+
+    void HTuple::checkIndex(Hlong index) const {
+        if ((index < 0) || (index > Length())) {
+            throw HException("HTuple", "Tuple index out of range");
+        }
+    }
+
+
+
+    HObject::HObject() {
+    }
+
+    HObject::HObject(const HObject& other) : objects_(other.objects_) {
+        for (size_t i = 0; i < objects_.size(); i++) objects_[i]->references++;
+    }
+
+    HObject::~HObject() {
+        Clear();
+    }
+
+    HObject& HObject::operator=(const HObject& other) {
+        if (this != &other) {
+            for (size_t i = 0; i < other.objects_.size(); i++) other.objects_[i]->references++;
+            Clear();
+            objects_ = other.objects_;
+        }
+        return *this;
+    }
+
+    bool HObject::IsInitialized() const {
+        return !objects_.empty();
+    }
+
+    Hlong HObject::CountObj() const {
+        return objects_.size();
+    }
+
+    void HObject::Clear() {
+        for (size_t i = 0; i < objects_.size(); i++) {
+            release(objects_[i]);
+        }
+        objects_.clear();
+    }
+
+    void HObject::append(Iconic* object) {
+        objects_.push_back(object);
+    }
+
+    const Iconic& HObject::at(Hlong index) const {
+        if ((index < 0) || (index >= (Hlong)objects_.size())) {
+            throw HException("select_obj", "Wrong index of object");
+        }
+        return *objects_[index];
+    }
+
+    const Iconic& HObject::first(const char* proc_name) const {
+        if (objects_.empty()) {
+            throw HException(proc_name, "Object not initialized");
+        }
+        return *objects_[0];
+    }
+
+
+
+    HRegion::HRegion() {
+    }
+
+    HRegion::HRegion(const HObject& object) : HObject(object) {
+    }
+
+    void HRegion::GenRegionRuns(const HTuple& row, const HTuple& column_begin, const HTuple& column_end) {
+        Hlong count = row.Length();
+        if ((column_begin.Length() != count) || (column_end.Length() != count)) {
+            throw HException("gen_region_runs", "Number of runs differs");
+        }
+        Iconic* object = create<Iconic>();
+        object->image = false;
+        object->width = object->height = 0;
+        object->runs.resize(count);
+        for (Hlong i = 0; i < count; i++) {
+            Run run = { (Hlong)row[i], (Hlong)column_begin[i], (Hlong)column_end[i] };
+            object->runs[i] = run;
+        }
+        normalize(object->runs);
+        Clear();
+        append(object);
+    }
+
+    void HRegion::GenRectangle1(double row1, double column1, double row2, double column2) {
+        Iconic* object = create<Iconic>();
+        object->image = false;
+        object->width = object->height = 0;
+        object->runs = getRectangle((Hlong)row1, (Hlong)column1, (Hlong)row2, (Hlong)column2);
+        Clear();
+        append(object);
+    }
+
+    void HRegion::GetRegionRuns(HTuple* row, HTuple* column_begin, HTuple* column_end) const {
+        const Runs& runs = first("get_region_runs").runs;
+        std::vector<Hlong, Allocator<Hlong> > values(3 * runs.size());
+        Hlong* rows = values.empty() ? NULL : &values[0];
+        Hlong* begins = rows + runs.size();
+        Hlong* ends = begins + runs.size();
+        for (size_t i = 0; i < runs.size(); i++) {
+            rows[i] = runs[i].row;
+            begins[i] = runs[i].begin;
+            ends[i] = runs[i].end;
+        }
+        *row = HTuple(rows, runs.size());
+        *column_begin = HTuple(begins, runs.size());
+        *column_end = HTuple(ends, runs.size());
+    }
+
+    Hlong HRegion::Area() const {
+        const Runs& runs = first("area_center").runs;
+        Hlong area = 0;
+        for (size_t i = 0; i < runs.size(); i++) {
+            area += runs[i].end - runs[i].begin + 1;
+        }
+        return area;
+    }
+
+
+
+    HImage::HImage() {
+    }
+
+    HImage::HImage(const HObject& object) : HObject(object) {
+    }
+
+    void HImage::GenImage1(const char* type, Hlong width, Hlong height, void* pixel_pointer) {
+        size_t size = width * height * getTypeSize(type);
+        Iconic* object = createImage(type, width, height);
+        void* data = malloc(size);
+        memcpy(data, pixel_pointer, size);
+        object->channels.push_back(createPlane(data, NULL));
+        Clear();
+        append(object);
+    }
+
+    void HImage::GenImage1Extern(const char* type, Hlong width, Hlong height, void* pixel_pointer, void* clear_proc) {
+        getTypeSize(type);
+        Iconic* object = createImage(type, width, height);
+        object->channels.push_back(createPlane(pixel_pointer, getClearProc(clear_proc)));
+        Clear();
+        append(object);
+    }
+
+    void HImage::GenImage3Extern(const char* type, Hlong width, Hlong height, void* red, void* green, void* blue,
+                                 void* clear_proc) {
+        getTypeSize(type);
+        Iconic* object = createImage(type, width, height);
+        void* planes[3] = { red, green, blue };
+        for (int i = 0; i < 3; i++) {
+            object->channels.push_back(createPlane(planes[i], getClearProc(clear_proc)));
+        }
+        Clear();
+        append(object);
+    }
+
+    void HImage::GenImageInterleaved(void* pixel_pointer, const char* color_format, Hlong original_width,
+                                     Hlong original_height, Hlong alignment, const char* type, Hlong image_width,
+                                     Hlong image_height, Hlong start_row, Hlong start_column, Hlong, Hlong) {
+        String format = color_format;
+        int red, green, blue, pixel_size;
+        if (format == "rgb") {
+            red = 0; green = 1; blue = 2; pixel_size = 3;
+        } else if (format == "bgr") {
+            red = 2; green = 1; blue = 0; pixel_size = 3;
+        } else if (format == "rgbx") {
+            red = 0; green = 1; blue = 2; pixel_size = 4;
+        } else if (format == "bgrx") {
+            red = 2; green = 1; blue = 0; pixel_size = 4;
+        } else if (format == "xrgb") {
+            red = 1; green = 2; blue = 3; pixel_size = 4;
+        } else if (format == "xbgr") {
+            red = 3; green = 2; blue = 1; pixel_size = 4;
+        } else {
+            throw HException("gen_image_interleaved", "Wrong color format");
+        }
+        if (strcmp(type, "byte") != 0) {
+            throw HException("gen_image_interleaved", "Wrong pixel type");
+        }
+        if ((start_row < 0) || (start_column < 0) || (start_row + image_height > original_height) ||
+                (start_column + image_width > original_width)) {
+            throw HException("gen_image_interleaved", "Image part outside of the original image");
+        }
+
+        size_t row_size = original_width * pixel_size;
+        if (alignment > 1) {
+            row_size = (row_size + alignment - 1) / alignment * alignment;
+        }
+        Iconic* object = createImage(type, image_width, image_height);
+        int offsets[3] = { red, green, blue };
+        for (int channel = 0; channel < 3; channel++) {
+            uint8_t* plane = (uint8_t*)malloc(image_width * image_height);
+            for (Hlong row = 0; row < image_height; row++) {
+                const uint8_t* src = (const uint8_t*)pixel_pointer + (start_row + row) * row_size + start_column * pixel_size;
+                for (Hlong column = 0; column < image_width; column++) {
+                    plane[row * image_width + column] = src[column * pixel_size + offsets[channel]];
+                }
+            }
+            object->channels.push_back(createPlane(plane, NULL));
+        }
+        Clear();
+        append(object);
+    }
+
+    void* HImage::GetImagePointer1(HString* type, Hlong* width, Hlong* height) const {
+        const Iconic& object = first("get_image_pointer1");
+        if (!object.image) throw HException("get_image_pointer1", "Object is not an image");
+        *type = HString(object.type.c_str());
+        *width = object.width;
+        *height = object.height;
+        return object.channels[0]->data;
+    }
+
+    void HImage::GetImagePointer3(void** red, void** green, void** blue, HString* type, Hlong* width, Hlong* height) const {
+        const Iconic& object = first("get_image_pointer3");
+        if (!object.image || (object.channels.size() < 3)) {
+            throw HException("get_image_pointer3", "Image does not have three channels");
+        }
+        *red = object.channels[0]->data;
+        *green = object.channels[1]->data;
+        *blue = object.channels[2]->data;
+        *type = HString(object.type.c_str());
+        *width = object.width;
+        *height = object.height;
+    }
+
+    Hlong HImage::Width() const {
+        return first("get_image_size").width;
+    }
+
+    Hlong HImage::Height() const {
+        return first("get_image_size").height;
+    }
+
+    Hlong HImage::CountChannels() const {
+        return first("count_channels").channels.size();
+    }
+
+    HString HImage::GetImageType() const {
+        return HString(first("get_image_type").type.c_str());
+    }
+
+    HImage HImage::AccessChannel(Hlong channel) const {
+        const Iconic& source = first("access_channel");
+        if ((channel < 1) || (channel > (Hlong)source.channels.size())) {
+            throw HException("access_channel", "Wrong channel index");
+        }
+        Iconic* object = copyImage(source);
+        addChannel(object, source.channels[channel - 1]);
+        HImage result;
+        result.append(object);
+        return result;
+    }
+
+    HImage HImage::Compose4(const HImage& image2, const HImage& image3, const HImage& image4) const {
+        const Iconic* sources[4] = { &first("compose4"), &image2.first("compose4"), &image3.first("compose4"),
+                                     &image4.first("compose4") };
+        Iconic* object = copyImage(*sources[0]);
+        for (int i = 0; i < 4; i++) {
+            if ((sources[i]->width != object->width) || (sources[i]->height != object->height) ||
+                    (sources[i]->type != object->type)) {
+                destroy(object);
+                throw HException("compose4", "Images differ in size or type");
+            }
+            if (i > 0) object->runs = intersect(object->runs, sources[i]->runs);
+        }
+        for (int i = 0; i < 4; i++) {
+            addChannel(object, sources[i]->channels[0]);
+        }
+        HImage result;
+        result.append(object);
+        return result;
+    }
+
+    HImage HImage::ReduceDomain(const HRegion& region) const {
+        const Iconic& source = first("reduce_domain");
+        const Iconic& domain = region.first("reduce_domain");
+        Iconic* object = copyImage(source);
+        object->runs = intersect(source.runs, domain.runs);
+        for (size_t i = 0; i < source.channels.size(); i++) {
+            addChannel(object, source.channels[i]);
+        }
+        HImage result;
+        result.append(object);
+        return result;
+    }
+
+    HRegion HImage::GetDomain() const {
+        Iconic* object = create<Iconic>();
+        object->image = false;
+        object->width = object->height = 0;
+        object->runs = first("get_domain").runs;
+        HRegion result;
+        result.append(object);
+        return result;
+    }
+
+    HImage HImage::ConcatObj(const HImage& other) const {
+        HImage result(*this);
+        for (size_t i = 0; i < other.objects_.size(); i++) {
+            other.objects_[i]->references++;
+            result.append(other.objects_[i]);
+        }
+        return result;
+    }
+
+    HImage HImage::SelectObj(Hlong index) const {
+        Iconic* object = const_cast<Iconic*>(&at(index - 1));
+        object->references++;
+        HImage result;
+        result.append(object);
+        return result;
+    }
+
+
+
+    HObjectModel3D::HObjectModel3D() : model_(NULL) {
+    }
+
+    HObjectModel3D::HObjectModel3D(const HTuple& x, const HTuple& y, const HTuple& z) : model_(NULL) {
+        Hlong count = x.Length();
+        if ((y.Length() != count) || (z.Length() != count)) {
+            throw HException("gen_object_model_3d_from_points", "Number of coordinates differs");
+        }
+        model_ = create<Model>();
+        const HTuple* coordinates[3] = { &x, &y, &z };
+        for (int axis = 0; axis < 3; axis++) {
+            HTuple values = coordinates[axis]->TupleReal();
+            if (count > 0) model_->coordinates[axis].assign(values.DArr(), values.DArr() + count);
+        }
+        model_->has_normals = false;
+        model_->has_mapping = false;
+        model_->mapping_width = model_->mapping_height = 0;
+    }
+
+    HObjectModel3D::HObjectModel3D(const HImage& x, const HImage& y, const HImage& z) : model_(NULL) {
+        const Iconic* images[3] = { &x.first("xyz_to_object_model_3d"), &y.first("xyz_to_object_model_3d"),
+                                    &z.first("xyz_to_object_model_3d") };
+        for (int axis = 0; axis < 3; axis++) {
+            if ((images[axis]->type != "real") || (images[axis]->width != images[0]->width) ||
+                    (images[axis]->height != images[0]->height)) {
+                throw HException("xyz_to_object_model_3d", "Images must be real images of the same size");
+            }
+        }
+        Runs runs = intersect(images[0]->runs, images[1]->runs);
+        runs = intersect(runs, images[2]->runs);
+
+        model_ = create<Model>();
+        model_->has_normals = false;
+        model_->has_mapping = true;
+        model_->mapping_width = images[0]->width;
+        model_->mapping_height = images[0]->height;
+        for (size_t i = 0; i < runs.size(); i++) {
+            for (Hlong column = runs[i].begin; column <= runs[i].end; column++) {
+                size_t pixel = runs[i].row * images[0]->width + column;
+                for (int axis = 0; axis < 3; axis++) {
+                    model_->coordinates[axis].push_back(((const float*)images[axis]->channels[0]->data)[pixel]);
+                }
+                model_->mapping_rows.push_back(runs[i].row);
+                model_->mapping_cols.push_back(column);
+            }
+        }
+    }
+
+    HObjectModel3D::HObjectModel3D(const HObjectModel3D& other) : model_(other.model_) {
+        if (model_) model_->references++;
+    }
+
+    HObjectModel3D::~HObjectModel3D() {
+        release(model_);
+    }
+
+    HObjectModel3D& HObjectModel3D::operator=(const HObjectModel3D& other) {
+        if (other.model_) other.model_->references++;
+        release(model_);
+        model_ = other.model_;
+        return *this;
+    }
+
+    HTuple HObjectModel3D::GetObjectModel3dParams(const HTuple& param_name) const {
+        const Model& m = model("get_object_model_3d_params");
+        size_t count = m.coordinates[0].size();
+        HTuple result;
+        for (Hlong i = 0; i < param_name.Length(); i++) {
+            String name = (const char*)(HString)param_name[i];
+            HTuple value;
+            if (name == "num_points") {
+                value = HTuple((Hlong)count);
+            } else if (name == "has_points") {
+                value = HTuple(count ? "true" : "false");
+            } else if ((name == "point_coord_x") || (name == "point_coord_y") || (name == "point_coord_z")) {
+                value = HTuple(count ? &m.coordinates[name[12] - 'x'][0] : NULL, count);
+            } else if (name == "has_point_normals") {
+                value = HTuple(m.has_normals ? "true" : "false");
+            } else if ((name == "point_normal_x") || (name == "point_normal_y") || (name == "point_normal_z")) {
+                if (!m.has_normals) throw HException("get_object_model_3d_params", "Object model has no normals");
+                value = HTuple(count ? &m.normals[name[13] - 'x'][0] : NULL, count);
+            } else if (name == "has_xyz_mapping") {
+                value = HTuple(m.has_mapping ? "true" : "false");
+            } else if ((name == "mapping_size") || (name == "mapping_row") || (name == "mapping_col")) {
+                if (!m.has_mapping) throw HException("get_object_model_3d_params", "Object model has no 2D mapping");
+                if (name == "mapping_size") {
+                    value = HTuple(m.mapping_width);
+                    value.Append(HTuple(m.mapping_height));
+                } else {
+                    const std::vector<Hlong, Allocator<Hlong> >& values = (name == "mapping_row") ? m.mapping_rows : m.mapping_cols;
+                    value = HTuple(count ? &values[0] : NULL, count);
+                }
+            } else if (name == "num_extended_attribute") {
+                value = HTuple((Hlong)m.attributes.size());
+            } else if (name == "extended_attribute_names") {
+                for (size_t j = 0; j < m.attributes.size(); j++) {
+                    value[j] = m.attributes[j].name.c_str();
+                }
+            } else if (name[0] == '&') {
+                size_t j = 0;
+                while ((j < m.attributes.size()) && (m.attributes[j].name != name.c_str())) j++;
+                if (j == m.attributes.size()) {
+                    throw HException("get_object_model_3d_params", "Extended attribute does not exist");
+                }
+                value = HTuple(count ? &m.attributes[j].values[0] : NULL, count);
+            } else {
+                throw HException("get_object_model_3d_params", "Wrong generic parameter name");
+            }
+            result.Append(value);
+        }
+        return result;
+    }
+
+    void HObjectModel3D::SetObjectModel3dAttribMod(const HTuple& attrib_name, const HTuple& attach_ext_attrib_to,
+                                                   const HTuple& attrib_values) const {
+        Model& m = model("set_object_model_3d_attrib_mod");
+        size_t count = m.coordinates[0].size();
+        Hlong names = attrib_name.Length();
+        if ((size_t)attrib_values.Length() != names * count) {
+            throw HException("set_object_model_3d_attrib_mod", "Number of values does not match the number of points");
+        }
+        if (attach_ext_attrib_to.Length() > 0) {
+            String attach = (const char*)(HString)attach_ext_attrib_to[0];
+            if (!attach.empty() && (attach != "points")) {
+                throw HException("set_object_model_3d_attrib_mod", "Extended attributes are only supported for points");
+            }
+        }
+        HTuple values = attrib_values.TupleReal();
+        const double* data = values.DArr();
+
+        int normals = 0;
+        for (Hlong i = 0; i < names; i++) {
+            String name = (const char*)(HString)attrib_name[i];
+            if ((name == "point_normal_x") || (name == "point_normal_y") || (name == "point_normal_z")) {
+                normals++;
+            } else if ((name.size() < 2) || (name[0] != '&')) {
+                throw HException("set_object_model_3d_attrib_mod", "Wrong attribute name");
+            }
+        }
+        if ((normals > 0) && (normals < 3) && !m.has_normals) {
+            throw HException("set_object_model_3d_attrib_mod", "Normals must be set for all three axes");
+        }
+
+        for (Hlong i = 0; i < names; i++) {
+            String name = (const char*)(HString)attrib_name[i];
+            const double* begin = data ? data + i * count : NULL;
+            if (name.compare(0, 13, "point_normal_") == 0) {
+                m.normals[name[13] - 'x'].assign(begin, begin + count);
+                continue;
+            }
+            size_t j = 0;
+            while ((j < m.attributes.size()) && (m.attributes[j].name != name.c_str())) j++;
+            if (j == m.attributes.size()) {
+                m.attributes.push_back(Attribute());
+                m.attributes[j].name = name.c_str();
+            }
+            m.attributes[j].values.assign(begin, begin + count);
+        }
+        if (normals > 0) {
+            m.has_normals = true;
+        }
+    }
+
+    void HObjectModel3D::Clear() {
+        release(model_);
+        model_ = NULL;
+    }
+
+    Model& HObjectModel3D::model(const char* proc_name) const {
+        if (!model_) {
+            throw HException(proc_name, "Handle is not initialized");
+        }
+        return *model_;
+    }
+
+}
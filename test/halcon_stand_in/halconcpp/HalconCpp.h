@@ -0,0 +1,285 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ASR_HALCON_BRIDGE_HALCON_STAND_IN_H
+#define ASR_HALCON_BRIDGE_HALCON_STAND_IN_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal stand-in for the subset of the HALCON C++ interface used by asr_halcon_bridge.
+ *
+ * It lets the tests and benchmarks build and run on machines without a HALCON license. The operators behave like
+ * their HALCON counterparts for the inputs the bridge passes, they are neither complete nor tuned, so absolute
+ * timings of anything but the bridge's own code mean nothing. Like HALCON, the stand-in allocates its storage with
+ * malloc, so the allocation counters of the benchmarks only see the bridge.
+ */
+#define HALCON_BRIDGE_STAND_IN
+
+typedef long Hlong;
+
+namespace HalconCpp {
+
+    namespace StandIn {
+
+        template<typename T>
+        struct Allocator {
+            typedef T value_type;
+
+            Allocator() {
+            }
+
+            template<typename U>
+            Allocator(const Allocator<U>&) {
+            }
+
+            T* allocate(size_t count) {
+                void* memory = malloc(count * sizeof(T));
+                if (!memory && count) throw std::bad_alloc();
+                return (T*)memory;
+            }
+
+            void deallocate(T* memory, size_t) {
+                free(memory);
+            }
+
+            template<typename U>
+            struct rebind {
+                typedef Allocator<U> other;
+            };
+
+            bool operator==(const Allocator&) const {
+                return true;
+            }
+
+            bool operator!=(const Allocator&) const {
+                return false;
+            }
+        };
+
+        typedef std::basic_string<char, std::char_traits<char>, Allocator<char> > String;
+
+        struct Iconic;
+        struct Model;
+
+    }
+
+    class HTuple;
+
+    class HString {
+        public:
+            HString();
+            HString(const char* text);
+
+            const char* Text() const;
+            operator const char*() const;
+            bool operator==(const HString& other) const;
+            bool operator!=(const HString& other) const;
+
+        private:
+            StandIn::String text_;
+    };
+
+    class HException {
+        public:
+            HException(const char* proc_name, const char* message);
+
+            HString ErrorMessage() const;
+            HString ProcName() const;
+
+        private:
+            HString proc_name_;
+            HString message_;
+    };
+
+    enum HTupleType {
+        eTupleTypeEmpty,
+        eTupleTypeLong,
+        eTupleTypeDouble,
+        eTupleTypeString,
+        eTupleTypeMixed
+    };
+
+    class HTupleElement {
+        public:
+            HTupleElement(HTuple* tuple, Hlong index);
+
+            operator double() const;
+            operator float() const;
+            operator int() const;
+            operator Hlong() const;
+            operator HString() const;
+
+            HTupleElement& operator=(double value);
+            HTupleElement& operator=(int value);
+            HTupleElement& operator=(Hlong value);
+            HTupleElement& operator=(const char* value);
+
+        private:
+            HTuple* tuple_;
+            Hlong index_;
+    };
+
+    class HTuple {
+        public:
+            HTuple();
+            HTuple(int value);
+            HTuple(Hlong value);
+            HTuple(double value);
+            HTuple(const char* value);
+            HTuple(const HString& value);
+            HTuple(const Hlong* values, Hlong length);
+            HTuple(const double* values, Hlong length);
+            HTuple(const float* values, Hlong length);
+
+            Hlong Length() const;
+            HTupleType Type() const;
+
+            /// Raw array of a tuple that only holds integers, throws otherwise
+            Hlong* LArr();
+            const Hlong* LArr() const;
+            /// Raw array of a tuple that only holds reals, throws otherwise
+            double* DArr();
+            const double* DArr() const;
+
+            HTupleElement operator[](Hlong index);
+            HTupleElement operator[](Hlong index) const;
+
+            HTuple TupleReal() const;
+            HTuple& Append(const HTuple& other);
+            void Clear();
+
+            double D() const;
+            Hlong L() const;
+            HString S() const;
+            operator HString() const;
+
+        private:
+            friend class HTupleElement;
+
+            void makeMixed();
+            void checkIndex(Hlong index) const;
+
+            HTupleType type_;
+            std::vector<Hlong, StandIn::Allocator<Hlong> > longs_;
+            std::vector<double, StandIn::Allocator<double> > doubles_;
+            std::vector<StandIn::String, StandIn::Allocator<StandIn::String> > strings_;
+            /// Type of every element of a mixed tuple, all three arrays then hold one entry per element
+            std::vector<HTupleType, StandIn::Allocator<HTupleType> > types_;
+    };
+
+
+    /**
+     * Tuple of iconic objects. Objects are reference counted and never modified once created, copies share them.
+     */
+    class HObject {
+        public:
+            HObject();
+            HObject(const HObject& other);
+            ~HObject();
+            HObject& operator=(const HObject& other);
+
+            bool IsInitialized() const;
+            Hlong CountObj() const;
+            void Clear();
+
+        protected:
+            friend class HImage;
+            friend class HRegion;
+            friend class HObjectModel3D;
+
+            void append(StandIn::Iconic* object);
+            const StandIn::Iconic& at(Hlong index) const;
+            const StandIn::Iconic& first(const char* proc_name) const;
+
+            std::vector<StandIn::Iconic*, StandIn::Allocator<StandIn::Iconic*> > objects_;
+    };
+
+    class HRegion : public HObject {
+        public:
+            HRegion();
+            HRegion(const HObject& object);
+
+            void GenRegionRuns(const HTuple& row, const HTuple& column_begin, const HTuple& column_end);
+            void GenRectangle1(double row1, double column1, double row2, double column2);
+            void GetRegionRuns(HTuple* row, HTuple* column_begin, HTuple* column_end) const;
+            Hlong Area() const;
+    };
+
+    class HImage : public HObject {
+        public:
+            HImage();
+            HImage(const HObject& object);
+
+            void GenImage1(const char* type, Hlong width, Hlong height, void* pixel_pointer);
+            void GenImage1Extern(const char* type, Hlong width, Hlong height, void* pixel_pointer, void* clear_proc);
+            void GenImage3Extern(const char* type, Hlong width, Hlong height, void* red, void* green, void* blue,
+                                 void* clear_proc);
+            void GenImageInterleaved(void* pixel_pointer, const char* color_format, Hlong original_width,
+                                     Hlong original_height, Hlong alignment, const char* type, Hlong image_width,
+                                     Hlong image_height, Hlong start_row, Hlong start_column, Hlong bits_per_channel,
+                                     Hlong bit_shift);
+
+            void* GetImagePointer1(HString* type, Hlong* width, Hlong* height) const;
+            void GetImagePointer3(void** red, void** green, void** blue, HString* type, Hlong* width, Hlong* height) const;
+
+            Hlong Width() const;
+            Hlong Height() const;
+            Hlong CountChannels() const;
+            HString GetImageType() const;
+
+            HImage AccessChannel(Hlong channel) const;
+            HImage Compose4(const HImage& image2, const HImage& image3, const HImage& image4) const;
+            HImage ReduceDomain(const HRegion& region) const;
+            HRegion GetDomain() const;
+            HImage ConcatObj(const HImage& other) const;
+            HImage SelectObj(Hlong index) const;
+    };
+
+
+    /**
+     * Handle of a 3D object model, copies share the model like HALCON handles do.
+     */
+    class HObjectModel3D {
+        public:
+            HObjectModel3D();
+            HObjectModel3D(const HTuple& x, const HTuple& y, const HTuple& z);
+            /// The points of all pixels in the domain of x, like xyz_to_object_model_3d
+            HObjectModel3D(const HImage& x, const HImage& y, const HImage& z);
+            HObjectModel3D(const HObjectModel3D& other);
+            ~HObjectModel3D();
+            HObjectModel3D& operator=(const HObjectModel3D& other);
+
+            HTuple GetObjectModel3dParams(const HTuple& param_name) const;
+            void SetObjectModel3dAttribMod(const HTuple& attrib_name, const HTuple& attach_ext_attrib_to,
+                                           const HTuple& attrib_values) const;
+            void Clear();
+
+        private:
+            StandIn::Model& model(const char* proc_name) const;
+
+            StandIn::Model* model_;
+    };
+
+}
+
+#endif
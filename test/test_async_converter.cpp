@@ -0,0 +1,217 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/async_converter.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    typedef halcon_bridge::AsyncConverter<int, int> IntConverter;
+
+    boost::shared_ptr<int const> makeMessage(int value) {
+        return boost::make_shared<int const>(value);
+    }
+
+    /**
+     * \brief Conversion that holds back the messages until the test opens it, and collects the delivered results.
+     */
+    class BlockingConversion {
+        public:
+            BlockingConversion() : open_(false), started_(0) {
+            }
+
+            boost::shared_ptr<int> convert(const int& message) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                started_++;
+                changed_.notify_all();
+                changed_.wait(lock, [this] { return open_; });
+                return boost::make_shared<int>(message * 10);
+            }
+
+            void deliver(const boost::shared_ptr<int>& result) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                results_.push_back(*result);
+            }
+
+            void waitForStart(int count) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [this, count] { return started_ >= count; });
+            }
+
+            void open() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                open_ = true;
+                changed_.notify_all();
+            }
+
+            std::vector<int> getResults() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return results_;
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable changed_;
+            bool open_;
+            int started_;
+            std::vector<int> results_;
+    };
+
+    halcon_bridge::AsyncConverterOptions createOptions(size_t queue_size, halcon_bridge::AsyncQueuePolicy policy) {
+        halcon_bridge::AsyncConverterOptions options;
+        options.queue_size = queue_size;
+        options.policy = policy;
+        options.threads = 1;
+        return options;
+    }
+
+}
+
+TEST(AsyncConverter, KeepLatestDropsTheOldestMessage) {
+    BlockingConversion conversion;
+    IntConverter converter(boost::bind(&BlockingConversion::convert, &conversion, _1),
+                           createOptions(1, halcon_bridge::KEEP_LATEST));
+    converter.setCallback(boost::bind(&BlockingConversion::deliver, &conversion, _1));
+
+    ASSERT_TRUE(converter.push(makeMessage(1)));
+    conversion.waitForStart(1);
+    // the queue holds one message, the next one replaces it
+    std::future<boost::shared_ptr<int> > dropped = converter.submit(makeMessage(2));
+    ASSERT_TRUE(converter.push(makeMessage(3)));
+    ASSERT_EQ(std::future_status::ready, dropped.wait_for(std::chrono::seconds(0)));
+    EXPECT_THROW(dropped.get(), halcon_bridge::Exception);
+
+    conversion.open();
+    converter.flush();
+    std::vector<int> results = conversion.getResults();
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(10, results[0]);
+    EXPECT_EQ(30, results[1]);
+
+    halcon_bridge::AsyncConverterStats stats = converter.getStats();
+    EXPECT_EQ(3u, stats.accepted);
+    EXPECT_EQ(2u, stats.delivered);
+    EXPECT_EQ(1u, stats.dropped);
+    EXPECT_EQ(0u, stats.failed);
+    EXPECT_EQ(0u, stats.queued);
+}
+
+TEST(AsyncConverter, KeepAllBlocksTheProducer) {
+    BlockingConversion conversion;
+    IntConverter converter(boost::bind(&BlockingConversion::convert, &conversion, _1),
+                           createOptions(1, halcon_bridge::KEEP_ALL));
+    converter.setCallback(boost::bind(&BlockingConversion::deliver, &conversion, _1));
+
+    ASSERT_TRUE(converter.push(makeMessage(1)));
+    conversion.waitForStart(1);
+    ASSERT_TRUE(converter.push(makeMessage(2)));
+    // the queue is full, the third message has to wait for room
+    std::atomic<bool> pushed(false);
+    std::thread producer([&] {
+        EXPECT_TRUE(converter.push(makeMessage(3)));
+        pushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(pushed);
+
+    conversion.open();
+    producer.join();
+    EXPECT_TRUE(pushed);
+    converter.flush();
+    std::vector<int> results = conversion.getResults();
+    ASSERT_EQ(3u, results.size());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(10 * (i + 1), results[i]);
+    }
+    EXPECT_EQ(0u, converter.getStats().dropped);
+}
+
+TEST(AsyncConverter, ReportsFailedConversions) {
+    IntConverter converter([](const int& message) -> boost::shared_ptr<int> {
+        if (message < 0) throw halcon_bridge::Exception("negative message");
+        return boost::make_shared<int>(message);
+    });
+    std::vector<std::string> errors;
+    converter.setErrorCallback([&](const boost::shared_ptr<int const>& message, const std::string& error) {
+        EXPECT_EQ(-1, *message);
+        errors.push_back(error);
+    });
+
+    ASSERT_TRUE(converter.push(makeMessage(-1)));
+    converter.flush();
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ("negative message", errors[0]);
+
+    std::future<boost::shared_ptr<int> > failed = converter.submit(makeMessage(-1));
+    EXPECT_THROW(failed.get(), halcon_bridge::Exception);
+    EXPECT_EQ(5, *converter.submit(makeMessage(5)).get());
+    EXPECT_EQ(2u, converter.getStats().failed);
+}
+
+TEST(AsyncConverter, FlushWaitsForEveryMessage) {
+    halcon_bridge::AsyncConverterOptions options = createOptions(16, halcon_bridge::KEEP_ALL);
+    options.threads = 3;
+    IntConverter converter([](const int& message) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return boost::make_shared<int>(message);
+    }, options);
+    std::atomic<int> delivered(0);
+    converter.setCallback([&](const boost::shared_ptr<int>&) { delivered++; });
+
+    for (int i = 0; i < 12; i++) {
+        ASSERT_TRUE(converter.push(makeMessage(i)));
+    }
+    converter.flush();
+    EXPECT_EQ(12, delivered);
+    EXPECT_EQ(12u, converter.getStats().delivered);
+    // an idle converter returns at once
+    converter.flush();
+}
+
+TEST(AsyncConverter, ShutsDownFromItsCallback) {
+    BlockingConversion conversion;
+    IntConverter converter(boost::bind(&BlockingConversion::convert, &conversion, _1),
+                           createOptions(2, halcon_bridge::KEEP_LATEST));
+    std::promise<void> stopped;
+    converter.setCallback([&](const boost::shared_ptr<int>&) {
+        converter.shutdown();
+        stopped.set_value();
+    });
+
+    ASSERT_TRUE(converter.push(makeMessage(1)));
+    conversion.waitForStart(1);
+    std::future<boost::shared_ptr<int> > queued = converter.submit(makeMessage(2));
+    conversion.open();
+
+    // the callback stops its own worker without waiting for itself, the queued message is dropped
+    ASSERT_EQ(std::future_status::ready, stopped.get_future().wait_for(std::chrono::seconds(10)));
+    EXPECT_THROW(queued.get(), halcon_bridge::Exception);
+    EXPECT_FALSE(converter.push(makeMessage(3)));
+    EXPECT_THROW(converter.submit(makeMessage(4)).get(), halcon_bridge::Exception);
+    EXPECT_EQ(1u, converter.getStats().dropped);
+}
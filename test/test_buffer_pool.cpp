@@ -0,0 +1,131 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/buffer_pool.h>
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include <asr_halcon_bridge/halcon_image.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <sensor_msgs/PointField.h>
+#include <sensor_msgs/image_encodings.h>
+#include <gtest/gtest.h>
+#include "allocation_counter.h"
+#include <string.h>
+
+namespace {
+
+    // Exports on the calling thread with the pool enabled, a parallel conversion allocates its job.
+    class BufferPool : public testing::Test {
+        protected:
+            virtual void SetUp() {
+                enabled_ = halcon_bridge::isBufferPoolEnabled();
+                threads_ = halcon_bridge::getConversionThreads();
+                halcon_bridge::setBufferPoolEnabled(true);
+                halcon_bridge::setConversionThreads(1);
+                halcon_bridge::clearBufferPools();
+            }
+
+            virtual void TearDown() {
+                halcon_bridge::setBufferPoolEnabled(enabled_);
+                halcon_bridge::setConversionThreads(threads_);
+            }
+
+            bool enabled_;
+            unsigned int threads_;
+    };
+
+    sensor_msgs::PointCloud2 createCloud(uint32_t width, uint32_t height) {
+        const char* names[] = { "x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature", "rgb" };
+        const uint32_t offsets[] = { 0, 4, 8, 16, 20, 24, 36, 32 };
+        sensor_msgs::PointCloud2 cloud;
+        cloud.header.frame_id = "sensor";
+        cloud.width = width;
+        cloud.height = height;
+        cloud.point_step = 48;
+        cloud.row_step = width * cloud.point_step;
+        for (int i = 0; i < 8; i++) {
+            sensor_msgs::PointField field;
+            field.name = names[i];
+            field.offset = offsets[i];
+            field.datatype = sensor_msgs::PointField::FLOAT32;
+            field.count = 1;
+            cloud.fields.push_back(field);
+        }
+        cloud.data.resize((size_t)cloud.row_step * height);
+        for (size_t point = 0; point < (size_t)width * height; point++) {
+            for (int i = 0; i < 7; i++) {
+                float value = (float)point + 0.25f * i;
+                memcpy(&cloud.data[point * cloud.point_step + offsets[i]], &value, sizeof(value));
+            }
+            uint32_t rgb = (uint32_t)(point * 2654435761u) & 0xffffff;
+            memcpy(&cloud.data[point * cloud.point_step + 32], &rgb, sizeof(rgb));
+        }
+        return cloud;
+    }
+
+}
+
+TEST_F(BufferPool, SteadyStatePointcloudExportsDoNotAllocate) {
+    const uint32_t sizes[][2] = { { 5000, 1 }, { 64, 48 } };
+    for (int s = 0; s < 2; s++) {
+        halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(createCloud(sizes[s][0], sizes[s][1]));
+        sensor_msgs::PointCloud2 reused;
+        for (int i = 0; i < 3; i++) {
+            pointcloud->toPointcloudMsg();
+            pointcloud->toPointcloudMsg(reused);
+        }
+
+        halcon_bridge::BufferPoolStats before = halcon_bridge::getPointcloudBufferPoolStats();
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (int i = 0; i < 10; i++) {
+            sensor_msgs::PointCloud2Ptr message = pointcloud->toPointcloudMsg();
+            pointcloud->toPointcloudMsg(reused);
+            ASSERT_EQ((size_t)message->row_step * message->height, message->data.size());
+        }
+        EXPECT_EQ(0u, halcon_bridge::test::getAllocationCount() - allocations) << sizes[s][0] << "x" << sizes[s][1];
+        halcon_bridge::BufferPoolStats after = halcon_bridge::getPointcloudBufferPoolStats();
+        EXPECT_EQ(before.misses, after.misses);
+        EXPECT_LT(before.hits, after.hits);
+    }
+}
+
+TEST_F(BufferPool, SteadyStateImageExportsDoNotAllocate) {
+    const char* encodings[] = { "mono8", "rgb8", "bgra8", "rgb16" };
+    for (int e = 0; e < 4; e++) {
+        sensor_msgs::Image source;
+        source.encoding = encodings[e];
+        source.width = 321;
+        source.height = 97;
+        source.step = source.width * sensor_msgs::image_encodings::numChannels(source.encoding) *
+                      (sensor_msgs::image_encodings::bitDepth(source.encoding) / 8);
+        source.data.assign((size_t)source.step * source.height, 7);
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(source);
+        for (int i = 0; i < 3; i++) {
+            image->toImageMsg();
+        }
+
+        halcon_bridge::BufferPoolStats before = halcon_bridge::getImageBufferPoolStats();
+        unsigned long allocations = halcon_bridge::test::getAllocationCount();
+        for (int i = 0; i < 10; i++) {
+            sensor_msgs::ImagePtr message = image->toImageMsg();
+            ASSERT_EQ((size_t)message->step * message->height, message->data.size());
+        }
+        EXPECT_EQ(0u, halcon_bridge::test::getAllocationCount() - allocations) << encodings[e];
+        halcon_bridge::BufferPoolStats after = halcon_bridge::getImageBufferPoolStats();
+        EXPECT_EQ(before.misses, after.misses);
+        EXPECT_LT(before.hits, after.hits);
+    }
+}
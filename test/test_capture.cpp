@@ -0,0 +1,238 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_capture.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <sensor_msgs/image_encodings.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    /**
+     * \brief Capture file in the temporary directory, removed with the object.
+     */
+    class TemporaryFile {
+        public:
+            TemporaryFile() {
+                char path[] = "/tmp/halcon_capture_testXXXXXX";
+                int fd = mkstemp(path);
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                path_ = path;
+            }
+
+            ~TemporaryFile() {
+                unlink(path_.c_str());
+            }
+
+            const std::string& path() const {
+                return path_;
+            }
+
+        private:
+            std::string path_;
+    };
+
+    sensor_msgs::Image createImage(const std::string& encoding, uint32_t width, uint32_t height, uint32_t seq) {
+        sensor_msgs::Image image;
+        image.header.frame_id = "camera";
+        image.header.seq = seq;
+        image.header.stamp = ros::Time(100 + seq, 250000000);
+        image.encoding = encoding;
+        image.width = width;
+        image.height = height;
+        image.is_bigendian = false;
+        image.step = width * enc::numChannels(encoding);
+        image.data.resize((size_t)image.step * height);
+        for (size_t i = 0; i < image.data.size(); i++) {
+            image.data[i] = (uint8_t)(i * 7 + seq);
+        }
+        return image;
+    }
+
+    void expectSameImage(const HalconCpp::HImage& expected, const HalconCpp::HImage& actual) {
+        ASSERT_EQ(expected.CountChannels(), actual.CountChannels());
+        ASSERT_EQ(expected.GetDomain().Area(), actual.GetDomain().Area());
+        for (Hlong channel = 1; channel <= expected.CountChannels(); channel++) {
+            HalconCpp::HString expected_type, actual_type;
+            Hlong expected_width, expected_height, actual_width, actual_height;
+            const uint8_t* expected_pixels = (const uint8_t*)expected.AccessChannel(channel).GetImagePointer1(
+                        &expected_type, &expected_width, &expected_height);
+            const uint8_t* actual_pixels = (const uint8_t*)actual.AccessChannel(channel).GetImagePointer1(
+                        &actual_type, &actual_width, &actual_height);
+            ASSERT_EQ(expected_type, actual_type);
+            ASSERT_EQ(expected_width, actual_width);
+            ASSERT_EQ(expected_height, actual_height);
+            EXPECT_EQ(0, memcmp(expected_pixels, actual_pixels, expected_width * expected_height)) << "channel " << channel;
+        }
+    }
+
+    void addField(sensor_msgs::PointCloud2& cloud, const std::string& name, uint32_t offset) {
+        sensor_msgs::PointField field;
+        field.name = name;
+        field.offset = offset;
+        field.datatype = sensor_msgs::PointField::FLOAT32;
+        field.count = 1;
+        cloud.fields.push_back(field);
+    }
+
+    // x, y, z, normal_x, normal_y, normal_z, curvature, intensity, every third point has no x
+    sensor_msgs::PointCloud2 createCloud(uint32_t width, uint32_t height) {
+        sensor_msgs::PointCloud2 cloud;
+        cloud.header.frame_id = "sensor";
+        cloud.header.stamp = ros::Time(7, 0);
+        cloud.width = width;
+        cloud.height = height;
+        cloud.is_bigendian = false;
+        cloud.is_dense = false;
+        cloud.point_step = 32;
+        cloud.row_step = width * cloud.point_step;
+        const char* names[] = { "x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature", "intensity" };
+        for (uint32_t i = 0; i < 8; i++) {
+            addField(cloud, names[i], 4 * i);
+        }
+        cloud.data.resize((size_t)cloud.row_step * height);
+        float* values = (float*)&cloud.data[0];
+        for (size_t point = 0; point < (size_t)width * height; point++) {
+            for (size_t i = 0; i < 8; i++) {
+                values[8 * point + i] = (float)point + 0.125f * i;
+            }
+            if (point % 3 == 0) {
+                values[8 * point] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+        return cloud;
+    }
+
+    void expectSameModel(const HalconCpp::HObjectModel3D& expected, const HalconCpp::HObjectModel3D& actual) {
+        const char* names[] = { "point_coord_x", "point_coord_y", "point_coord_z", "point_normal_x", "point_normal_y",
+                                "point_normal_z", "&curvature", "&intensity" };
+        for (int i = 0; i < 8; i++) {
+            HalconCpp::HTuple expected_values = expected.GetObjectModel3dParams(names[i]);
+            HalconCpp::HTuple actual_values = actual.GetObjectModel3dParams(names[i]);
+            ASSERT_EQ(expected_values.Length(), actual_values.Length()) << names[i];
+            for (Hlong point = 0; point < expected_values.Length(); point++) {
+                float expected_value = (float)(double)expected_values[point];
+                float actual_value = (float)(double)actual_values[point];
+                if (std::isnan(expected_value)) {
+                    ASSERT_TRUE(std::isnan(actual_value)) << names[i] << " of point " << point;
+                } else {
+                    ASSERT_EQ(expected_value, actual_value) << names[i] << " of point " << point;
+                }
+            }
+        }
+    }
+
+}
+
+TEST(HalconCapture, ReplaysImagesWithTheirDomain) {
+    TemporaryFile file;
+    halcon_bridge::HalconImagePtr mono = halcon_bridge::toHalconCopy(createImage(enc::MONO8, 13, 7, 1));
+    halcon_bridge::HalconImagePtr color = halcon_bridge::toHalconCopy(createImage(enc::RGB8, 9, 5, 2));
+    HalconCpp::HRegion domain;
+    domain.GenRectangle1(1, 2, 4, 6);
+    *color->image = color->image->ReduceDomain(domain);
+    {
+        halcon_bridge::HalconCaptureWriter writer(file.path());
+        writer.write(*mono);
+        writer.write(*color);
+        EXPECT_EQ(2u, writer.size());
+    }
+
+    halcon_bridge::HalconCaptureReader reader(file.path());
+    ASSERT_EQ(2u, reader.size());
+    const halcon_bridge::HalconImage* expected[] = { mono.get(), color.get() };
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(halcon_bridge::CAPTURE_IMAGE, reader.getType(i));
+        halcon_bridge::HalconImageConstPtr image = reader.readImage(i);
+        EXPECT_EQ(expected[i]->header.frame_id, image->header.frame_id);
+        EXPECT_EQ(expected[i]->header.seq, image->header.seq);
+        EXPECT_TRUE(expected[i]->header.stamp == image->header.stamp);
+        EXPECT_EQ(expected[i]->encoding, image->encoding);
+        expectSameImage(*expected[i]->image, *image->image);
+    }
+    EXPECT_EQ(20, reader.readImage(1)->image->GetDomain().Area());
+    EXPECT_THROW(reader.readPointcloud(0), halcon_bridge::Exception);
+}
+
+TEST(HalconCapture, ReplaysPointcloudsWithTheirAttributes) {
+    TemporaryFile file;
+    halcon_bridge::HalconPointcloudPtr unorganized = halcon_bridge::toHalconCopy(createCloud(20, 1));
+    halcon_bridge::HalconPointcloudPtr organized = halcon_bridge::toHalconCopy(createCloud(6, 4));
+    {
+        halcon_bridge::HalconCaptureWriter writer(file.path());
+        writer.write(*unorganized);
+        writer.write(*organized);
+    }
+
+    halcon_bridge::HalconCaptureReader reader(file.path());
+    ASSERT_EQ(2u, reader.size());
+    halcon_bridge::HalconPointcloudConstPtr points = reader.readPointcloud(0);
+    EXPECT_EQ("sensor", points->header.frame_id);
+    EXPECT_FALSE(points->x_image.IsInitialized());
+    expectSameModel(*unorganized->model, *points->model);
+
+    halcon_bridge::HalconPointcloudConstPtr grid = reader.readPointcloud(1);
+    ASSERT_TRUE(grid->x_image.IsInitialized());
+    EXPECT_EQ(6, grid->x_image.Width());
+    EXPECT_EQ(4, grid->x_image.Height());
+    EXPECT_EQ(16, grid->x_image.GetDomain().Area());
+    expectSameModel(*organized->model, *grid->model);
+
+    // the replayed grid is exported like the original one, including its invalid cells
+    sensor_msgs::PointCloud2Ptr expected = organized->toPointcloudMsg();
+    sensor_msgs::PointCloud2Ptr actual = grid->toPointcloudMsg();
+    ASSERT_EQ(expected->fields.size(), actual->fields.size());
+    ASSERT_EQ(expected->data.size(), actual->data.size());
+    EXPECT_EQ(0, memcmp(&expected->data[0], &actual->data[0], expected->data.size()));
+}
+
+TEST(HalconCapture, SeeksToStamps) {
+    TemporaryFile file;
+    {
+        halcon_bridge::HalconCaptureWriter writer(file.path());
+        // written out of order, e.g. from two topics
+        const uint32_t seqs[] = { 0, 2, 1, 3, 5, 4, 6, 7 };
+        for (size_t i = 0; i < 8; i++) {
+            writer.write(*halcon_bridge::toHalconCopy(createImage(enc::MONO8, 4, 4, seqs[i])));
+        }
+    }
+
+    halcon_bridge::HalconCaptureReader reader(file.path());
+    ASSERT_EQ(8u, reader.size());
+    for (size_t i = 0; i < 8; i++) {
+        EXPECT_TRUE(ros::Time(100 + i, 250000000) == reader.getStamp(i)) << "record " << i;
+        EXPECT_EQ(i, reader.readImage(i)->header.seq);
+    }
+    EXPECT_EQ(0u, reader.seek(ros::Time(0, 0)));
+    EXPECT_EQ(0u, reader.seek(ros::Time(100, 250000000)));
+    EXPECT_EQ(3u, reader.seek(ros::Time(103, 250000000)));
+    EXPECT_EQ(4u, reader.seek(ros::Time(103, 250000001)));
+    EXPECT_EQ(7u, reader.seek(ros::Time(107, 0)));
+    EXPECT_EQ(8u, reader.seek(ros::Time(108, 0)));
+}
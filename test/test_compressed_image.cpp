@@ -0,0 +1,319 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_compressed_image.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <sensor_msgs/image_encodings.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+#include <png.h>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    /**
+     * \brief Packed pixels of a test image, 16 bit samples are stored in host byte order.
+     */
+    struct Pixels {
+        size_t width;
+        size_t height;
+        int channels;
+        int type_size;
+        std::vector<uint8_t> data;
+
+        size_t getSample(size_t row, size_t column, int channel) const {
+            size_t index = (row * width + column) * channels + channel;
+            if (type_size == 1) return data[index];
+            uint16_t value;
+            memcpy(&value, &data[2 * index], sizeof(value));
+            return value;
+        }
+    };
+
+    // smooth gradients, so JPEG reproduces them closely
+    Pixels createPixels(size_t width, size_t height, int channels, int type_size) {
+        Pixels pixels = { width, height, channels, type_size, std::vector<uint8_t>(width * height * channels * type_size) };
+        for (size_t row = 0; row < height; row++) {
+            for (size_t column = 0; column < width; column++) {
+                for (int channel = 0; channel < channels; channel++) {
+                    size_t value = 20 + 2 * column + 2 * row + 40 * channel;
+                    size_t index = (row * width + column) * channels + channel;
+                    if (type_size == 1) {
+                        pixels.data[index] = (uint8_t)value;
+                    } else {
+                        uint16_t sample = (uint16_t)(value * 251 + 7);
+                        memcpy(&pixels.data[2 * index], &sample, sizeof(sample));
+                    }
+                }
+            }
+        }
+        return pixels;
+    }
+
+    sensor_msgs::CompressedImage createMessage(const std::vector<uint8_t>& data, const std::string& format) {
+        sensor_msgs::CompressedImage message;
+        message.header.frame_id = "camera";
+        message.header.seq = 3;
+        message.format = format;
+        message.data = data;
+        return message;
+    }
+
+    std::vector<uint8_t> encodeJpeg(const Pixels& pixels, int quality) {
+        jpeg_compress_struct info;
+        jpeg_error_mgr error;
+        info.err = jpeg_std_error(&error);
+        jpeg_create_compress(&info);
+        unsigned char* buffer = NULL;
+        unsigned long size = 0;
+        jpeg_mem_dest(&info, &buffer, &size);
+        info.image_width = pixels.width;
+        info.image_height = pixels.height;
+        info.input_components = pixels.channels;
+        info.in_color_space = (pixels.channels == 1) ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_set_defaults(&info);
+        jpeg_set_quality(&info, quality, TRUE);
+        jpeg_start_compress(&info, TRUE);
+        for (size_t row = 0; row < pixels.height; row++) {
+            JSAMPROW row_pointer = const_cast<uint8_t*>(&pixels.data[row * pixels.width * pixels.channels]);
+            jpeg_write_scanlines(&info, &row_pointer, 1);
+        }
+        jpeg_finish_compress(&info);
+        std::vector<uint8_t> data(buffer, buffer + size);
+        jpeg_destroy_compress(&info);
+        free(buffer);
+        return data;
+    }
+
+    Pixels decodeJpeg(const std::vector<uint8_t>& data, unsigned int scale_denominator = 1) {
+        jpeg_decompress_struct info;
+        jpeg_error_mgr error;
+        info.err = jpeg_std_error(&error);
+        jpeg_create_decompress(&info);
+        jpeg_mem_src(&info, const_cast<uint8_t*>(&data[0]), data.size());
+        jpeg_read_header(&info, TRUE);
+        info.scale_num = 1;
+        info.scale_denom = scale_denominator;
+        jpeg_start_decompress(&info);
+        Pixels pixels = { info.output_width, info.output_height, info.output_components, 1, std::vector<uint8_t>() };
+        pixels.data.resize(pixels.width * pixels.height * pixels.channels);
+        while (info.output_scanline < info.output_height) {
+            JSAMPROW row_pointer = &pixels.data[info.output_scanline * pixels.width * pixels.channels];
+            jpeg_read_scanlines(&info, &row_pointer, 1);
+        }
+        jpeg_finish_decompress(&info);
+        jpeg_destroy_decompress(&info);
+        return pixels;
+    }
+
+    void appendPngData(png_structp png, png_bytep src, png_size_t length) {
+        std::vector<uint8_t>* data = (std::vector<uint8_t>*)png_get_io_ptr(png);
+        data->insert(data->end(), src, src + length);
+    }
+
+    void flushPngData(png_structp) {
+    }
+
+    std::vector<uint8_t> encodePng(const Pixels& pixels, bool interlaced = false) {
+        std::vector<uint8_t> data;
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        png_infop info = png_create_info_struct(png);
+        png_set_write_fn(png, &data, appendPngData, flushPngData);
+        png_set_IHDR(png, info, pixels.width, pixels.height, 8 * pixels.type_size,
+                     (pixels.channels == 1) ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB,
+                     interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        if (pixels.type_size == 2) png_set_swap(png);
+        std::vector<png_bytep> rows(pixels.height);
+        for (size_t row = 0; row < pixels.height; row++) {
+            rows[row] = const_cast<uint8_t*>(&pixels.data[row * pixels.width * pixels.channels * pixels.type_size]);
+        }
+        png_write_image(png, &rows[0]);
+        png_write_end(png, NULL);
+        png_destroy_write_struct(&png, &info);
+        return data;
+    }
+
+    struct PngSource {
+        const std::vector<uint8_t>* data;
+        size_t offset;
+    };
+
+    void readPngData(png_structp png, png_bytep dst, png_size_t length) {
+        PngSource* source = (PngSource*)png_get_io_ptr(png);
+        memcpy(dst, &(*source->data)[source->offset], length);
+        source->offset += length;
+    }
+
+    Pixels decodePng(const std::vector<uint8_t>& data) {
+        png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        png_infop info = png_create_info_struct(png);
+        PngSource source = { &data, 0 };
+        png_set_read_fn(png, &source, readPngData);
+        png_read_info(png, info);
+        if (png_get_bit_depth(png, info) == 16) png_set_swap(png);
+        png_read_update_info(png, info);
+        Pixels pixels = { png_get_image_width(png, info), png_get_image_height(png, info), png_get_channels(png, info),
+                          png_get_bit_depth(png, info) / 8, std::vector<uint8_t>() };
+        pixels.data.resize(pixels.width * pixels.height * pixels.channels * pixels.type_size);
+        std::vector<png_bytep> rows(pixels.height);
+        for (size_t row = 0; row < pixels.height; row++) {
+            rows[row] = &pixels.data[row * pixels.width * pixels.channels * pixels.type_size];
+        }
+        png_read_image(png, &rows[0]);
+        png_read_end(png, NULL);
+        png_destroy_read_struct(&png, &info, NULL);
+        return pixels;
+    }
+
+    // Compare the planes of a decoded image with every step-th pixel of the expected pixels
+    void expectPixels(const Pixels& expected, const halcon_bridge::HalconImage& actual, size_t step = 1) {
+        const HalconCpp::HImage& image = *actual.image;
+        ASSERT_EQ((Hlong)expected.channels, image.CountChannels());
+        ASSERT_EQ((Hlong)((expected.width + step - 1) / step), image.Width());
+        ASSERT_EQ((Hlong)((expected.height + step - 1) / step), image.Height());
+        for (int channel = 0; channel < expected.channels; channel++) {
+            HalconCpp::HString type;
+            Hlong width, height;
+            const uint8_t* plane = (const uint8_t*)image.AccessChannel(channel + 1).GetImagePointer1(&type, &width, &height);
+            ASSERT_EQ(HalconCpp::HString((expected.type_size == 1) ? "byte" : "uint2"), type);
+            for (Hlong row = 0; row < height; row++) {
+                for (Hlong column = 0; column < width; column++) {
+                    size_t value = (expected.type_size == 1) ? plane[row * width + column] :
+                                                               ((const uint16_t*)plane)[row * width + column];
+                    ASSERT_EQ(expected.getSample(row * step, column * step, channel), value)
+                            << "channel " << channel << ", row " << row << ", column " << column;
+                }
+            }
+        }
+    }
+
+    halcon_bridge::HalconImagePtr toHalcon(const Pixels& pixels, const std::string& encoding) {
+        sensor_msgs::Image message;
+        message.header.frame_id = "camera";
+        message.encoding = encoding;
+        message.width = pixels.width;
+        message.height = pixels.height;
+        message.is_bigendian = false;
+        message.step = pixels.width * pixels.channels * pixels.type_size;
+        message.data = pixels.data;
+        return halcon_bridge::toHalconCopy(message);
+    }
+
+}
+
+TEST(CompressedImageConversion, DecodesJpeg) {
+    const int channels[] = { 1, 3 };
+    for (int i = 0; i < 2; i++) {
+        std::vector<uint8_t> data = encodeJpeg(createPixels(40, 27, channels[i], 1), 90);
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createMessage(data, "jpeg"));
+        EXPECT_EQ("camera", image->header.frame_id);
+        EXPECT_EQ(3u, image->header.seq);
+        EXPECT_EQ((channels[i] == 1) ? enc::MONO8 : enc::RGB8, image->encoding);
+        // the same decoder without the bridge
+        expectPixels(decodeJpeg(data), *image);
+    }
+}
+
+TEST(CompressedImageConversion, DecodesJpegAtReducedScale) {
+    std::vector<uint8_t> data = encodeJpeg(createPixels(40, 27, 3, 1), 90);
+    const unsigned int denominators[] = { 2, 4, 8 };
+    for (int i = 0; i < 3; i++) {
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createMessage(data, "jpeg"), denominators[i]);
+        Pixels expected = decodeJpeg(data, denominators[i]);
+        EXPECT_EQ((40 + denominators[i] - 1) / denominators[i], expected.width);
+        expectPixels(expected, *image);
+    }
+    EXPECT_THROW(halcon_bridge::toHalconCopy(createMessage(data, "jpeg"), 3), halcon_bridge::Exception);
+}
+
+TEST(CompressedImageConversion, DecodesPng) {
+    const int channels[] = { 1, 3 };
+    const char* encodings[][2] = { { enc::MONO8.c_str(), enc::RGB8.c_str() }, { enc::MONO16.c_str(), enc::RGB16.c_str() } };
+    for (int type_size = 1; type_size <= 2; type_size++) {
+        for (int i = 0; i < 2; i++) {
+            Pixels pixels = createPixels(37, 21, channels[i], type_size);
+            halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(createMessage(encodePng(pixels), "png"));
+            EXPECT_EQ(encodings[type_size - 1][i], image->encoding);
+            expectPixels(pixels, *image);
+
+            // interlaced images and reduced scales keep every n-th pixel of every n-th row
+            expectPixels(pixels, *halcon_bridge::toHalconCopy(createMessage(encodePng(pixels, true), "png")));
+            expectPixels(pixels, *halcon_bridge::toHalconCopy(createMessage(encodePng(pixels), "png"), 4), 4);
+            expectPixels(pixels, *halcon_bridge::toHalconCopy(createMessage(encodePng(pixels, true), "png"), 2), 2);
+        }
+    }
+}
+
+TEST(CompressedImageConversion, RejectsOtherFormats) {
+    std::vector<uint8_t> data(64, 0x42);
+    EXPECT_THROW(halcon_bridge::toHalconCopy(createMessage(data, "bmp")), halcon_bridge::Exception);
+    std::vector<uint8_t> truncated = encodePng(createPixels(16, 16, 3, 1));
+    truncated.resize(truncated.size() / 2);
+    EXPECT_THROW(halcon_bridge::toHalconCopy(createMessage(truncated, "png")), halcon_bridge::Exception);
+}
+
+TEST(CompressedImageConversion, EncodesPng) {
+    const char* encodings[] = { "mono8", "rgb8", "mono16", "rgb16" };
+    const char* formats[] = { "mono8; png compressed mono8", "rgb8; png compressed bgr8",
+                              "mono16; png compressed mono16", "rgb16; png compressed bgr16" };
+    for (int i = 0; i < 4; i++) {
+        Pixels pixels = createPixels(33, 18, (i % 2) ? 3 : 1, (i < 2) ? 1 : 2);
+        halcon_bridge::HalconImagePtr image = toHalcon(pixels, encodings[i]);
+        image->header.seq = 11;
+        sensor_msgs::CompressedImagePtr message = halcon_bridge::toCompressedImageMsg(*image, "png", 6);
+        EXPECT_EQ(formats[i], message->format);
+        EXPECT_EQ(11u, message->header.seq);
+        Pixels decoded = decodePng(message->data);
+        EXPECT_EQ(pixels.channels, decoded.channels);
+        EXPECT_EQ(pixels.type_size, decoded.type_size);
+        EXPECT_TRUE(pixels.data == decoded.data) << encodings[i];
+    }
+}
+
+TEST(CompressedImageConversion, EncodesJpeg) {
+    for (int channels = 1; channels <= 3; channels += 2) {
+        Pixels pixels = createPixels(40, 27, channels, 1);
+        halcon_bridge::HalconImagePtr image = toHalcon(pixels, (channels == 1) ? enc::MONO8 : enc::RGB8);
+        sensor_msgs::CompressedImage message;
+        halcon_bridge::toCompressedImageMsg(*image, message, "jpeg", 95);
+        EXPECT_EQ((channels == 1) ? "mono8; jpeg compressed mono8" : "rgb8; jpeg compressed bgr8", message.format);
+        Pixels decoded = decodeJpeg(message.data);
+        ASSERT_EQ(pixels.data.size(), decoded.data.size());
+        int max_error = 0;
+        for (size_t i = 0; i < pixels.data.size(); i++) {
+            max_error = std::max(max_error, std::abs((int)pixels.data[i] - (int)decoded.data[i]));
+        }
+        EXPECT_LE(max_error, 6);
+    }
+
+    // JPEG has no 16 bit images, and an image without pixels cannot be encoded
+    halcon_bridge::HalconImagePtr deep = toHalcon(createPixels(8, 8, 1, 2), enc::MONO16);
+    EXPECT_THROW(halcon_bridge::toCompressedImageMsg(*deep, "jpeg"), halcon_bridge::Exception);
+    EXPECT_THROW(halcon_bridge::toCompressedImageMsg(*deep, "webp"), halcon_bridge::Exception);
+    halcon_bridge::HalconImage empty;
+    EXPECT_THROW(halcon_bridge::toCompressedImageMsg(empty, "png"), halcon_bridge::Exception);
+}
@@ -0,0 +1,164 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include <asr_halcon_bridge/conversion_stats.h>
+#include "instrumentation.h"
+#include "parallel_for.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    class ConversionScheduler : public testing::Test {
+        protected:
+            virtual void SetUp() {
+                threads_ = halcon_bridge::getConversionThreads();
+                threshold_ = halcon_bridge::getParallelConversionThreshold();
+                halcon_bridge::setConversionThreads(4);
+                halcon_bridge::setParallelConversionThreshold(0);
+            }
+
+            virtual void TearDown() {
+                halcon_bridge::setConversionThreads(threads_);
+                halcon_bridge::setParallelConversionThreshold(threshold_);
+            }
+
+            unsigned int threads_;
+            size_t threshold_;
+    };
+
+}
+
+TEST_F(ConversionScheduler, CoversEveryItemOnce) {
+    const size_t counts[] = { 0, 1, 2, 3, 15, 16, 17, 1000, 100003 };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        std::vector<std::atomic<int> > visits(counts[i]);
+        for (size_t j = 0; j < counts[i]; j++) visits[j] = 0;
+        halcon_bridge::parallelFor(counts[i], counts[i], [&](size_t begin, size_t end) {
+            EXPECT_LE(begin, end);
+            for (size_t j = begin; j < end; j++) visits[j]++;
+        });
+        for (size_t j = 0; j < counts[i]; j++) {
+            ASSERT_EQ(1, visits[j]) << "item " << j << " of " << counts[i];
+        }
+    }
+}
+
+TEST_F(ConversionScheduler, RunsTheFirstConversionOnTheWorkers) {
+    // every conversion after a thread count change starts new workers
+    for (int i = 0; i < 20; i++) {
+        halcon_bridge::setConversionThreads(4);
+        std::thread::id caller = std::this_thread::get_id();
+        std::atomic<int> workers(0);
+        halcon_bridge::parallelFor(16, 16, [&](size_t begin, size_t end) {
+            if (std::this_thread::get_id() != caller) workers++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        });
+        ASSERT_LT(0, workers) << "conversion " << i;
+    }
+}
+
+TEST_F(ConversionScheduler, RunsSmallConversionsOnTheCallingThread) {
+    halcon_bridge::setParallelConversionThreshold(1 << 20);
+    std::thread::id caller = std::this_thread::get_id();
+    int calls = 0;
+    halcon_bridge::parallelFor(1000, 1000, [&](size_t begin, size_t end) {
+        EXPECT_EQ(caller, std::this_thread::get_id());
+        EXPECT_EQ(0u, begin);
+        EXPECT_EQ(1000u, end);
+        calls++;
+    });
+    EXPECT_EQ(1, calls);
+}
+
+TEST_F(ConversionScheduler, ChangesThreadCount) {
+    for (unsigned int threads = 1; threads <= 3; threads++) {
+        halcon_bridge::setConversionThreads(threads);
+        EXPECT_EQ(threads, halcon_bridge::getConversionThreads());
+        std::atomic<size_t> sum(0);
+        halcon_bridge::parallelFor(500, 500, [&](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; j++) sum += j;
+        });
+        EXPECT_EQ(500u * 499u / 2u, sum);
+    }
+}
+
+TEST_F(ConversionScheduler, RethrowsTheFirstExceptionAfterAllChunks) {
+    const size_t failing[] = { 0, 499, 999 };
+    for (size_t i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+        std::atomic<int> running(0);
+        EXPECT_THROW(halcon_bridge::parallelFor(1000, 1000, [&](size_t begin, size_t end) {
+            running++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            running--;
+            if ((begin <= failing[i]) && (failing[i] < end)) throw std::out_of_range("item");
+        }), std::out_of_range);
+        // no chunk may still use the body once parallelFor has returned
+        EXPECT_EQ(0, running);
+    }
+
+    std::atomic<size_t> sum(0);
+    halcon_bridge::parallelFor(500, 500, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; j++) sum += j;
+    });
+    EXPECT_EQ(500u * 499u / 2u, sum);
+}
+
+TEST_F(ConversionScheduler, RunsNestedConversionsInline) {
+    std::vector<std::atomic<int> > visits(100 * 100);
+    for (size_t j = 0; j < visits.size(); j++) visits[j] = 0;
+    halcon_bridge::parallelFor(100, 100, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            std::thread::id outer = std::this_thread::get_id();
+            halcon_bridge::parallelFor(100, 100, [&](size_t column_begin, size_t column_end) {
+                EXPECT_EQ(outer, std::this_thread::get_id());
+                for (size_t column = column_begin; column < column_end; column++) visits[row * 100 + column]++;
+            });
+        }
+    });
+    for (size_t j = 0; j < visits.size(); j++) {
+        ASSERT_EQ(1, visits[j]) << "item " << j;
+    }
+}
+
+TEST_F(ConversionScheduler, CountsAllocationsOfWorkersForTheCaller) {
+    halcon_bridge::resetConversionStats();
+    std::atomic<int> workers(0);
+    std::thread::id caller = std::this_thread::get_id();
+    {
+        halcon_bridge::ScopedConversionTimer timer(halcon_bridge::IMAGE_BATCH_TO_HALCON);
+        halcon_bridge::parallelFor(1000, 1000, [&](size_t begin, size_t end) {
+            if (std::this_thread::get_id() != caller) workers++;
+            for (size_t j = begin; j < end; j++) halcon_bridge::ScopedConversionTimer::addAllocation();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+    // nothing is left attributed to the timer once it is gone
+    halcon_bridge::parallelFor(1000, 1000, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; j++) halcon_bridge::ScopedConversionTimer::addAllocation();
+    });
+
+    EXPECT_LT(0, workers);
+    EXPECT_EQ(1000u, halcon_bridge::getConversionStats(halcon_bridge::IMAGE_BATCH_TO_HALCON).allocations);
+    halcon_bridge::resetConversionStats();
+}
@@ -0,0 +1,197 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_depth_image.h>
+#include <sensor_msgs/image_encodings.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <cmath>
+#include <vector>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    const uint32_t WIDTH = 8;
+    const uint32_t HEIGHT = 6;
+
+    // 16UC1 depth in millimeters, every fifth pixel has no measurement
+    sensor_msgs::Image createDepth() {
+        sensor_msgs::Image depth;
+        depth.header.frame_id = "camera_depth_optical_frame";
+        depth.encoding = enc::TYPE_16UC1;
+        depth.width = WIDTH;
+        depth.height = HEIGHT;
+        depth.is_bigendian = false;
+        depth.step = WIDTH * sizeof(uint16_t);
+        depth.data.resize((size_t)depth.step * HEIGHT);
+        for (size_t i = 0; i < (size_t)WIDTH * HEIGHT; i++) {
+            uint16_t value = (i % 5 == 0) ? 0 : (uint16_t)(500 + 10 * i);
+            memcpy(&depth.data[2 * i], &value, sizeof(value));
+        }
+        return depth;
+    }
+
+    float getDepth(const sensor_msgs::Image& depth, size_t pixel) {
+        uint16_t value;
+        memcpy(&value, &depth.data[2 * pixel], sizeof(value));
+        return value * 0.001f;
+    }
+
+    // K and P differ, so the tests can tell which of them was used
+    sensor_msgs::CameraInfo createInfo() {
+        sensor_msgs::CameraInfo info;
+        info.width = WIDTH;
+        info.height = HEIGHT;
+        info.K[0] = 4.0;
+        info.K[2] = 3.5;
+        info.K[4] = 4.0;
+        info.K[5] = 2.5;
+        info.K[8] = 1.0;
+        info.P[0] = 5.0;
+        info.P[2] = 3.0;
+        info.P[5] = 5.0;
+        info.P[6] = 2.0;
+        info.P[10] = 1.0;
+        info.distortion_model = "plumb_bob";
+        info.D.assign(5, 0.0);
+        return info;
+    }
+
+    const float* getPixels(const HalconCpp::HImage& image) {
+        HalconCpp::HString type;
+        Hlong width, height;
+        const float* pixels = (const float*)image.GetImagePointer1(&type, &width, &height);
+        EXPECT_EQ(HalconCpp::HString("real"), type);
+        EXPECT_EQ((Hlong)WIDTH, width);
+        EXPECT_EQ((Hlong)HEIGHT, height);
+        return pixels;
+    }
+
+    // Apply the plumb_bob model to a normalized ray, the inverse of what the conversion does
+    void distort(const std::vector<double>& d, double x, double y, double& distorted_x, double& distorted_y) {
+        double r2 = x * x + y * y;
+        double radial = 1.0 + (d[0] + (d[1] + d[4] * r2) * r2) * r2;
+        distorted_x = x * radial + 2.0 * d[2] * x * y + d[3] * (r2 + 2.0 * x * x);
+        distorted_y = y * radial + d[2] * (r2 + 2.0 * y * y) + 2.0 * d[3] * x * y;
+    }
+
+    // Check the points against the pinhole model with focal length f and principal point (cx, cy)
+    void expectPinholePoints(const sensor_msgs::Image& depth, const halcon_bridge::HalconPointcloud& pointcloud,
+                             double f, double cx, double cy) {
+        const float* x = getPixels(pointcloud.x_image);
+        const float* y = getPixels(pointcloud.y_image);
+        const float* z = getPixels(pointcloud.z_image);
+        for (size_t row = 0; row < HEIGHT; row++) {
+            for (size_t column = 0; column < WIDTH; column++) {
+                size_t pixel = row * WIDTH + column;
+                if (pixel % 5 == 0) continue;
+                float expected_z = getDepth(depth, pixel);
+                ASSERT_FLOAT_EQ(expected_z, z[pixel]) << "pixel " << pixel;
+                ASSERT_NEAR((column - cx) / f * expected_z, x[pixel], 1e-5) << "pixel " << pixel;
+                ASSERT_NEAR((row - cy) / f * expected_z, y[pixel], 1e-5) << "pixel " << pixel;
+            }
+        }
+    }
+
+}
+
+TEST(DepthConversion, LeavesOutPixelsWithoutDepth) {
+    sensor_msgs::Image depth = createDepth();
+    halcon_bridge::CameraRayCache ray_cache;
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconPointcloud(depth, createInfo(), ray_cache);
+    EXPECT_EQ(depth.header.frame_id, pointcloud->header.frame_id);
+
+    size_t valid = WIDTH * HEIGHT - (WIDTH * HEIGHT + 4) / 5;
+    EXPECT_EQ((Hlong)valid, pointcloud->z_image.GetDomain().Area());
+    ASSERT_TRUE(pointcloud->model != NULL);
+    ASSERT_EQ((Hlong)valid, (Hlong)pointcloud->model->GetObjectModel3dParams("num_points")[0]);
+    HalconCpp::HTuple rows = pointcloud->model->GetObjectModel3dParams("mapping_row");
+    HalconCpp::HTuple cols = pointcloud->model->GetObjectModel3dParams("mapping_col");
+    HalconCpp::HTuple z = pointcloud->model->GetObjectModel3dParams("point_coord_z");
+    for (Hlong i = 0; i < rows.Length(); i++) {
+        size_t pixel = (Hlong)rows[i] * WIDTH + (Hlong)cols[i];
+        ASSERT_NE(0u, pixel % 5) << "point " << i;
+        ASSERT_FLOAT_EQ(getDepth(depth, pixel), (float)(double)z[i]) << "point " << i;
+    }
+
+    halcon_bridge::DepthConversionOptions options;
+    options.model = false;
+    pointcloud = halcon_bridge::toHalconPointcloud(depth, createInfo(), ray_cache, options);
+    EXPECT_TRUE(pointcloud->model == NULL);
+    EXPECT_EQ((Hlong)valid, pointcloud->x_image.GetDomain().Area());
+}
+
+TEST(DepthConversion, RecomputesRaysWhenCalibrationChanges) {
+    sensor_msgs::Image depth = createDepth();
+    sensor_msgs::CameraInfo info = createInfo();
+    halcon_bridge::CameraRayCache ray_cache;
+
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconPointcloud(depth, info, ray_cache);
+    expectPinholePoints(depth, *pointcloud, 5.0, 3.0, 2.0);
+    boost::shared_ptr<const halcon_bridge::CameraRayCache::Rays> rays = ray_cache.getRays(info, WIDTH, HEIGHT, true);
+    EXPECT_EQ(rays, ray_cache.getRays(info, WIDTH, HEIGHT, true));
+
+    // a new calibration of the same camera
+    info.P[0] = info.P[5] = 2.0;
+    info.P[2] = 4.0;
+    pointcloud = halcon_bridge::toHalconPointcloud(depth, info, ray_cache);
+    expectPinholePoints(depth, *pointcloud, 2.0, 4.0, 2.0);
+    EXPECT_NE(rays, ray_cache.getRays(info, WIDTH, HEIGHT, true));
+
+    // the unrectified image uses K, without distortion the rays are those of the pinhole model
+    halcon_bridge::DepthConversionOptions options;
+    options.rectified = false;
+    pointcloud = halcon_bridge::toHalconPointcloud(depth, info, ray_cache, options);
+    expectPinholePoints(depth, *pointcloud, 4.0, 3.5, 2.5);
+}
+
+TEST(DepthConversion, UndistortsUnrectifiedImages) {
+    sensor_msgs::Image depth = createDepth();
+    sensor_msgs::CameraInfo info = createInfo();
+    info.D[0] = -0.2;
+    info.D[1] = 0.05;
+    info.D[2] = 0.01;
+    info.D[3] = -0.005;
+    info.D[4] = 0.01;
+    halcon_bridge::CameraRayCache ray_cache;
+    halcon_bridge::DepthConversionOptions options;
+    options.rectified = false;
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconPointcloud(depth, info, ray_cache, options);
+
+    // distorting the ray of a point has to lead back to its pixel
+    const float* x = getPixels(pointcloud->x_image);
+    const float* y = getPixels(pointcloud->y_image);
+    const float* z = getPixels(pointcloud->z_image);
+    bool undistorted = false;
+    for (size_t row = 0; row < HEIGHT; row++) {
+        for (size_t column = 0; column < WIDTH; column++) {
+            size_t pixel = row * WIDTH + column;
+            if (pixel % 5 == 0) continue;
+            ASSERT_FLOAT_EQ(getDepth(depth, pixel), z[pixel]) << "pixel " << pixel;
+            double ray_x = x[pixel] / z[pixel];
+            double ray_y = y[pixel] / z[pixel];
+            double distorted_x, distorted_y;
+            distort(info.D, ray_x, ray_y, distorted_x, distorted_y);
+            ASSERT_NEAR(column, distorted_x * info.K[0] + info.K[2], 1e-3) << "pixel " << pixel;
+            ASSERT_NEAR(row, distorted_y * info.K[4] + info.K[5], 1e-3) << "pixel " << pixel;
+            undistorted = undistorted || (std::fabs(ray_x - (column - info.K[2]) / info.K[0]) > 1e-3);
+        }
+    }
+    EXPECT_TRUE(undistorted);
+}
@@ -0,0 +1,156 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/conversion_scheduler.h>
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <asr_halcon_bridge/halcon_image_batch.h>
+#include <sensor_msgs/image_encodings.h>
+#include <boost/make_shared.hpp>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+    sensor_msgs::Image createImage(const std::string& encoding, uint32_t width, uint32_t height, uint32_t padding = 0) {
+        sensor_msgs::Image image;
+        image.header.frame_id = "camera";
+        image.header.seq = 7;
+        image.encoding = encoding;
+        image.width = width;
+        image.height = height;
+        image.is_bigendian = false;
+        image.step = width * enc::numChannels(encoding) * (enc::bitDepth(encoding) / 8) + padding;
+        image.data.resize((size_t)image.step * height);
+        for (size_t i = 0; i < image.data.size(); i++) {
+            image.data[i] = (uint8_t)(i * 7 + i / 5);
+        }
+        return image;
+    }
+
+    // Compare the pixels of two messages row by row, ignoring padding and, if the export added it, the alpha channel
+    void expectSamePixels(const sensor_msgs::Image& expected, const sensor_msgs::Image& actual) {
+        ASSERT_EQ(expected.width, actual.width);
+        ASSERT_EQ(expected.height, actual.height);
+        ASSERT_EQ(expected.encoding, actual.encoding);
+        size_t value_size = enc::bitDepth(expected.encoding) / 8;
+        size_t channels = enc::numChannels(expected.encoding);
+        bool alpha = enc::hasAlpha(expected.encoding);
+        for (uint32_t row = 0; row < expected.height; row++) {
+            for (uint32_t column = 0; column < expected.width; column++) {
+                for (size_t channel = 0; channel < channels; channel++) {
+                    for (size_t byte = 0; byte < value_size; byte++) {
+                        size_t offset = (column * channels + channel) * value_size + byte;
+                        uint8_t value = actual.data[row * actual.step + offset];
+                        if (alpha && (channel == 3)) {
+                            ASSERT_EQ(0xff, value) << "alpha at row " << row << ", column " << column;
+                        } else {
+                            ASSERT_EQ(expected.data[row * expected.step + offset], value)
+                                << "row " << row << ", column " << column << ", channel " << channel;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    class ImageRoundTrip : public testing::TestWithParam<std::string> {
+    };
+
+}
+
+TEST_P(ImageRoundTrip, KeepsPixels) {
+    const uint32_t sizes[][2] = { { 1, 1 }, { 17, 3 }, { 64, 48 }, { 333, 41 } };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        sensor_msgs::Image source = createImage(GetParam(), sizes[i][0], sizes[i][1]);
+        halcon_bridge::HalconImagePtr image = halcon_bridge::toHalconCopy(source);
+        EXPECT_EQ((Hlong)source.width, image->image->Width());
+        EXPECT_EQ((Hlong)source.height, image->image->Height());
+        EXPECT_EQ(source.header.frame_id, image->header.frame_id);
+
+        sensor_msgs::ImagePtr result = image->toImageMsg();
+        expectSamePixels(source, *result);
+    }
+}
+
+TEST_P(ImageRoundTrip, SkipsRowPadding) {
+    sensor_msgs::Image source = createImage(GetParam(), 37, 11, 5);
+    sensor_msgs::ImagePtr result = halcon_bridge::toHalconCopy(source)->toImageMsg(16);
+    EXPECT_EQ(0u, result->step % 16);
+    expectSamePixels(source, *result);
+}
+
+INSTANTIATE_TEST_CASE_P(Encodings, ImageRoundTrip,
+                        testing::Values(enc::MONO8, enc::MONO16, enc::RGB8, enc::BGR8, enc::RGBA8, enc::BGRA8,
+                                        enc::RGB16, enc::BGR16, enc::RGBA16, enc::BGRA16));
+
+TEST(ImageConversion, SharesMonoImages) {
+    sensor_msgs::ImagePtr source = boost::make_shared<sensor_msgs::Image>(createImage(enc::MONO8, 40, 30));
+    halcon_bridge::HalconImageConstPtr image = halcon_bridge::toHalconShare(source);
+    HalconCpp::HString type;
+    Hlong width, height;
+    EXPECT_EQ((void*)&source->data[0], image->image->GetImagePointer1(&type, &width, &height));
+}
+
+TEST(ImageConversion, SharesOnlyCompleteSingleChannelImages) {
+    // a color image whose step only fits a mono image must not be shared as one
+    sensor_msgs::ImagePtr color = boost::make_shared<sensor_msgs::Image>(createImage(enc::RGB8, 12, 5));
+    color->step = 12;
+    color->data.resize(12 * 5);
+    EXPECT_THROW(halcon_bridge::toHalconShare(color), halcon_bridge::Exception);
+
+    sensor_msgs::ImagePtr truncated = boost::make_shared<sensor_msgs::Image>(createImage(enc::MONO8, 40, 30));
+    truncated->data.resize(40 * 29);
+    EXPECT_THROW(halcon_bridge::toHalconShare(truncated), halcon_bridge::Exception);
+}
+
+TEST(ImageConversion, RejectsUnknownEncodings) {
+    sensor_msgs::Image source = createImage(enc::MONO8, 4, 4);
+    source.encoding = "yuv422";
+    EXPECT_THROW(halcon_bridge::toHalconCopy(source), halcon_bridge::Exception);
+}
+
+TEST(ImageConversion, BatchRethrowsTheErrorOfAnImage) {
+    std::vector<sensor_msgs::ImageConstPtr> sources;
+    sources.push_back(boost::make_shared<sensor_msgs::Image>(createImage(enc::MONO8, 8, 6)));
+    sensor_msgs::ImagePtr unknown = boost::make_shared<sensor_msgs::Image>(createImage(enc::MONO8, 8, 6));
+    unknown->encoding = "yuv422";
+    sources.push_back(unknown);
+
+    // one thread converts the images side by side on the pool, four convert them one after the other
+    unsigned int threads = halcon_bridge::getConversionThreads();
+    const unsigned int thread_counts[] = { 1, 4 };
+    for (int i = 0; i < 2; i++) {
+        halcon_bridge::setConversionThreads(thread_counts[i]);
+        std::string expected, actual;
+        try {
+            halcon_bridge::toHalconCopy(*unknown);
+        } catch (halcon_bridge::Exception& e) {
+            expected = e.what();
+        }
+        try {
+            halcon_bridge::toHalconCopy(sources);
+        } catch (halcon_bridge::Exception& e) {
+            actual = e.what();
+        }
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(expected, actual) << thread_counts[i] << " threads";
+    }
+    halcon_bridge::setConversionThreads(threads);
+}
@@ -0,0 +1,386 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "cloud_kernels.h"
+#include "image_kernels.h"
+#include "kernel_dispatch.h"
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace halcon_bridge;
+
+namespace {
+
+    // Every vector kernel has to give the same bytes as the scalar reference, for any number of elements and with
+    // sources and destinations that are not aligned.
+
+    const size_t kCounts[] = { 0, 1, 2, 3, 5, 7, 15, 16, 17, 31, 33, 47, 63, 65, 127, 1001 };
+    const size_t kMisalignments[] = { 0, 1, 3 };
+
+    class Random {
+        public:
+            Random() : state_(12345) {}
+
+            uint32_t next() {
+                state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+                return (uint32_t)(state_ >> 33);
+            }
+
+            void fill(std::vector<uint8_t>& data) {
+                for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)next();
+            }
+
+            float nextFloat(float min, float max) {
+                return min + (max - min) * (next() % 100000) / 100000.0f;
+            }
+
+        private:
+            uint64_t state_;
+    };
+
+    // Floats with the same bits compare equal, NaNs compare equal to any NaN.
+    bool sameFloats(const std::vector<float>& expected, const std::vector<float>& actual, size_t& mismatch) {
+        for (mismatch = 0; mismatch < expected.size(); mismatch++) {
+            if (std::isnan(expected[mismatch]) && std::isnan(actual[mismatch])) continue;
+            if (memcmp(&expected[mismatch], &actual[mismatch], sizeof(float)) != 0) return false;
+        }
+        return true;
+    }
+
+    class KernelVariants : public testing::TestWithParam<KernelVariant> {
+        protected:
+            virtual void SetUp() {
+                variant_ = getKernelVariant();
+            }
+
+            virtual void TearDown() {
+                setKernelVariant(variant_);
+            }
+
+            // Run kernel once with the scalar reference and once with the variant under test.
+            template<typename Output, typename Kernel>
+            void run(Kernel kernel, Output& expected, Output& actual) {
+                setKernelVariant(KERNEL_VARIANT_SCALAR);
+                kernel(expected);
+                setKernelVariant(GetParam());
+                kernel(actual);
+            }
+
+            KernelVariant variant_;
+    };
+
+}
+
+TEST_P(KernelVariants, InterleavePlanes8) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t m = 0; m < sizeof(kMisalignments) / sizeof(kMisalignments[0]); m++) {
+            size_t count = kCounts[c], offset = kMisalignments[m];
+            std::vector<uint8_t> planes(4 * (count + offset) + 1);
+            random.fill(planes);
+            const uint8_t* plane0 = &planes[offset];
+            const uint8_t* plane1 = plane0 + count;
+            const uint8_t* plane2 = plane1 + count;
+            const uint8_t* plane3 = plane2 + count;
+            for (int channels = 3; channels <= 4; channels++) {
+                for (int alpha = 0; alpha < 2; alpha++) {
+                    std::vector<uint8_t> expected, actual;
+                    run([&](std::vector<uint8_t>& dst) {
+                        dst.assign(count * channels + offset + 1, 0);
+                        interleavePlanes8(plane0, plane1, plane2, alpha ? plane3 : NULL, &dst[offset], count, channels);
+                    }, expected, actual);
+                    ASSERT_EQ(expected, actual) << count << " pixels, " << channels << " channels, offset " << offset;
+                }
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, InterleavePlanes16) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t m = 0; m < sizeof(kMisalignments) / sizeof(kMisalignments[0]); m++) {
+            size_t count = kCounts[c], offset = kMisalignments[m];
+            std::vector<uint8_t> bytes(8 * (count + offset) + 2);
+            random.fill(bytes);
+            std::vector<uint16_t> planes(bytes.size() / 2);
+            memcpy(&planes[0], &bytes[0], planes.size() * 2);
+            const uint16_t* plane0 = &planes[offset];
+            const uint16_t* plane1 = plane0 + count;
+            const uint16_t* plane2 = plane1 + count;
+            const uint16_t* plane3 = plane2 + count;
+            for (int channels = 3; channels <= 4; channels++) {
+                for (int alpha = 0; alpha < 2; alpha++) {
+                    std::vector<uint16_t> expected, actual;
+                    run([&](std::vector<uint16_t>& dst) {
+                        dst.assign(count * channels + offset + 1, 0);
+                        interleavePlanes16(plane0, plane1, plane2, alpha ? plane3 : NULL, &dst[offset], count, channels);
+                    }, expected, actual);
+                    ASSERT_EQ(expected, actual) << count << " pixels, " << channels << " channels, offset " << offset;
+                }
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, SwapBytes16) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t m = 0; m < sizeof(kMisalignments) / sizeof(kMisalignments[0]); m++) {
+            size_t count = kCounts[c], offset = kMisalignments[m];
+            std::vector<uint8_t> src(2 * count + offset + 1);
+            random.fill(src);
+            std::vector<uint16_t> expected, actual;
+            run([&](std::vector<uint16_t>& dst) {
+                dst.assign(count + 2, 0);
+                swapBytes16(&src[offset], &dst[1], count);
+            }, expected, actual);
+            ASSERT_EQ(expected, actual) << count << " values, offset " << offset;
+        }
+    }
+}
+
+TEST_P(KernelVariants, DeinterleavePixels8) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t m = 0; m < sizeof(kMisalignments) / sizeof(kMisalignments[0]); m++) {
+            size_t count = kCounts[c], offset = kMisalignments[m];
+            std::vector<uint8_t> src(4 * count + offset + 1);
+            random.fill(src);
+            for (int channels = 3; channels <= 4; channels++) {
+                std::vector<uint8_t> expected, actual;
+                run([&](std::vector<uint8_t>& dst) {
+                    dst.assign(3 * (count + offset) + 1, 0);
+                    uint8_t* plane0 = &dst[offset];
+                    deinterleavePixels8(&src[offset], plane0, plane0 + count, plane0 + 2 * count, count, channels);
+                }, expected, actual);
+                ASSERT_EQ(expected, actual) << count << " pixels, " << channels << " channels, offset " << offset;
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, DownsampleRows8) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t m = 0; m < sizeof(kMisalignments) / sizeof(kMisalignments[0]); m++) {
+            size_t count = kCounts[c], offset = kMisalignments[m];
+            // an odd source width leaves a last column that is not averaged
+            std::vector<uint8_t> rows(2 * (2 * count + 1) + offset);
+            random.fill(rows);
+            const uint8_t* row0 = &rows[offset];
+            const uint8_t* row1 = row0 + 2 * count + 1;
+            std::vector<uint8_t> expected, actual;
+            run([&](std::vector<uint8_t>& dst) {
+                dst.assign(count + offset + 1, 0);
+                downsampleRows8(row0, row1, &dst[offset], count);
+            }, expected, actual);
+            ASSERT_EQ(expected, actual) << count << " pixels, offset " << offset;
+        }
+    }
+}
+
+TEST_P(KernelVariants, DemosaicRow8) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        size_t width = kCounts[c] + 2;
+        std::vector<uint8_t> rows(3 * width + 1);
+        random.fill(rows);
+        const uint8_t* above = &rows[1];
+        const uint8_t* row = above + width;
+        const uint8_t* below = row + width;
+        // whole rows as well as the ranges of parallel chunks starting at odd and even columns
+        const size_t begins[] = { 0, 1, 2, 3, width / 2 };
+        for (size_t b = 0; b < sizeof(begins) / sizeof(begins[0]); b++) {
+            if (begins[b] >= width) continue;
+            size_t begin = begins[b], count = width - begin;
+            for (int x_at_odd = 0; x_at_odd < 2; x_at_odd++) {
+                std::vector<uint8_t> expected, actual;
+                run([&](std::vector<uint8_t>& dst) {
+                    dst.assign(3 * count + 1, 0);
+                    uint8_t* x = &dst[1];
+                    demosaicRow8(above, row, below, width, begin, count, x_at_odd != 0, x, x + count, x + 2 * count);
+                }, expected, actual);
+                ASSERT_EQ(expected, actual) << "width " << width << ", begin " << begin << ", x at odd " << x_at_odd;
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, GatherXYZ) {
+    Random random;
+    const size_t steps[] = { 12, 16, 20, 32, 48 };
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            size_t count = kCounts[c], step = steps[s];
+            for (size_t offset_x = 0; offset_x + 12 <= step; offset_x += 4) {
+                std::vector<uint8_t> src(count * step + 3);
+                random.fill(src);
+                std::vector<float> expected, actual;
+                run([&](std::vector<float>& dst) {
+                    dst.assign(3 * count + 1, 0.0f);
+                    float* x = &dst[1];
+                    gatherXYZ(&src[3], step, count, offset_x, offset_x + 4, offset_x + 8, x, x + count, x + 2 * count);
+                }, expected, actual);
+                size_t mismatch;
+                ASSERT_TRUE(sameFloats(expected, actual, mismatch))
+                    << count << " points, step " << step << ", x at " << offset_x << ", value " << mismatch;
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, GatherFixedLayout) {
+    Random random;
+    const PointLayout layouts[] = { POINT_LAYOUT_XYZ, POINT_LAYOUT_XYZI, POINT_LAYOUT_XYZRGB, POINT_LAYOUT_NORMAL,
+                                    POINT_LAYOUT_XYZRGB_NORMAL };
+    const size_t steps[] = { 16, 32, 32, 48, 48 };
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+            size_t count = kCounts[c];
+            std::vector<uint8_t> src(count * steps[l] + 1);
+            random.fill(src);
+            for (int wanted = 0; wanted < 2; wanted++) {
+                std::vector<float> expected, actual;
+                run([&](std::vector<float>& dst) {
+                    dst.assign(11 * count + 1, 0.0f);
+                    float* x = &dst[1];
+                    float* a = x + 3 * count;
+                    PointAttributes attributes = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+                    if (wanted) {
+                        PointAttributes all = { a, a + count, a + 2 * count, a + 3 * count, a + 4 * count, a + 5 * count,
+                                                a + 6 * count, a + 7 * count };
+                        attributes = all;
+                    }
+                    gatherFixedLayout(layouts[l], &src[1], count, x, x + count, x + 2 * count, attributes);
+                }, expected, actual);
+                size_t mismatch;
+                ASSERT_TRUE(sameFloats(expected, actual, mismatch))
+                    << count << " points, layout " << layouts[l] << ", attributes " << wanted << ", value " << mismatch;
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, UnpackColors) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        size_t count = kCounts[c];
+        std::vector<uint8_t> src(count * 20 + 3);
+        random.fill(src);
+        std::vector<float> expected, actual;
+        run([&](std::vector<float>& dst) {
+            dst.assign(3 * count + 1, 0.0f);
+            float* red = &dst[1];
+            unpackColors(&src[3], 20, count, 12, red, red + count, red + 2 * count);
+        }, expected, actual);
+        ASSERT_EQ(expected, actual) << count << " points";
+    }
+}
+
+TEST_P(KernelVariants, PackColors) {
+    Random random;
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        size_t count = kCounts[c];
+        // out of range values are clamped, halves are rounded to even
+        std::vector<double> colors(3 * count + 1);
+        for (size_t i = 0; i < colors.size(); i++) colors[i] = (int)(random.next() % 700) * 0.5 - 50.0;
+        const double* red = &colors[1];
+        std::vector<uint32_t> expected, actual;
+        run([&](std::vector<uint32_t>& dst) {
+            dst.assign(count + 1, 0);
+            packColors(red, red + count, red + 2 * count, count, &dst[1]);
+        }, expected, actual);
+        ASSERT_EQ(expected, actual) << count << " points";
+    }
+}
+
+TEST_P(KernelVariants, BackprojectDepth) {
+    Random random;
+    const float special[] = { 0.0f, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -1.5f };
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        size_t count = kCounts[c];
+        std::vector<float> rays(2 * count + 1);
+        for (size_t i = 0; i < rays.size(); i++) rays[i] = random.nextFloat(-1.0f, 1.0f);
+        for (int float_depth = 0; float_depth < 2; float_depth++) {
+            std::vector<uint8_t> depth(4 * count + 3);
+            random.fill(depth);
+            if (float_depth) {
+                for (size_t i = 0; i < count; i++) {
+                    float value = (i % 5 == 0) ? special[(i / 5) % 4] : random.nextFloat(0.1f, 10.0f);
+                    memcpy(&depth[3 + 4 * i], &value, sizeof(value));
+                }
+            } else {
+                for (size_t i = 0; i < count; i += 7) depth[3 + 2 * i] = depth[4 + 2 * i] = 0;
+            }
+            for (int rays_given = 0; rays_given < 2; rays_given++) {
+                std::vector<float> expected, actual;
+                run([&](std::vector<float>& dst) {
+                    dst.assign(3 * count + 1, 0.0f);
+                    float* x = &dst[1];
+                    backprojectDepth(&depth[3], count, float_depth != 0, float_depth ? 1.0f : 0.001f, false,
+                                     rays_given ? &rays[1] : NULL, &rays[1] + count, x, x + count, x + 2 * count);
+                }, expected, actual);
+                size_t mismatch;
+                ASSERT_TRUE(sameFloats(expected, actual, mismatch))
+                    << count << " pixels, float " << float_depth << ", rays " << rays_given << ", value " << mismatch;
+            }
+        }
+    }
+}
+
+TEST_P(KernelVariants, ReprojectDisparity) {
+    Random random;
+    const float special[] = { 0.0f, std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -1.5f, 0.5f };
+    for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); c++) {
+        size_t count = kCounts[c];
+        std::vector<uint8_t> disparity(4 * count + 3);
+        for (size_t i = 0; i < count; i++) {
+            float value = (i % 4 == 0) ? special[(i / 4) % 5] : random.nextFloat(1.0f, 128.0f);
+            memcpy(&disparity[3 + 4 * i], &value, sizeof(value));
+        }
+        std::vector<float> expected, actual;
+        run([&](std::vector<float>& dst) {
+            dst.assign(3 * count + 1, 0.0f);
+            float* x = &dst[1];
+            reprojectDisparity(&disparity[3], count, false, 1.0f, 42.5f, -0.4f, 0.003f, 0.25f, x, x + count, x + 2 * count);
+        }, expected, actual);
+        size_t mismatch;
+        ASSERT_TRUE(sameFloats(expected, actual, mismatch)) << count << " pixels, value " << mismatch;
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Supported, KernelVariants, testing::ValuesIn(getKernelVariants()));
+
+TEST(KernelDispatch, RejectsUnsupportedVariants) {
+    std::vector<KernelVariant> variants = getKernelVariants();
+    ASSERT_EQ(KERNEL_VARIANT_SCALAR, variants.front());
+    KernelVariant selected = getKernelVariant();
+    EXPECT_EQ(variants.back(), selected);
+#if defined(__x86_64__) || defined(__i386__)
+    EXPECT_THROW(setKernelVariant(KERNEL_VARIANT_NEON), halcon_bridge::Exception);
+#else
+    EXPECT_THROW(setKernelVariant(KERNEL_VARIANT_SSE2), halcon_bridge::Exception);
+#endif
+    EXPECT_EQ(selected, getKernelVariant());
+}
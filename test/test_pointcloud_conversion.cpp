@@ -0,0 +1,388 @@
+/**
+
+Copyright (c) 2016, Allgeyer Tobias
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <asr_halcon_bridge/halcon_exception.h>
+#include <asr_halcon_bridge/halcon_pointcloud.h>
+#include <sensor_msgs/PointField.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+    void addField(sensor_msgs::PointCloud2& cloud, const std::string& name, uint32_t offset,
+                  uint8_t datatype = sensor_msgs::PointField::FLOAT32) {
+        sensor_msgs::PointField field;
+        field.name = name;
+        field.offset = offset;
+        field.datatype = datatype;
+        field.count = 1;
+        cloud.fields.push_back(field);
+    }
+
+    sensor_msgs::PointCloud2 createCloud(uint32_t width, uint32_t height, uint32_t point_step) {
+        sensor_msgs::PointCloud2 cloud;
+        cloud.header.frame_id = "sensor";
+        cloud.width = width;
+        cloud.height = height;
+        cloud.is_bigendian = false;
+        cloud.is_dense = false;
+        cloud.point_step = point_step;
+        cloud.row_step = width * point_step;
+        cloud.data.assign((size_t)cloud.row_step * height, 0);
+        return cloud;
+    }
+
+    void setFloat(sensor_msgs::PointCloud2& cloud, size_t point, uint32_t offset, float value) {
+        memcpy(&cloud.data[point * cloud.point_step + offset], &value, sizeof(value));
+    }
+
+    float getFloat(const sensor_msgs::PointCloud2& cloud, size_t point, const std::string& name) {
+        for (size_t i = 0; i < cloud.fields.size(); i++) {
+            if (cloud.fields[i].name == name) {
+                float value;
+                memcpy(&value, &cloud.data[point * cloud.point_step + cloud.fields[i].offset], sizeof(value));
+                return value;
+            }
+        }
+        ADD_FAILURE() << "missing field " << name;
+        return 0.0f;
+    }
+
+    // pcl::PointNormal: x, y, z, padding, normal_x, normal_y, normal_z, padding, curvature
+    sensor_msgs::PointCloud2 createNormalCloud(uint32_t width, uint32_t height) {
+        sensor_msgs::PointCloud2 cloud = createCloud(width, height, 48);
+        const char* names[] = { "x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature" };
+        const uint32_t offsets[] = { 0, 4, 8, 16, 20, 24, 32 };
+        for (int i = 0; i < 7; i++) {
+            addField(cloud, names[i], offsets[i]);
+        }
+        for (size_t point = 0; point < (size_t)width * height; point++) {
+            for (int i = 0; i < 7; i++) {
+                setFloat(cloud, point, offsets[i], (float)point + 0.125f * i);
+            }
+        }
+        return cloud;
+    }
+
+    // Same points with four bytes of padding appended, a point step no fixed layout matches
+    sensor_msgs::PointCloud2 padCloud(const sensor_msgs::PointCloud2& source) {
+        sensor_msgs::PointCloud2 padded = createCloud(source.width, source.height, source.point_step + 4);
+        padded.fields = source.fields;
+        for (size_t point = 0; point < (size_t)source.width * source.height; point++) {
+            memcpy(&padded.data[point * padded.point_step], &source.data[point * source.point_step], source.point_step);
+        }
+        return padded;
+    }
+
+    // pcl::PointXYZI: x, y, z, padding, intensity
+    sensor_msgs::PointCloud2 createIntensityCloud(uint32_t width, uint32_t height, const float (*points)[4]) {
+        sensor_msgs::PointCloud2 cloud = createCloud(width, height, 32);
+        addField(cloud, "x", 0);
+        addField(cloud, "y", 4);
+        addField(cloud, "z", 8);
+        addField(cloud, "intensity", 16);
+        const uint32_t offsets[] = { 0, 4, 8, 16 };
+        for (size_t point = 0; point < (size_t)width * height; point++) {
+            for (int i = 0; i < 4; i++) {
+                setFloat(cloud, point, offsets[i], points[point][i]);
+            }
+        }
+        return cloud;
+    }
+
+    // Points of a model as x, y, z, intensity, in the order of the model
+    std::vector<std::vector<float> > getIntensityPoints(const halcon_bridge::HalconPointcloud& pointcloud) {
+        const char* names[] = { "point_coord_x", "point_coord_y", "point_coord_z", "&intensity" };
+        HalconCpp::HTuple values[4];
+        for (int i = 0; i < 4; i++) {
+            values[i] = pointcloud.model->GetObjectModel3dParams(names[i]);
+        }
+        std::vector<std::vector<float> > points(values[0].Length(), std::vector<float>(4));
+        for (size_t point = 0; point < points.size(); point++) {
+            for (int i = 0; i < 4; i++) {
+                points[point][i] = (float)(double)values[i][point];
+            }
+        }
+        return points;
+    }
+
+    void expectSameAttributes(const sensor_msgs::PointCloud2& source, const char* const* names, size_t count) {
+        halcon_bridge::HalconPointcloudPtr fixed = halcon_bridge::toHalconCopy(source);
+        halcon_bridge::HalconPointcloudPtr generic = halcon_bridge::toHalconCopy(padCloud(source));
+        for (size_t i = 0; i < count; i++) {
+            HalconCpp::HTuple expected = generic->model->GetObjectModel3dParams(names[i]);
+            HalconCpp::HTuple actual = fixed->model->GetObjectModel3dParams(names[i]);
+            ASSERT_EQ(expected.Length(), actual.Length()) << names[i];
+            for (int point = 0; point < expected.Length(); point++) {
+                ASSERT_EQ((double)expected[point], (double)actual[point]) << names[i] << " of point " << point;
+            }
+        }
+    }
+
+}
+
+TEST(PointcloudConversion, KeepsPointsAndNormals) {
+    sensor_msgs::PointCloud2 source = createNormalCloud(1001, 1);
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source);
+    EXPECT_EQ(1001, (int)pointcloud->model->GetObjectModel3dParams("num_points")[0]);
+    EXPECT_EQ(source.header.frame_id, pointcloud->header.frame_id);
+
+    sensor_msgs::PointCloud2Ptr result = pointcloud->toPointcloudMsg();
+    ASSERT_EQ(1001u, result->width);
+    ASSERT_EQ(1u, result->height);
+    const char* names[] = { "x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature" };
+    for (size_t point = 0; point < 1001; point++) {
+        for (int i = 0; i < 7; i++) {
+            ASSERT_EQ((float)point + 0.125f * i, getFloat(*result, point, names[i])) << names[i] << " of point " << point;
+        }
+    }
+}
+
+TEST(PointcloudConversion, KeepsGridOfOrganizedClouds) {
+    sensor_msgs::PointCloud2 source = createNormalCloud(31, 7);
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    setFloat(source, 40, 0, nan);
+    setFloat(source, 41, 8, nan);
+
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source);
+    ASSERT_TRUE(pointcloud->x_image.IsInitialized());
+    EXPECT_EQ(31 * 7 - 2, (int)pointcloud->model->GetObjectModel3dParams("num_points")[0]);
+
+    sensor_msgs::PointCloud2Ptr result = pointcloud->toPointcloudMsg();
+    ASSERT_EQ(31u, result->width);
+    ASSERT_EQ(7u, result->height);
+    for (size_t point = 0; point < 31 * 7; point++) {
+        if ((point == 40) || (point == 41)) {
+            EXPECT_TRUE(std::isnan(getFloat(*result, point, "z")));
+        } else {
+            ASSERT_EQ((float)point + 0.25f, getFloat(*result, point, "z")) << "point " << point;
+            ASSERT_EQ((float)point + 0.5f, getFloat(*result, point, "normal_y")) << "point " << point;
+        }
+    }
+}
+
+TEST(PointcloudConversion, ReadsOtherFieldTypes) {
+    sensor_msgs::PointCloud2 source = createCloud(5, 1, 16);
+    addField(source, "x", 0);
+    addField(source, "y", 4);
+    addField(source, "z", 8);
+    addField(source, "ring", 12, sensor_msgs::PointField::UINT16);
+    for (size_t point = 0; point < 5; point++) {
+        setFloat(source, point, 0, 1.0f);
+        uint16_t ring = (uint16_t)(point * 1000);
+        memcpy(&source.data[point * 16 + 12], &ring, sizeof(ring));
+    }
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source);
+    HalconCpp::HTuple rings = pointcloud->model->GetObjectModel3dParams("&ring");
+    ASSERT_EQ(5, rings.Length());
+    for (int point = 0; point < 5; point++) {
+        EXPECT_EQ(point * 1000.0, (double)rings[point]);
+    }
+}
+
+TEST(PointcloudConversion, ReadsAttributesOutsideFixedLayouts) {
+    // x, y, z with the intensity in the padding of an XYZ point
+    sensor_msgs::PointCloud2 xyz = createCloud(37, 1, 16);
+    addField(xyz, "x", 0);
+    addField(xyz, "y", 4);
+    addField(xyz, "z", 8);
+    addField(xyz, "intensity", 12);
+    for (size_t point = 0; point < 37; point++) {
+        for (uint32_t offset = 0; offset < 16; offset += 4) {
+            setFloat(xyz, point, offset, (float)point + 0.25f * offset);
+        }
+    }
+    const char* xyz_names[] = { "point_coord_x", "point_coord_z", "&intensity" };
+    expectSameAttributes(xyz, xyz_names, 3);
+
+    // x, y, z, rgb with an intensity next to the color
+    sensor_msgs::PointCloud2 xyzrgb = createCloud(37, 1, 32);
+    addField(xyzrgb, "x", 0);
+    addField(xyzrgb, "y", 4);
+    addField(xyzrgb, "z", 8);
+    addField(xyzrgb, "rgb", 16);
+    addField(xyzrgb, "intensity", 20);
+    for (size_t point = 0; point < 37; point++) {
+        setFloat(xyzrgb, point, 0, (float)point);
+        uint32_t rgb = 0x00102030u + (uint32_t)point;
+        memcpy(&xyzrgb.data[point * 32 + 16], &rgb, sizeof(rgb));
+        setFloat(xyzrgb, point, 20, 0.5f * point);
+    }
+    const char* xyzrgb_names[] = { "point_coord_x", "&red", "&green", "&blue", "&intensity" };
+    expectSameAttributes(xyzrgb, xyzrgb_names, 5);
+}
+
+TEST(PointcloudConversion, KeepsFieldsNamedLikeAttributes) {
+    // x, y, z, rgb, a separate red channel and a field that only starts like a normal
+    sensor_msgs::PointCloud2 source = createCloud(9, 1, 24);
+    addField(source, "x", 0);
+    addField(source, "y", 4);
+    addField(source, "z", 8);
+    addField(source, "rgb", 12);
+    addField(source, "red", 16);
+    addField(source, "normal_weight", 20);
+    for (size_t point = 0; point < 9; point++) {
+        setFloat(source, point, 0, (float)point);
+        uint32_t rgb = 0x00102030u + (uint32_t)point;
+        memcpy(&source.data[point * 24 + 12], &rgb, sizeof(rgb));
+        setFloat(source, point, 16, 1000.0f);
+        setFloat(source, point, 20, 0.5f * point);
+    }
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source);
+    HalconCpp::HTuple red = pointcloud->model->GetObjectModel3dParams("&red");
+    ASSERT_EQ(9, red.Length());
+    for (int point = 0; point < 9; point++) {
+        EXPECT_EQ(0x10, (double)red[point]);
+    }
+
+    sensor_msgs::PointCloud2Ptr result = pointcloud->toPointcloudMsg();
+    for (size_t i = 0; i < result->fields.size(); i++) {
+        EXPECT_NE("red", result->fields[i].name);
+    }
+    for (size_t point = 0; point < 9; point++) {
+        EXPECT_EQ(0.5f * point, getFloat(*result, point, "normal_weight"));
+    }
+}
+
+TEST(PointcloudConversion, RejectsPointcloudsWithoutModel) {
+    // e.g. a depth image converted with DepthConversionOptions::model disabled
+    halcon_bridge::HalconPointcloud pointcloud;
+    sensor_msgs::PointCloud2 ros_pointcloud;
+    EXPECT_THROW(pointcloud.toPointcloudMsgLayout(ros_pointcloud), halcon_bridge::Exception);
+    EXPECT_THROW(pointcloud.toPointcloudMsg(ros_pointcloud), halcon_bridge::Exception);
+    EXPECT_THROW(pointcloud.toPointcloudMsg(), halcon_bridge::Exception);
+}
+
+TEST(PointcloudConversion, RemovesInvalidPoints) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float points[][4] = {
+        { 0.0f, 1.0f, 2.0f, 10.0f }, { nan, 1.0f, 2.0f, 11.0f }, { 1.0f, 2.0f, 3.0f, 12.0f },
+        { 2.0f, 3.0f, infinity, 13.0f }, { 3.0f, 4.0f, 5.0f, 14.0f }, { 4.0f, nan, 6.0f, 15.0f },
+        { 5.0f, 6.0f, 7.0f, 16.0f }
+    };
+    sensor_msgs::PointCloud2 source = createIntensityCloud(7, 1, points);
+    halcon_bridge::PointcloudConversionOptions options;
+    options.remove_invalid = true;
+
+    std::vector<std::vector<float> > kept = getIntensityPoints(*halcon_bridge::toHalconCopy(source, options));
+    const size_t valid[] = { 0, 2, 4, 6 };
+    ASSERT_EQ(4u, kept.size());
+    for (size_t point = 0; point < kept.size(); point++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(points[valid[point]][i], kept[point][i]) << "point " << point;
+        }
+    }
+
+    // without the option, or if the message claims to be dense, the points are not checked
+    EXPECT_EQ(7u, getIntensityPoints(*halcon_bridge::toHalconCopy(source)).size());
+    source.is_dense = true;
+    EXPECT_EQ(7u, getIntensityPoints(*halcon_bridge::toHalconCopy(source, options)).size());
+}
+
+TEST(PointcloudConversion, CropsIncludingTheFacesOfTheBox) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float points[][4] = {
+        { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 2.0f, 3.0f, 2.0f }, { 0.5f, 1.0f, 1.5f, 3.0f },
+        { -0.001f, 1.0f, 1.5f, 4.0f }, { 0.5f, 2.001f, 1.5f, 5.0f }, { 0.5f, 1.0f, 3.001f, 6.0f },
+        { nan, 1.0f, 1.5f, 7.0f }, { 1.0f, 0.0f, 3.0f, 8.0f }
+    };
+    sensor_msgs::PointCloud2 source = createIntensityCloud(8, 1, points);
+    halcon_bridge::PointcloudConversionOptions options;
+    options.crop = true;
+    options.crop_max_x = 1.0f;
+    options.crop_max_y = 2.0f;
+    options.crop_max_z = 3.0f;
+
+    std::vector<std::vector<float> > kept = getIntensityPoints(*halcon_bridge::toHalconCopy(source, options));
+    const size_t inside[] = { 0, 1, 2, 7 };
+    ASSERT_EQ(4u, kept.size());
+    for (size_t point = 0; point < kept.size(); point++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(points[inside[point]][i], kept[point][i]) << "point " << point;
+        }
+    }
+}
+
+TEST(PointcloudConversion, CropsOrganizedCloudsToTheDomain) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    // 4 x 2 grid, the second row is further away
+    const float points[][4] = {
+        { -1.0f, 0.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 2.0f }, { 1.0f, 0.0f, 1.0f, 3.0f }, { 2.0f, 0.0f, 1.0f, 4.0f },
+        { -1.0f, 1.0f, 2.0f, 5.0f }, { 0.0f, 1.0f, 2.0f, 6.0f }, { nan, 1.0f, 2.0f, 7.0f }, { 2.0f, 1.0f, 2.0f, 8.0f }
+    };
+    sensor_msgs::PointCloud2 source = createIntensityCloud(4, 2, points);
+    halcon_bridge::PointcloudConversionOptions options;
+    options.crop = true;
+    options.crop_max_x = 1.0f;
+    options.crop_max_y = 1.0f;
+    options.crop_max_z = 2.0f;
+
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source, options);
+    ASSERT_TRUE(pointcloud->x_image.IsInitialized());
+    EXPECT_EQ(3, pointcloud->x_image.GetDomain().Area());
+    std::vector<std::vector<float> > kept = getIntensityPoints(*pointcloud);
+    const size_t inside[] = { 1, 2, 5 };
+    ASSERT_EQ(3u, kept.size());
+    for (size_t point = 0; point < kept.size(); point++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(points[inside[point]][i], kept[point][i]) << "point " << point;
+        }
+    }
+
+    sensor_msgs::PointCloud2Ptr result = pointcloud->toPointcloudMsg();
+    ASSERT_EQ(4u, result->width);
+    ASSERT_EQ(2u, result->height);
+    for (size_t point = 0; point < 8; point++) {
+        bool is_inside = std::find(inside, inside + 3, point) != inside + 3;
+        EXPECT_EQ(is_inside, !std::isnan(getFloat(*result, point, "x"))) << "point " << point;
+    }
+}
+
+TEST(PointcloudConversion, ReplacesVoxelsByTheirCentroids) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float points[][4] = {
+        { 0.1f, 0.1f, 0.1f, 10.0f }, { 1.5f, 0.2f, 0.2f, 40.0f }, { -0.5f, -0.5f, 0.5f, 1.0f },
+        { 0.3f, 0.5f, 0.9f, 20.0f }, { nan, 0.5f, 0.5f, 1000.0f }, { -0.1f, -0.9f, 0.1f, 2.0f },
+        { -0.3f, -0.1f, 0.3f, 6.0f }
+    };
+    sensor_msgs::PointCloud2 source = createIntensityCloud(7, 1, points);
+    halcon_bridge::PointcloudConversionOptions options;
+    options.voxel_size = 1.0f;
+
+    halcon_bridge::HalconPointcloudPtr pointcloud = halcon_bridge::toHalconCopy(source, options);
+    EXPECT_FALSE(pointcloud->x_image.IsInitialized());
+    std::vector<std::vector<float> > centroids = getIntensityPoints(*pointcloud);
+    std::sort(centroids.begin(), centroids.end());
+
+    // voxels [-1, 0) x [-1, 0) x [0, 1), [0, 1)^3 and [1, 2) x [0, 1) x [0, 1), the NaN point is dropped
+    const float expected[][4] = {
+        { -0.3f, -0.5f, 0.3f, 3.0f }, { 0.2f, 0.3f, 0.5f, 15.0f }, { 1.5f, 0.2f, 0.2f, 40.0f }
+    };
+    ASSERT_EQ(3u, centroids.size());
+    for (size_t voxel = 0; voxel < 3; voxel++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_NEAR(expected[voxel][i], centroids[voxel][i], 1e-6) << "voxel " << voxel;
+        }
+    }
+}